@@ -0,0 +1,99 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+namespace {
+
+// Relaxed, the counts are read after the phases, not to order anything.
+std::atomic<uint64_t> allocations = 0;
+std::atomic<uint64_t> allocated_bytes = 0;
+std::atomic<uint64_t> live_bytes = 0;
+std::atomic<uint64_t> peak_live_bytes = 0;
+
+void *allocate(size_t size) {
+  void *pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    return nullptr;
+  }
+  // Usable size, the same is subtracted on free.
+  size_t usable_size = malloc_usable_size(pointer);
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(usable_size, std::memory_order_relaxed);
+  uint64_t live =
+      live_bytes.fetch_add(usable_size, std::memory_order_relaxed) +
+      usable_size;
+  uint64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !peak_live_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+  return pointer;
+}
+
+void deallocate(void *pointer) {
+  if (pointer == nullptr) {
+    return;
+  }
+  live_bytes.fetch_sub(malloc_usable_size(pointer),
+                       std::memory_order_relaxed);
+  free(pointer);
+}
+
+} // namespace
+
+// All of the forms are replaced, the standard library and the sanitizers
+//   may implement the ones, that are not, without these. Aligned forms
+//   are left as they are, new and delete of them match each other.
+void *operator new(size_t size) {
+  void *pointer = allocate(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept { deallocate(pointer); }
+
+void operator delete[](void *pointer) noexcept { deallocate(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { deallocate(pointer); }
+
+void operator delete[](void *pointer, size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer);
+}
+
+namespace pas {
+namespace allocation_counter {
+
+AllocationCounts get_counts() {
+  AllocationCounts counts;
+  counts.allocations = allocations.load(std::memory_order_relaxed);
+  counts.bytes = allocated_bytes.load(std::memory_order_relaxed);
+  counts.live_bytes = live_bytes.load(std::memory_order_relaxed);
+  counts.peak_live_bytes = peak_live_bytes.load(std::memory_order_relaxed);
+  return counts;
+}
+
+} // namespace allocation_counter
+} // namespace pas
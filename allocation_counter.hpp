@@ -0,0 +1,16 @@
+#pragma once
+
+#include "libpascal.hpp"
+
+// Counts of the allocations of the compiler executable (-fmem-report). It
+//   replaces the global operator new and delete with ones, that count and
+//   call malloc and free. The library doesn't, so that applications keep
+//   their allocators.
+
+namespace pas {
+namespace allocation_counter {
+
+AllocationCounts get_counts();
+
+} // namespace allocation_counter
+} // namespace pas
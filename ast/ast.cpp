@@ -1 +1,108 @@
 #include "ast/ast.hpp"
+
+#include <variant>
+#include <vector>
+
+#include "ast/utils/get_idx.hpp"
+
+namespace pas {
+namespace ast {
+
+namespace {
+
+using OwnedNode = std::variant<ExprUP, NegationUP, FuncCallUP, SetValueUP, Stmt>;
+
+// Per thread, trees are built and destroyed by the thread of a compilation.
+thread_local std::vector<OwnedNode> nodes_to_destroy;
+thread_local bool is_destroying = false;
+
+void destroy_pending_nodes() {
+  if (is_destroying) {
+    // The loop below is on the stack already.
+    return;
+  }
+  is_destroying = true;
+  while (!nodes_to_destroy.empty()) {
+    // Its destructor adds its children to the vector.
+    OwnedNode node = std::move(nodes_to_destroy.back());
+    nodes_to_destroy.pop_back();
+  }
+  is_destroying = false;
+}
+
+template <typename NodeUP> void destroy_later_if_owned(NodeUP &node) {
+  // Moved-from nodes own nothing.
+  if (node != nullptr) {
+    nodes_to_destroy.emplace_back(std::move(node));
+    destroy_pending_nodes();
+  }
+}
+
+} // namespace
+
+void destroy_later(ExprUP &expr) { destroy_later_if_owned(expr); }
+
+void destroy_later(Factor &factor) {
+  switch (factor.index()) {
+  case get_idx(FactorKind::Expr):
+    destroy_later_if_owned(std::get<ExprUP>(factor));
+    break;
+  case get_idx(FactorKind::Negation):
+    destroy_later_if_owned(std::get<NegationUP>(factor));
+    break;
+  case get_idx(FactorKind::FuncCall):
+    destroy_later_if_owned(std::get<FuncCallUP>(factor));
+    break;
+  case get_idx(FactorKind::SetValue):
+    destroy_later_if_owned(std::get<SetValueUP>(factor));
+    break;
+  default:
+    break;
+  }
+}
+
+void destroy_later(Stmt &stmt) {
+  bool is_owned = std::visit(
+      [](const auto &stmt_up) { return stmt_up != nullptr; }, stmt);
+  if (is_owned) {
+    nodes_to_destroy.emplace_back(std::move(stmt));
+    destroy_pending_nodes();
+  }
+}
+
+DesignatorArrayAccess::~DesignatorArrayAccess() {
+  for (ExprUP &expr : expr_list_) {
+    destroy_later(expr);
+  }
+}
+
+Negation::~Negation() { destroy_later(factor_); }
+
+Term::~Term() {
+  destroy_later(start_factor_);
+  for (Op &op : ops_) {
+    destroy_later(op.factor);
+  }
+}
+
+StmtSeq::~StmtSeq() {
+  for (Stmt &stmt : stmts_) {
+    destroy_later(stmt);
+  }
+}
+
+IfStmt::~IfStmt() {
+  destroy_later(then_stmt_);
+  if (else_stmt_.has_value()) {
+    destroy_later(else_stmt_.value());
+  }
+}
+
+Case::~Case() { destroy_later(then_stmt_); }
+
+WhileStmt::~WhileStmt() { destroy_later(inner_stmt_); }
+
+ForStmt::~ForStmt() { destroy_later(inner_stmt_); }
+
+} // namespace ast
+} // namespace pas
@@ -23,6 +23,7 @@ public:
 public:
   std::string program_name_;
   Block block_;
+  SourceLoc loc_;
 };
 
 class CompilationUnit {
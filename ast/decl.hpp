@@ -83,6 +83,7 @@ public:
 public:
   std::string proc_name_;
   std::vector<FormalParam> params_;
+  SourceLoc loc_;
 };
 
 class Declarations;
@@ -38,6 +38,7 @@ public:
   DesignatorArrayAccess() = default;
   DesignatorArrayAccess(DesignatorArrayAccess &&other) = default;
   DesignatorArrayAccess &operator=(DesignatorArrayAccess &&other) = default;
+  ~DesignatorArrayAccess();
 
 public:
   DesignatorArrayAccess(std::vector<ExprUP> expr_list)
@@ -86,23 +87,35 @@ enum class FactorKind {
   Designator = 4,
   Expr = 5,
   Negation = 6,
-  FuncCall = 7
+  FuncCall = 7,
+  SetValue = 8,
+  Real = 9
 };
 
 class Negation;
 class FuncCall;
+class SetValue;
 
 using NegationUP = std::unique_ptr<Negation>;
 using FuncCallUP = std::unique_ptr<FuncCall>;
+using SetValueUP = std::unique_ptr<SetValue>;
 
 using Factor = std::variant<std::string, int, bool, std::monostate, Designator,
-                            ExprUP, NegationUP, FuncCallUP>;
+                            ExprUP, NegationUP, FuncCallUP, SetValueUP, double>;
+
+// Nodes, that own other nodes on the heap, hand them over in their
+//   destructors: they are destroyed by a loop after that, not recursively,
+//   so that a deeply nested tree (e.g. an expression in thousands of
+//   parentheses) doesn't exhaust the stack, when it is destroyed.
+void destroy_later(ExprUP &expr);
+void destroy_later(Factor &factor);
 
 class Negation {
 public:
   Negation() = default;
   Negation(Negation &&other) = default;
   Negation &operator=(Negation &&other) = default;
+  ~Negation();
 
 public:
   Negation(Factor factor) : factor_(std::move(factor)) {}
@@ -111,11 +124,26 @@ public:
   Factor factor_;
 };
 
+// Set constructor, e.g. [1, 3, 5..7]. Elements are constant.
+class SetValue {
+public:
+  SetValue() = default;
+  SetValue(SetValue &&other) = default;
+  SetValue &operator=(SetValue &&other) = default;
+
+public:
+  SetValue(std::vector<Element> elements) : elements_(std::move(elements)) {}
+
+public:
+  std::vector<Element> elements_;
+};
+
 class Term {
 public:
   Term() = default;
   Term(Term &&other) = default;
   Term &operator=(Term &&other) = default;
+  ~Term();
 
 public:
   struct Op {
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace pas {
+namespace ast {
+
+// Where the node starts in the source file, lines and columns are counted
+//   from 1. Used for the debug info, line 0 means an unknown location.
+struct SourceLoc {
+  int line = 0;
+  int column = 0;
+};
+
+} // namespace ast
+} // namespace pas
@@ -2,6 +2,7 @@
 
 #include <ast/const_expr.hpp>
 #include <ast/expr.hpp>
+#include <ast/source_loc.hpp>
 #include <ast/type.hpp>
 
 #include <optional>
@@ -51,17 +52,22 @@ using Stmt =
     std::variant<AssignmentUP, ProcCallUP, IfStmtUP, CaseStmtUP, WhileStmtUP,
                  RepeatStmtUP, ForStmtUP, MemoryStmtUP, StmtSeqUP, EmptyStmtUP>;
 
+// See destroy_later of expr.hpp.
+void destroy_later(Stmt &stmt);
+
 class StmtSeq {
 public:
   StmtSeq() = default;
   StmtSeq(StmtSeq &&other) = default;
   StmtSeq &operator=(StmtSeq &&other) = default;
+  ~StmtSeq();
 
 public:
   StmtSeq(std::vector<Stmt> stmts) : stmts_(std::move(stmts)) {}
 
 public:
   std::vector<Stmt> stmts_;
+  SourceLoc loc_;
 };
 
 class EmptyStmt {
@@ -69,6 +75,9 @@ public:
   EmptyStmt() = default;
   EmptyStmt(EmptyStmt &&other) = default;
   EmptyStmt &operator=(EmptyStmt &&other) = default;
+
+public:
+  SourceLoc loc_;
 };
 
 class IfStmt {
@@ -76,6 +85,7 @@ public:
   IfStmt() = default;
   IfStmt(IfStmt &&other) = default;
   IfStmt &operator=(IfStmt &&other) = default;
+  ~IfStmt();
 
 public:
   IfStmt(Expr cond_expr, Stmt if_stmt,
@@ -87,6 +97,7 @@ public:
   Expr cond_expr_;
   Stmt then_stmt_;
   std::optional<Stmt> else_stmt_;
+  SourceLoc loc_;
 };
 
 class Case {
@@ -94,13 +105,15 @@ public:
   Case() = default;
   Case(Case &&other) = default;
   Case &operator=(Case &&other) = default;
+  ~Case();
 
 public:
-  Case(std::vector<ConstExpr> labels, Stmt then_stmt)
+  // Labels are constants or constant ranges, e.g. "1, 3..5: ...".
+  Case(std::vector<Element> labels, Stmt then_stmt)
       : labels_(std::move(labels)), then_stmt_(std::move(then_stmt)) {}
 
 public:
-  std::vector<ConstExpr> labels_;
+  std::vector<Element> labels_;
   Stmt then_stmt_;
 };
 
@@ -117,6 +130,7 @@ public:
 public:
   Expr cond_expr_;
   std::vector<Case> cases_;
+  SourceLoc loc_;
 };
 
 class WhileStmt {
@@ -124,6 +138,7 @@ public:
   WhileStmt() = default;
   WhileStmt(WhileStmt &&other) = default;
   WhileStmt &operator=(WhileStmt &&other) = default;
+  ~WhileStmt();
 
 public:
   WhileStmt(Expr cond_expr, Stmt inner_stmt)
@@ -132,6 +147,7 @@ public:
 public:
   Expr cond_expr_;
   Stmt inner_stmt_;
+  SourceLoc loc_;
 };
 
 class RepeatStmt {
@@ -147,6 +163,7 @@ public:
 public:
   StmtSeq stmt_seq_;
   Expr cond_expr_;
+  SourceLoc loc_;
 };
 
 enum class WhichWay { To, DownTo };
@@ -156,12 +173,13 @@ public:
   ForStmt() = default;
   ForStmt(ForStmt &&other) = default;
   ForStmt &operator=(ForStmt &&other) = default;
+  ~ForStmt();
 
 public:
   ForStmt(std::string ident, Expr start_val_expr, WhichWay dir,
           Expr finish_val_expr, Stmt inner_stmt)
       : ident_(std::move(ident)), start_val_expr_(std::move(start_val_expr)),
-        finish_val_expr_(std::move(finish_val_expr)),
+        dir_(dir), finish_val_expr_(std::move(finish_val_expr)),
         inner_stmt_(std::move(inner_stmt)) {}
 
 public:
@@ -170,6 +188,12 @@ public:
   WhichWay dir_;
   Expr finish_val_expr_;
   Stmt inner_stmt_;
+  // "parallel for": iterations may run concurrently. Reductions are the
+  //   variables, that the iterations add to, each thread sums into its own
+  //   copy.
+  bool is_parallel_ = false;
+  std::vector<std::string> reductions_;
+  SourceLoc loc_;
 };
 
 class MemoryStmt {
@@ -189,6 +213,7 @@ public:
 public:
   Kind kind_;
   std::string ident_;
+  SourceLoc loc_;
 };
 
 class Assignment {
@@ -204,6 +229,7 @@ public:
 public:
   Designator designator_;
   Expr expr_;
+  SourceLoc loc_;
 };
 class ProcCall {
 public:
@@ -218,7 +244,15 @@ public:
 public:
   std::string proc_ident_;
   std::vector<Expr> params_;
+  SourceLoc loc_;
 };
 
+// Location of a statement of any kind.
+inline const SourceLoc &get_loc(const Stmt &stmt) {
+  return std::visit(
+      [](const auto &stmt_up) -> const SourceLoc & { return stmt_up->loc_; },
+      stmt);
+}
+
 } // namespace ast
 } // namespace pas
@@ -3,6 +3,7 @@
 #include <ast/const_expr.hpp>
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 #include <vector>
@@ -15,16 +16,31 @@ class ArrayType;
 class PointerType;
 class RecordType;
 class NamedType;
+class FileType;
+class TaskType;
+class ChannelType;
 
 using SetTypeUP = std::unique_ptr<SetType>;
 using ArrayTypeUP = std::unique_ptr<ArrayType>;
 using PointerTypeUP = std::unique_ptr<PointerType>;
 using RecordTypeUP = std::unique_ptr<RecordType>;
 using NamedTypeUP = std::unique_ptr<NamedType>;
-
-enum class TypeKind { Set = 0, Array = 1, Pointer = 2, Record = 3, Named = 4 };
+using FileTypeUP = std::unique_ptr<FileType>;
+using TaskTypeUP = std::unique_ptr<TaskType>;
+using ChannelTypeUP = std::unique_ptr<ChannelType>;
+
+enum class TypeKind {
+  Set = 0,
+  Array = 1,
+  Pointer = 2,
+  Record = 3,
+  Named = 4,
+  File = 5,
+  Task = 6,
+  Channel = 7
+};
 using Type = std::variant<SetTypeUP, ArrayTypeUP, PointerTypeUP, RecordTypeUP,
-                          NamedTypeUP>;
+                          NamedTypeUP, FileTypeUP, TaskTypeUP, ChannelTypeUP>;
 
 class Subrange {
 public:
@@ -106,10 +122,13 @@ public:
   RecordType &operator=(RecordType &&other) = default;
 
 public:
-  RecordType(std::vector<FieldList> field) : fields_(std::move(field)) {}
+  RecordType(std::vector<FieldList> field, bool packed = false)
+      : fields_(std::move(field)), packed_(packed) {}
 
 public:
   std::vector<FieldList> fields_;
+  // "packed record": fields are laid out as declared, without padding.
+  bool packed_ = false;
 };
 
 // An already defined type, which is referenced
@@ -127,5 +146,50 @@ public:
   std::string type_name_;
 };
 
+// "file of T", a sequence of values of type T. Text files are of the
+//   predefined type Text.
+class FileType {
+public:
+  FileType() = default;
+  FileType(FileType &&other) = default;
+  FileType &operator=(FileType &&other) = default;
+
+public:
+  FileType(Type item_type) : item_type_(std::move(item_type)) {}
+
+public:
+  Type item_type_;
+};
+
+// "task" or "task of T", a handle of a spawned procedure or function, T
+//   is the result type of the function.
+class TaskType {
+public:
+  TaskType() = default;
+  TaskType(TaskType &&other) = default;
+  TaskType &operator=(TaskType &&other) = default;
+
+public:
+  TaskType(std::optional<Type> result_type)
+      : result_type_(std::move(result_type)) {}
+
+public:
+  std::optional<Type> result_type_;
+};
+
+// "channel of T", a bounded queue of values of type T between tasks.
+class ChannelType {
+public:
+  ChannelType() = default;
+  ChannelType(ChannelType &&other) = default;
+  ChannelType &operator=(ChannelType &&other) = default;
+
+public:
+  ChannelType(Type item_type) : item_type_(std::move(item_type)) {}
+
+public:
+  Type item_type_;
+};
+
 } // namespace ast
 } // namespace pas
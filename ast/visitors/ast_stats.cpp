@@ -0,0 +1,415 @@
+#include "ast/visitors/ast_stats.hpp"
+
+#include <cassert>
+
+#include "ast/utils/get_idx.hpp"
+#include "stack_space.hpp"
+
+namespace pas {
+namespace visitor {
+
+namespace {
+
+using namespace pas::ast;
+
+class Counter {
+public:
+  AstStats stats;
+
+  void count(const CompilationUnit &cu) {
+    count_identifier(cu.pm_.program_name_);
+    count(cu.pm_.block_);
+  }
+
+private:
+  void add(AstCategory category, uint64_t nodes, uint64_t bytes) {
+    stats[category].nodes += nodes;
+    stats[category].bytes += bytes;
+  }
+
+  template <typename T>
+  void add_buffer(AstCategory category, const std::vector<T> &items) {
+    add(category, 0, items.capacity() * sizeof(T));
+  }
+
+  void count_identifier(const std::string &identifier) {
+    const char *object = reinterpret_cast<const char *>(&identifier);
+    bool is_inline = identifier.data() >= object &&
+                     identifier.data() < object + sizeof(identifier);
+    if (!is_inline) {
+      add(AstCategory::Identifier, 1, identifier.capacity() + 1);
+    }
+  }
+
+  void count_identifiers(const std::vector<std::string> &identifiers) {
+    add_buffer(AstCategory::Identifier, identifiers);
+    for (const std::string &identifier : identifiers) {
+      count_identifier(identifier);
+    }
+  }
+
+  void count(const Block &block) {
+    assert(block.decls_ != nullptr);
+    add(AstCategory::Decl, 1, sizeof(Declarations));
+    count(*block.decls_);
+    count(block.stmt_seq_);
+  }
+
+  void count(const Declarations &decls) {
+    add_buffer(AstCategory::Decl, decls.const_defs_);
+    for (const ConstDef &const_def : decls.const_defs_) {
+      add(AstCategory::Decl, 1, 0);
+      count_identifier(const_def.ident_);
+      count(const_def.const_expr_);
+    }
+    add_buffer(AstCategory::Decl, decls.type_defs_);
+    for (const TypeDef &type_def : decls.type_defs_) {
+      add(AstCategory::Decl, 1, 0);
+      count_identifier(type_def.ident_);
+      count(type_def.type_);
+    }
+    add_buffer(AstCategory::Decl, decls.var_decls_);
+    for (const VarDecl &var_decl : decls.var_decls_) {
+      add(AstCategory::Decl, 1, 0);
+      count_identifiers(var_decl.ident_list_);
+      count(var_decl.type_);
+    }
+    add_buffer(AstCategory::Decl, decls.subprog_decls_);
+    for (const SubprogDecl &subprog_decl : decls.subprog_decls_) {
+      add(AstCategory::Decl, 1, 0);
+      if (const auto *func_decl = std::get_if<FuncDecl>(&subprog_decl)) {
+        count_identifier(func_decl->ret_type_ident_);
+        count(func_decl->proc_decl_);
+      } else {
+        count(std::get<ProcDecl>(subprog_decl));
+      }
+    }
+  }
+
+  void count(const ProcDecl &proc_decl) {
+    const ProcHeading &heading = proc_decl.proc_heading_;
+    count_identifier(heading.proc_name_);
+    add_buffer(AstCategory::Decl, heading.params_);
+    for (const FormalParam &param : heading.params_) {
+      add(AstCategory::Decl, 1, 0);
+      count_identifiers(param.proc_name_);
+      count_identifier(param.type_ident_);
+    }
+    count(proc_decl.block_);
+  }
+
+  void count(const Subrange &subrange) {
+    add(AstCategory::Type, 1, 0);
+    count(subrange.start_);
+    count(subrange.finish_);
+  }
+
+  void count(const Type &type) {
+    std::visit(
+        [&](const auto &type_up) {
+          add(AstCategory::Type, 1, sizeof(*type_up));
+          count_type(*type_up);
+        },
+        type);
+  }
+
+  void count_type(const SetType &set_type) { count(set_type.subrange_); }
+
+  void count_type(const ArrayType &array_type) {
+    add_buffer(AstCategory::Type, array_type.subrange_list_);
+    for (const Subrange &subrange : array_type.subrange_list_) {
+      count(subrange);
+    }
+    count(array_type.item_type_);
+  }
+
+  void count_type(const PointerType &pointer_type) {
+    count_identifier(pointer_type.ref_type_name_);
+  }
+
+  void count_type(const RecordType &record_type) {
+    add_buffer(AstCategory::Type, record_type.fields_);
+    for (const FieldList &field_list : record_type.fields_) {
+      add(AstCategory::Type, 1, 0);
+      count_identifiers(field_list.idents_);
+      count(field_list.type_);
+    }
+  }
+
+  void count_type(const NamedType &named_type) {
+    count_identifier(named_type.type_name_);
+  }
+
+  void count_type(const FileType &file_type) { count(file_type.item_type_); }
+
+  void count_type(const TaskType &task_type) {
+    if (task_type.result_type_.has_value()) {
+      count(task_type.result_type_.value());
+    }
+  }
+
+  void count_type(const ChannelType &channel_type) {
+    count(channel_type.item_type_);
+  }
+
+  void count(const ConstFactor &factor) {
+    if (const auto *identifier = std::get_if<std::string>(&factor)) {
+      count_identifier(*identifier);
+    }
+  }
+
+  void count(const ConstExpr &const_expr) {
+    add(AstCategory::Const, 1, 0);
+    count(const_expr.factor_);
+  }
+
+  void count(const std::vector<Element> &elements) {
+    add_buffer(AstCategory::Const, elements);
+    for (const Element &element : elements) {
+      if (const auto *range =
+              std::get_if<std::pair<ConstExpr, ConstExpr>>(&element)) {
+        count(range->first);
+        count(range->second);
+      } else {
+        count(std::get<ConstExpr>(element));
+      }
+    }
+  }
+
+  void count(const StmtSeq &stmt_seq) {
+    add_buffer(AstCategory::Stmt, stmt_seq.stmts_);
+    for (const Stmt &stmt : stmt_seq.stmts_) {
+      count(stmt);
+    }
+  }
+
+  // Statements and factors are, where the tree nests, see stack_space.hpp.
+  void count(const Stmt &stmt) {
+    run_with_sufficient_stack([&]() {
+      std::visit(
+          [&](const auto &stmt_up) {
+            add(AstCategory::Stmt, 1, sizeof(*stmt_up));
+            count_stmt(*stmt_up);
+          },
+          stmt);
+    });
+  }
+
+  void count_stmt(const Assignment &assignment) {
+    count(assignment.designator_);
+    count(assignment.expr_);
+  }
+
+  void count_stmt(const ProcCall &proc_call) {
+    count_identifier(proc_call.proc_ident_);
+    count(proc_call.params_);
+  }
+
+  void count_stmt(const IfStmt &if_stmt) {
+    count(if_stmt.cond_expr_);
+    count(if_stmt.then_stmt_);
+    if (if_stmt.else_stmt_.has_value()) {
+      count(if_stmt.else_stmt_.value());
+    }
+  }
+
+  void count_stmt(const CaseStmt &case_stmt) {
+    count(case_stmt.cond_expr_);
+    add_buffer(AstCategory::Stmt, case_stmt.cases_);
+    for (const Case &case_item : case_stmt.cases_) {
+      add(AstCategory::Stmt, 1, 0);
+      count(case_item.labels_);
+      count(case_item.then_stmt_);
+    }
+  }
+
+  void count_stmt(const WhileStmt &while_stmt) {
+    count(while_stmt.cond_expr_);
+    count(while_stmt.inner_stmt_);
+  }
+
+  void count_stmt(const RepeatStmt &repeat_stmt) {
+    count(repeat_stmt.stmt_seq_);
+    count(repeat_stmt.cond_expr_);
+  }
+
+  void count_stmt(const ForStmt &for_stmt) {
+    count_identifier(for_stmt.ident_);
+    count(for_stmt.start_val_expr_);
+    count(for_stmt.finish_val_expr_);
+    count(for_stmt.inner_stmt_);
+    count_identifiers(for_stmt.reductions_);
+  }
+
+  void count_stmt(const MemoryStmt &memory_stmt) {
+    count_identifier(memory_stmt.ident_);
+  }
+
+  void count_stmt(const StmtSeq &stmt_seq) { count(stmt_seq); }
+
+  void count_stmt(const EmptyStmt &) {}
+
+  void count(const std::vector<Expr> &exprs) {
+    add_buffer(AstCategory::Expr, exprs);
+    for (const Expr &expr : exprs) {
+      count(expr);
+    }
+  }
+
+  void count(const Expr &expr) {
+    add(AstCategory::Expr, 1, 0);
+    count(expr.start_expr_);
+    if (expr.op_.has_value()) {
+      count(expr.op_->expr);
+    }
+  }
+
+  void count(const SimpleExpr &simple_expr) {
+    add(AstCategory::Expr, 1, 0);
+    count(simple_expr.start_term_);
+    add_buffer(AstCategory::Expr, simple_expr.ops_);
+    for (const SimpleExpr::Op &op : simple_expr.ops_) {
+      count(op.term);
+    }
+  }
+
+  void count(const Term &term) {
+    add(AstCategory::Expr, 1, 0);
+    count(term.start_factor_);
+    add_buffer(AstCategory::Expr, term.ops_);
+    for (const Term::Op &op : term.ops_) {
+      count(op.factor);
+    }
+  }
+
+  void count(const Factor &factor) {
+    run_with_sufficient_stack([&]() { count_factor(factor); });
+  }
+
+  void count_factor(const Factor &factor) {
+    switch (factor.index()) {
+    case get_idx(FactorKind::String):
+      add(AstCategory::Expr, 1, 0);
+      count_identifier(std::get<std::string>(factor));
+      break;
+    case get_idx(FactorKind::Designator):
+      count(std::get<Designator>(factor));
+      break;
+    case get_idx(FactorKind::Expr):
+      add(AstCategory::Expr, 0, sizeof(Expr));
+      count(*std::get<ExprUP>(factor));
+      break;
+    case get_idx(FactorKind::Negation):
+      add(AstCategory::Expr, 1, sizeof(Negation));
+      count(std::get<NegationUP>(factor)->factor_);
+      break;
+    case get_idx(FactorKind::FuncCall): {
+      const FuncCall &func_call = *std::get<FuncCallUP>(factor);
+      add(AstCategory::Expr, 1, sizeof(FuncCall));
+      count_identifier(func_call.func_ident_);
+      count(func_call.params_);
+      break;
+    }
+    case get_idx(FactorKind::SetValue):
+      add(AstCategory::Expr, 1, sizeof(SetValue));
+      count(std::get<SetValueUP>(factor)->elements_);
+      break;
+    default:
+      // Numbers, booleans and nil.
+      add(AstCategory::Expr, 1, 0);
+      break;
+    }
+  }
+
+  void count(const Designator &designator) {
+    add(AstCategory::Designator, 1, 0);
+    count_identifier(designator.ident_);
+    add_buffer(AstCategory::Designator, designator.items_);
+    for (const DesignatorItem &item : designator.items_) {
+      add(AstCategory::Designator, 1, 0);
+      if (const auto *field = std::get_if<DesignatorFieldAccess>(&item)) {
+        count_identifier(field->ident_);
+      } else if (const auto *array =
+                     std::get_if<DesignatorArrayAccess>(&item)) {
+        add_buffer(AstCategory::Designator, array->expr_list_);
+        for (const ExprUP &expr : array->expr_list_) {
+          add(AstCategory::Expr, 0, sizeof(Expr));
+          count(*expr);
+        }
+      }
+    }
+  }
+};
+
+} // namespace
+
+const char *get_ast_category_name(AstCategory category) {
+  switch (category) {
+  case AstCategory::Decl:
+    return "Decl";
+  case AstCategory::Type:
+    return "Type";
+  case AstCategory::Stmt:
+    return "Stmt";
+  case AstCategory::Expr:
+    return "Expr";
+  case AstCategory::Designator:
+    return "Designator";
+  case AstCategory::Const:
+    return "Const";
+  case AstCategory::Identifier:
+    return "Identifier";
+  }
+  assert(false);
+  __builtin_unreachable();
+}
+
+AstStats count_ast_memory(const pas::ast::CompilationUnit &cu) {
+  Counter counter;
+  counter.count(cu);
+  return counter.stats;
+}
+
+std::vector<std::pair<std::string, size_t>> get_ast_type_sizes() {
+#define AST_TYPE_SIZE(type) {#type, sizeof(pas::ast::type)}
+  return {
+      AST_TYPE_SIZE(Stmt),
+      AST_TYPE_SIZE(Assignment),
+      AST_TYPE_SIZE(ProcCall),
+      AST_TYPE_SIZE(IfStmt),
+      AST_TYPE_SIZE(CaseStmt),
+      AST_TYPE_SIZE(Case),
+      AST_TYPE_SIZE(WhileStmt),
+      AST_TYPE_SIZE(RepeatStmt),
+      AST_TYPE_SIZE(ForStmt),
+      AST_TYPE_SIZE(MemoryStmt),
+      AST_TYPE_SIZE(StmtSeq),
+      AST_TYPE_SIZE(EmptyStmt),
+      AST_TYPE_SIZE(Expr),
+      AST_TYPE_SIZE(SimpleExpr),
+      AST_TYPE_SIZE(Term),
+      AST_TYPE_SIZE(Factor),
+      AST_TYPE_SIZE(Negation),
+      AST_TYPE_SIZE(FuncCall),
+      AST_TYPE_SIZE(SetValue),
+      AST_TYPE_SIZE(Designator),
+      AST_TYPE_SIZE(DesignatorItem),
+      AST_TYPE_SIZE(Type),
+      AST_TYPE_SIZE(Subrange),
+      AST_TYPE_SIZE(ArrayType),
+      AST_TYPE_SIZE(RecordType),
+      AST_TYPE_SIZE(FieldList),
+      AST_TYPE_SIZE(ConstExpr),
+      AST_TYPE_SIZE(ConstFactor),
+      AST_TYPE_SIZE(Element),
+      AST_TYPE_SIZE(Declarations),
+      AST_TYPE_SIZE(VarDecl),
+      AST_TYPE_SIZE(TypeDef),
+      AST_TYPE_SIZE(SubprogDecl),
+      AST_TYPE_SIZE(Block),
+  };
+#undef AST_TYPE_SIZE
+}
+
+} // namespace visitor
+} // namespace pas
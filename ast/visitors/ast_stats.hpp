@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.hpp"
+
+// Memory of the AST (-fmem-report). Bytes of a category are the heap, that
+//   its nodes own: the nodes, that are allocated separately, buffers of the
+//   vectors of them and strings, that don't fit inline. Nodes, that are
+//   inline in others (e.g. Expr of an Assignment), are in the bytes of
+//   those.
+
+namespace pas {
+namespace visitor {
+
+enum class AstCategory {
+  Decl = 0,
+  Type = 1,
+  Stmt = 2,
+  Expr = 3,
+  Designator = 4,
+  Const = 5,
+  // Names, that don't fit into the inline buffer of std::string.
+  Identifier = 6
+};
+constexpr size_t kNumAstCategories = 7;
+
+const char *get_ast_category_name(AstCategory category);
+
+struct AstCategoryStats {
+  uint64_t nodes = 0;
+  uint64_t bytes = 0;
+};
+
+struct AstStats {
+  std::array<AstCategoryStats, kNumAstCategories> categories;
+
+  AstCategoryStats &operator[](AstCategory category) {
+    return categories[static_cast<size_t>(category)];
+  }
+  const AstCategoryStats &operator[](AstCategory category) const {
+    return categories[static_cast<size_t>(category)];
+  }
+};
+
+AstStats count_ast_memory(const pas::ast::CompilationUnit &cu);
+
+// Sizes of the node types and of the variants, that hold them, so that a
+//   layout regression is noticed.
+std::vector<std::pair<std::string, size_t>> get_ast_type_sizes();
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,194 @@
+#include "ast/visitors/escape_analysis.hpp"
+
+#include <cassert>
+
+#include "ast/utils/get_idx.hpp"
+#include "stack_space.hpp"
+
+namespace pas {
+namespace visitor {
+
+std::unordered_set<std::string>
+EscapeAnalysis::run(pas::ast::StmtSeq &body) {
+  visit(body);
+
+  std::unordered_set<std::string> result;
+  for (const std::string &ident : allocated_) {
+    if (!escaped_.contains(ident)) {
+      result.insert(ident);
+    }
+  }
+  return result;
+}
+
+void EscapeAnalysis::visit(pas::ast::Assignment &assignment) {
+  if (assignment.designator_.items_.empty()) {
+    escaped_.insert(assignment.designator_.ident_);
+  } else {
+    visit(assignment.designator_);
+  }
+  visit(assignment.expr_);
+}
+
+void EscapeAnalysis::visit(pas::ast::ProcCall &proc_call) {
+  for (pas::ast::Expr &param : proc_call.params_) {
+    visit(param);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::StmtSeq &stmt_seq) {
+  for (pas::ast::Stmt &stmt : stmt_seq.stmts_) {
+    visit_nested(stmt);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::IfStmt &if_stmt) {
+  visit(if_stmt.cond_expr_);
+  visit_nested(if_stmt.then_stmt_);
+  if (if_stmt.else_stmt_.has_value()) {
+    visit_nested(if_stmt.else_stmt_.value());
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::CaseStmt &case_stmt) {
+  visit(case_stmt.cond_expr_);
+  for (pas::ast::Case &case_item : case_stmt.cases_) {
+    visit_nested(case_item.then_stmt_);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::WhileStmt &while_stmt) {
+  visit(while_stmt.cond_expr_);
+  visit_nested(while_stmt.inner_stmt_);
+}
+
+void EscapeAnalysis::visit(pas::ast::RepeatStmt &repeat_stmt) {
+  visit(repeat_stmt.stmt_seq_);
+  visit(repeat_stmt.cond_expr_);
+}
+
+void EscapeAnalysis::visit(pas::ast::ForStmt &for_stmt) {
+  escaped_.insert(for_stmt.ident_);
+  visit(for_stmt.start_val_expr_);
+  visit(for_stmt.finish_val_expr_);
+  bool was_in_parallel_loop = in_parallel_loop_;
+  in_parallel_loop_ = in_parallel_loop_ || for_stmt.is_parallel_;
+  visit_nested(for_stmt.inner_stmt_);
+  in_parallel_loop_ = was_in_parallel_loop;
+}
+
+void EscapeAnalysis::visit(pas::ast::MemoryStmt &memory_stmt) {
+  // Bodies of parallel loops are separate functions, run by other threads.
+  if (in_parallel_loop_) {
+    escaped_.insert(memory_stmt.ident_);
+    return;
+  }
+  if (memory_stmt.kind_ == pas::ast::MemoryStmt::Kind::New &&
+      candidates_.contains(memory_stmt.ident_)) {
+    allocated_.insert(memory_stmt.ident_);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::EmptyStmt &empty_stmt) {}
+
+void EscapeAnalysis::visit(pas::ast::Expr &expr) {
+  // Comparison of pointers (p <> nil) doesn't leak them.
+  bool is_comparison =
+      expr.op_.has_value() && (expr.op_->rel == pas::ast::RelOp::Equal ||
+                               expr.op_->rel == pas::ast::RelOp::NotEqual);
+  if (!is_comparison || as_candidate(expr.start_expr_) == nullptr) {
+    visit(expr.start_expr_);
+  }
+  if (expr.op_.has_value() &&
+      (!is_comparison || as_candidate(expr.op_->expr) == nullptr)) {
+    visit(expr.op_->expr);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::SimpleExpr &simple_expr) {
+  visit(simple_expr.start_term_);
+  for (pas::ast::SimpleExpr::Op &op : simple_expr.ops_) {
+    visit(op.term);
+  }
+}
+
+void EscapeAnalysis::visit(pas::ast::Term &term) {
+  visit(term.start_factor_);
+  for (pas::ast::Term::Op &op : term.ops_) {
+    visit(op.factor);
+  }
+}
+
+// Statements and factors are, where the tree nests, see stack_space.hpp.
+void EscapeAnalysis::visit_nested(pas::ast::Stmt &stmt) {
+  run_with_sufficient_stack([&]() { visit_stmt(*this, stmt); });
+}
+
+void EscapeAnalysis::visit(pas::ast::Factor &factor) {
+  run_with_sufficient_stack([&]() { visit_factor(factor); });
+}
+
+void EscapeAnalysis::visit_factor(pas::ast::Factor &factor) {
+  switch (factor.index()) {
+  case get_idx(pas::ast::FactorKind::Designator): {
+    auto &designator = std::get<pas::ast::Designator>(factor);
+    if (designator.items_.empty()) {
+      escaped_.insert(designator.ident_);
+    } else {
+      visit(designator);
+    }
+    break;
+  }
+  case get_idx(pas::ast::FactorKind::Expr): {
+    visit(*std::get<pas::ast::ExprUP>(factor));
+    break;
+  }
+  case get_idx(pas::ast::FactorKind::Negation): {
+    visit(std::get<pas::ast::NegationUP>(factor)->factor_);
+    break;
+  }
+  case get_idx(pas::ast::FactorKind::FuncCall): {
+    for (pas::ast::Expr &param :
+         std::get<pas::ast::FuncCallUP>(factor)->params_) {
+      visit(param);
+    }
+    break;
+  }
+  default:
+    // Constants.
+    break;
+  }
+}
+
+// The designator has items, so the value of the variable itself is not
+//   copied, only the indices are evaluated.
+void EscapeAnalysis::visit(pas::ast::Designator &designator) {
+  for (pas::ast::DesignatorItem &item : designator.items_) {
+    if (item.index() == get_idx(pas::ast::DesignatorItemKind::ArrayAccess)) {
+      for (pas::ast::ExprUP &index :
+           std::get<pas::ast::DesignatorArrayAccess>(item).expr_list_) {
+        visit(*index);
+      }
+    }
+  }
+}
+
+const std::string *
+EscapeAnalysis::as_candidate(pas::ast::SimpleExpr &simple_expr) {
+  if (simple_expr.unary_op_.has_value() || !simple_expr.ops_.empty() ||
+      !simple_expr.start_term_.ops_.empty()) {
+    return nullptr;
+  }
+  pas::ast::Factor &factor = simple_expr.start_term_.start_factor_;
+  if (factor.index() != get_idx(pas::ast::FactorKind::Designator)) {
+    return nullptr;
+  }
+  auto &designator = std::get<pas::ast::Designator>(factor);
+  if (!designator.items_.empty() || !candidates_.contains(designator.ident_)) {
+    return nullptr;
+  }
+  return &designator.ident_;
+}
+
+} // namespace visitor
+} // namespace pas
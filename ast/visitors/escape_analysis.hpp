@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+
+#include "ast/ast.hpp"
+#include "ast/visit.hpp"
+
+namespace pas {
+namespace visitor {
+
+// Finds local pointer variables of a procedure, whose New'd objects never
+//   escape it, so that they can live on the stack.
+// There is no address-of operator, so the only way to keep a reference to
+//   an object is to copy the pointer value itself. An object escapes, if
+//   its pointer variable is read as a whole anywhere except comparisons:
+//   assigned to something else, stored into a field, passed as a var
+//   parameter (the callee may store it). Dereferences (p^.x) and passing
+//   the fields by reference are fine, the callee can't keep the address.
+//   A variable, that is assigned to (p := q), is not a candidate either:
+//   then Dispose(p) may free an object from the heap. New and Dispose
+//   inside of parallel loops allocate on the heap too.
+class EscapeAnalysis {
+public:
+  // Candidates are local pointer variables of the procedure, parameters and
+  //   globals are visible outside, so they escape anyway.
+  EscapeAnalysis(std::unordered_set<std::string> candidates)
+      : candidates_(std::move(candidates)) {}
+
+  // Returns candidates, that are allocated with New in the body and don't
+  //   escape.
+  std::unordered_set<std::string> run(pas::ast::StmtSeq &body);
+
+private:
+  MAKE_VISIT_STMT_FRIEND();
+
+  void visit(pas::ast::Assignment &assignment);
+  void visit(pas::ast::ProcCall &proc_call);
+  void visit(pas::ast::StmtSeq &stmt_seq);
+  void visit(pas::ast::IfStmt &if_stmt);
+  void visit(pas::ast::CaseStmt &case_stmt);
+  void visit(pas::ast::WhileStmt &while_stmt);
+  void visit(pas::ast::RepeatStmt &repeat_stmt);
+  void visit(pas::ast::ForStmt &for_stmt);
+  void visit(pas::ast::MemoryStmt &memory_stmt);
+  void visit(pas::ast::EmptyStmt &empty_stmt);
+  void visit_nested(pas::ast::Stmt &stmt);
+
+  void visit(pas::ast::Expr &expr);
+  void visit(pas::ast::SimpleExpr &simple_expr);
+  void visit(pas::ast::Term &term);
+  void visit(pas::ast::Factor &factor);
+  void visit_factor(pas::ast::Factor &factor);
+  void visit(pas::ast::Designator &designator);
+
+  // Returns the variable, if the expression is just a candidate itself.
+  const std::string *as_candidate(pas::ast::SimpleExpr &simple_expr);
+
+private:
+  std::unordered_set<std::string> candidates_;
+  std::unordered_set<std::string> allocated_;
+  std::unordered_set<std::string> escaped_;
+  bool in_parallel_loop_ = false;
+};
+
+} // namespace visitor
+} // namespace pas
@@ -1,11 +1,13 @@
 #include "ast/visitors/lowerer.hpp"
 
+#include <algorithm>
 #include <memory> // std::unique_ptr
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
@@ -15,6 +17,7 @@
 #include "ast/visit.hpp"
 
 #include "exceptions.hpp"
+#include "stack_space.hpp"
 
 namespace pas {
 namespace visitor {
@@ -22,21 +25,34 @@ namespace visitor {
 // auto Lowerer::FunctionDeleter = decltype(Lowerer::FunctionDeleter)();
 
 Lowerer::Lowerer(llvm::LLVMContext &context, const std::string &file_name,
-                 pas::ast::CompilationUnit &cu)
-    : context_(context) {
+                 pas::ast::CompilationUnit &cu, const Options &options)
+    : context_(context), options_(options) {
 
   // ; ModuleID = 'top'
   // source_filename = "top"
   module_uptr_ = std::make_unique<llvm::Module>("top", context_);
+  if (options_.debug_info) {
+    create_debug_compile_unit(file_name);
+  }
 
   // Заводим пространство имен предопределенных символов.
   //   Это встроенные типы и встроенные функции.
   pascal_scopes_.emplace_back();
 
   // Add unique original names for basic types.
-  pascal_scopes_.back()["Integer"] = TypeKind::Integer;
-  pascal_scopes_.back()["Char"] = TypeKind::Char;
-  pascal_scopes_.back()["String"] = TypeKind::String;
+  integer_type_ = std::make_shared<Type>(Type{TypeKind::Integer});
+  char_type_ = std::make_shared<Type>(Type{TypeKind::Char});
+  string_type_ = std::make_shared<Type>(Type{TypeKind::String});
+  boolean_type_ = std::make_shared<Type>(Type{TypeKind::Boolean});
+  real_type_ = std::make_shared<Type>(Type{TypeKind::Real});
+  nil_type_ = std::make_shared<Type>(Type{TypeKind::Pointer});
+  text_type_ = std::make_shared<Type>(Type{TypeKind::File});
+  pascal_scopes_.back()["Integer"] = integer_type_;
+  pascal_scopes_.back()["Char"] = char_type_;
+  pascal_scopes_.back()["String"] = string_type_;
+  pascal_scopes_.back()["Boolean"] = boolean_type_;
+  pascal_scopes_.back()["Real"] = real_type_;
+  pascal_scopes_.back()["Text"] = text_type_;
 
   // Заводим глобальное пространство имен, его контролирует программа.
   pascal_scopes_.emplace_back();
@@ -47,31 +63,51 @@ Lowerer::Lowerer(llvm::LLVMContext &context, const std::string &file_name,
   //   локально, а не бегая по этому большому файлу.
 
   visit(cu);
+  if (di_builder_ != nullptr) {
+    di_builder_->finalize();
+  }
+  close_scope();
+  close_scope();
 }
 
 std::unique_ptr<llvm::Module> Lowerer::release_module() {
   return std::move(module_uptr_);
 }
 
+void Lowerer::close_scope() {
+  size_t visible_symbols = 0;
+  size_t bytes = 0;
+  for (const auto &scope : pascal_scopes_) {
+    visible_symbols += scope.size();
+    // A bucket is a pointer, a node is the entry and the link to the next.
+    bytes += scope.bucket_count() * sizeof(void *) +
+             scope.size() * (sizeof(std::pair<const PascalIdent, Decl>) +
+                             sizeof(void *));
+  }
+  scope_stats_.scopes += 1;
+  scope_stats_.max_depth =
+      std::max(scope_stats_.max_depth, pascal_scopes_.size());
+  scope_stats_.symbols += pascal_scopes_.back().size();
+  scope_stats_.max_visible_symbols =
+      std::max(scope_stats_.max_visible_symbols, visible_symbols);
+  scope_stats_.max_bytes = std::max(scope_stats_.max_bytes, bytes);
+  pascal_scopes_.pop_back();
+}
+
 void Lowerer::visit(pas::ast::CompilationUnit &cu) { visit(cu.pm_); }
 
-void Lowerer::visit(pas::ast::ProgramModule &pm) { visit_toplevel(pm.block_); }
+void Lowerer::visit(pas::ast::ProgramModule &pm) { visit_toplevel(pm); }
 
-void Lowerer::visit_toplevel(pas::ast::Block &block) {
+void Lowerer::visit_toplevel(pas::ast::ProgramModule &pm) {
+  pas::ast::Block &block = pm.block_;
   // Decl field should always be there, it can just have
   //   no actual decls inside.
   assert(block.decls_.get() != nullptr);
 
-  if (!block.decls_->subprog_decls_.empty()) {
-    throw pas::NotImplementedException(
-        "function decls are not implemented yet");
-  }
   if (!block.decls_->const_defs_.empty()) {
     throw pas::NotImplementedException("const defs are not implemented yet");
   }
 
-  // All subfunctions were generated, let's codegen the main function.
-
   llvm::IRBuilder<> main_func_builder(context_);
 
   // declare void @main()
@@ -81,50 +117,99 @@ void Lowerer::visit_toplevel(pas::ast::Block &block) {
   //   Won't free it in any specific way. It's a good think to have create.
   //   We didn't allocate with new, so we don't free it with delete. It's
   //   not our responsibility.
+  //   Created before the subprograms, so that a procedure named main gets
+  //   renamed, not the entry point.
   auto main_func =
       llvm::Function::Create(main_func_type, llvm::Function::ExternalLinkage,
                              "main", module_uptr_.get());
   // https://stackoverflow.com/a/10444311
 
-  // entrypoint:
-  auto entry = llvm::BasicBlock::Create(context_, "entrypoint", main_func);
-  main_func_builder.SetInsertPoint(entry);
-
-  // Declare builtin functions.
-  //   https://stackoverflow.com/a/22310371
-  std::vector<llvm::Type *> write_int_args = {main_func_builder.getInt32Ty()};
-  llvm::FunctionType *write_int_type = llvm::FunctionType::get(
-      main_func_builder.getVoidTy(), write_int_args, false);
-  llvm::Function::Create(write_int_type, llvm::Function::ExternalLinkage,
-                         "write_int", module_uptr_.get());
-
-  // llvm::FunctionType выдалется с помощью placement new в памяти внутри
-  //   контекста. Потому освободится вместе с контекстом. А наличие вызова
-  //   деструктора санитайзеры видимо не проверяют, т.к. это
-  //   библиотека, она уже скомпилирована и проверки туда не вставить.
-
-  current_func_ = main_func;
-  current_func_builder_ = &main_func_builder;
-
   for (auto &type_def : block.decls_->type_defs_) {
     process_type_def(type_def);
   }
+  resolve_pointer_types();
   for (auto &var_decl : block.decls_->var_decls_) {
     process_var_decl(var_decl);
   }
+  resolve_pointer_types();
+
+  for (auto &subprog_decl : block.decls_->subprog_decls_) {
+    declare_subprogram(subprog_decl);
+  }
+  for (auto &subprog_decl : block.decls_->subprog_decls_) {
+    lower_subprogram(subprog_decl);
+  }
+
+  // All subfunctions were generated, let's codegen the main function.
+
+  // entrypoint:
+  auto entry = llvm::BasicBlock::Create(context_, "entrypoint", main_func);
+  main_func_builder.SetInsertPoint(entry);
+
+  current_func_ = main_func;
+  current_func_builder_ = &main_func_builder;
+  set_fast_math(main_func, main_func_builder);
+  alloc_cache_ = nullptr;
+  stack_objects_.clear();
+  create_debug_subprogram(main_func, pm.program_name_, pm.loc_);
+  begin_profile_function(pm.loc_);
+  codegen_budget_start();
 
   visit(block.stmt_seq_);
 
+  release_variables(block.decls_->var_decls_);
+  codegen_profile_write();
   current_func_builder_->CreateRet(current_func_builder_->getInt32(0));
+  finalize_debug_subprogram();
+  add_profile_summary();
 
   current_func_ = nullptr;
   current_func_builder_ = nullptr;
 }
 
+// Strings and files of the variables are released in the order of
+//   declaration. Files are closed then.
+void Lowerer::release_variables(std::vector<pas::ast::VarDecl> &var_decls) {
+  for (auto &var_decl : var_decls) {
+    for (const std::string &ident : var_decl.ident_list_) {
+      Variable &variable = std::get<Variable>(pascal_scopes_.back()[ident]);
+      if (contains_string(variable.type)) {
+        codegen_for_each_string(variable.allocation, variable.type,
+                                "pas_string_release");
+      }
+      if (variable.type->kind == TypeKind::File) {
+        current_func_builder_->CreateCall(
+            get_runtime_function("pas_file_release",
+                                 current_func_builder_->getVoidTy(),
+                                 {get_llvm_file_type()->getPointerTo()}),
+            {variable.allocation});
+      }
+    }
+  }
+}
+
 void Lowerer::visit(pas::ast::StmtSeq &stmt_seq) {
   for (pas::ast::Stmt &stmt : stmt_seq.stmts_) {
-    visit_stmt(*this, stmt);
+    lower_stmt(stmt);
+  }
+}
+
+void Lowerer::lower_stmt(pas::ast::Stmt &stmt) {
+  // Code after the inner statements of loops and ifs belongs to them.
+  llvm::DebugLoc outer_location =
+      current_func_builder_->getCurrentDebugLocation();
+  const pas::ast::SourceLoc &loc = pas::ast::get_loc(stmt);
+  set_debug_location(loc);
+  try {
+    // Statements nest recursively, see stack_space.hpp.
+    run_with_sufficient_stack([&]() { visit_stmt(*this, stmt); });
+  } catch (pas::DescribedException &exc) {
+    if (exc.line() == 0) {
+      exc.set_location(loc.line, loc.column);
+    }
+    throw;
   }
+  current_func_builder_->SetCurrentDebugLocation(outer_location);
 }
 
 void Lowerer::process_decls(pas::ast::Declarations &decls) {
@@ -138,22 +223,143 @@ void Lowerer::process_decls(pas::ast::Declarations &decls) {
   for (auto &type_def : decls.type_defs_) {
     process_type_def(type_def);
   }
+  resolve_pointer_types();
   for (auto &var_decl : decls.var_decls_) {
     process_var_decl(var_decl);
   }
+  resolve_pointer_types();
+}
+
+void Lowerer::process_type_def(pas::ast::TypeDef &type_def) {
+  if (pascal_scopes_.back().contains(type_def.ident_)) {
+    throw pas::SemanticProblemException("identifier is already in use: " +
+                                        type_def.ident_);
+  }
+  pascal_scopes_.back()[type_def.ident_] =
+      make_type_from_ast_type(type_def.type_);
+}
+
+llvm::Type *Lowerer::get_llvm_type_by_lang_type(const TypeSP &type) {
+  switch (type->kind) {
+  case TypeKind::Integer:
+    return llvm::Type::getInt32Ty(context_);
+  case TypeKind::Char:
+    return llvm::Type::getInt8Ty(context_);
+  case TypeKind::String:
+    return get_llvm_string_type();
+  case TypeKind::Boolean:
+    return llvm::Type::getInt1Ty(context_);
+  case TypeKind::Real:
+    return llvm::Type::getDoubleTy(context_);
+  // All pointers are i8*, so that recursive types (linked lists) don't
+  //   make recursive LLVM types. Casted to the referenced type on access.
+  case TypeKind::Pointer:
+  case TypeKind::Task:
+  case TypeKind::Channel:
+    return llvm::Type::getInt8Ty(context_)->getPointerTo();
+  case TypeKind::Array: {
+    uint64_t num_items =
+        static_cast<int64_t>(type->bounds.high) - type->bounds.low + 1;
+    return llvm::ArrayType::get(get_llvm_type_by_lang_type(type->item_type),
+                                num_items);
+  }
+  case TypeKind::Set:
+    return get_llvm_set_type(type->bounds);
+  case TypeKind::File:
+    return get_llvm_file_type();
+  case TypeKind::Record: {
+    std::vector<llvm::Type *> elements(type->fields.size());
+    for (const Field &field : type->fields) {
+      elements[field.index] = get_llvm_type_by_lang_type(field.type);
+    }
+    return llvm::StructType::get(context_, elements, type->packed);
+  }
+
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
 }
 
-void Lowerer::process_type_def(pas::ast::TypeDef &type_def) {}
+uint64_t Lowerer::get_type_alignment(const TypeSP &type) {
+  switch (type->kind) {
+  case TypeKind::Integer:
+    return 4;
+  case TypeKind::Char:
+  case TypeKind::Boolean:
+    return 1;
+  case TypeKind::String:
+  case TypeKind::Pointer:
+  case TypeKind::File:
+  case TypeKind::Real:
+  case TypeKind::Task:
+  case TypeKind::Channel:
+    return 8;
+  case TypeKind::Array:
+    return get_type_alignment(type->item_type);
+  case TypeKind::Set: {
+    // Vectors are aligned to their size.
+    llvm::Type *set_type = get_llvm_set_type(type->bounds);
+    if (auto *vector_type = llvm::dyn_cast<llvm::FixedVectorType>(set_type)) {
+      return llvm::PowerOf2Ceil(vector_type->getNumElements() * 8);
+    }
+    return set_type->getIntegerBitWidth() / 8;
+  }
+  case TypeKind::Record: {
+    if (type->packed) {
+      return 1;
+    }
+    uint64_t alignment = 1;
+    for (const Field &field : type->fields) {
+      alignment = std::max(alignment, get_type_alignment(field.type));
+    }
+    return alignment;
+  }
+
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
 
-llvm::Type *Lowerer::get_llvm_type_by_lang_type(TypeKind type) {
-  switch (type) {
+// Mirrors the layout, that LLVM makes for the type on 64-bit targets.
+uint64_t Lowerer::get_type_size(const TypeSP &type) {
+  switch (type->kind) {
   case TypeKind::Integer:
-    return current_func_builder_->getInt32Ty();
+    return 4;
   case TypeKind::Char:
-    return current_func_builder_->getInt8Ty();
+  case TypeKind::Boolean:
+    return 1;
   case TypeKind::String:
-    return current_func_builder_->getInt8Ty()->getPointerTo();
-    // case TypeKind::Pointer: return current_func_builder_->getPtrTy();
+  case TypeKind::File:
+    return 24;
+  case TypeKind::Pointer:
+  case TypeKind::Real:
+  case TypeKind::Task:
+  case TypeKind::Channel:
+    return 8;
+  case TypeKind::Array: {
+    uint64_t num_items =
+        static_cast<int64_t>(type->bounds.high) - type->bounds.low + 1;
+    return num_items * get_type_size(type->item_type);
+  }
+  case TypeKind::Set:
+    // Sizes of sets are powers of 2, same as the alignment.
+    return get_type_alignment(type);
+  case TypeKind::Record: {
+    std::vector<const Field *> layout(type->fields.size());
+    for (const Field &field : type->fields) {
+      layout[field.index] = &field;
+    }
+    uint64_t size = 0;
+    for (const Field *field : layout) {
+      if (!type->packed) {
+        size = llvm::alignTo(size, get_type_alignment(field->type));
+      }
+      size += get_type_size(field->type);
+    }
+    return llvm::alignTo(size, get_type_alignment(type));
+  }
 
   default:
     assert(false);
@@ -161,73 +367,129 @@ llvm::Type *Lowerer::get_llvm_type_by_lang_type(TypeKind type) {
   }
 }
 
-llvm::AllocaInst *Lowerer::codegen_alloc_value_of_type(TypeKind type) {
+llvm::AllocaInst *Lowerer::codegen_alloc_value_of_type(const TypeSP &type) {
   return current_func_builder_->CreateAlloca(get_llvm_type_by_lang_type(type));
 }
 
-pas::visitor::Lowerer::TypeKind
+int Lowerer::eval_const_factor(pas::ast::ConstFactor &const_factor) {
+  switch (const_factor.index()) {
+  case get_idx(pas::ast::ConstFactorKind::Number): {
+    return std::get<int>(const_factor);
+  }
+  case get_idx(pas::ast::ConstFactorKind::Bool): {
+    return std::get<bool>(const_factor) ? 1 : 0;
+  }
+  case get_idx(pas::ast::ConstFactorKind::Identifier): {
+    throw pas::NotImplementedException("const defs are not implemented yet");
+  }
+  case get_idx(pas::ast::ConstFactorKind::Nil): {
+    throw pas::SemanticProblemException(
+        "nil can't be used as an ordinal constant");
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
+
+int Lowerer::eval_const_expr(pas::ast::ConstExpr &const_expr) {
+  int value = eval_const_factor(const_expr.factor_);
+  if (const_expr.unary_op_ == pas::ast::UnaryOp::Minus) {
+    return -value;
+  }
+  return value;
+}
+
+pas::visitor::Lowerer::TypeSP
 Lowerer::make_type_from_ast_type(pas::ast::Type &ast_type) {
   size_t type_index = ast_type.index();
 
   switch (type_index) {
-  case get_idx(pas::ast::TypeKind::Array):
-  case get_idx(pas::ast::TypeKind::Record):
+  case get_idx(pas::ast::TypeKind::Array): {
+    auto &array_type = *std::get<pas::ast::ArrayTypeUP>(ast_type);
+    TypeSP type = make_type_from_ast_type(array_type.item_type_);
+    if (type->kind == TypeKind::File) {
+      throw pas::NotImplementedException("arrays of files are not supported");
+    }
+
+    // Unfold "array[A, B] of T" into "array[A] of array[B] of T",
+    //   starting from the innermost dimension.
+    for (auto it = array_type.subrange_list_.rbegin();
+         it != array_type.subrange_list_.rend(); ++it) {
+      Bounds bounds = {eval_const_factor(it->start_),
+                       eval_const_factor(it->finish_)};
+      if (bounds.low > bounds.high) {
+        throw pas::SemanticProblemException(
+            "array index subrange is empty: " + std::to_string(bounds.low) +
+            ".." + std::to_string(bounds.high));
+      }
+      type = std::make_shared<Type>(Type{TypeKind::Array, bounds, type});
+    }
+    return type;
+  }
   case get_idx(pas::ast::TypeKind::Set): {
-    //      throw NotImplementedException(
-    //          "only pointer types, basic types (Integer, Char) and their
-    //          synonims " "are supported for now");
-    throw pas::NotImplementedException(
-        "only basic types (Integer, Char) and strings are supported for now");
+    auto &set_type = *std::get<pas::ast::SetTypeUP>(ast_type);
+    Bounds bounds = {eval_const_factor(set_type.subrange_.start_),
+                     eval_const_factor(set_type.subrange_.finish_)};
+    if (bounds.low > bounds.high) {
+      throw pas::SemanticProblemException(
+          "set base subrange is empty: " + std::to_string(bounds.low) + ".." +
+          std::to_string(bounds.high));
+    }
+    if (static_cast<int64_t>(bounds.high) - bounds.low + 1 >
+        kMaxSetElements) {
+      throw pas::SemanticProblemException(
+          "set base subrange is too large, at most " +
+          std::to_string(kMaxSetElements) + " elements are allowed");
+    }
+    return std::make_shared<Type>(Type{TypeKind::Set, bounds});
+  }
+  case get_idx(pas::ast::TypeKind::Record): {
+    return make_record_type(*std::get<pas::ast::RecordTypeUP>(ast_type));
   }
   case get_idx(pas::ast::TypeKind::Pointer): {
-    throw pas::NotImplementedException("pointer types are not supported now");
-  }
-
-  //    case get_idx(pas::ast::TypeKind::Pointer): {
-  //      const auto &ptr_type_up = std::get<pas::ast::PointerTypeUP>(type);
-  //      const pas::ast::PointerType &ptr_type = *ptr_type_up;
-  //      if (!ident_to_item_.contains(ptr_type.ref_type_name_)) {
-  //        throw SemanticProblemException(
-  //            "pointer type references an undeclared identifier: " +
-  //            ptr_type.ref_type_name_);
-  //      }
-  //      std::variant<std::shared_ptr<Type>, std::shared_ptr<Value>> item =
-  //          ident_to_item_[ptr_type.ref_type_name_];
-  //      if (item.index() != 0) {
-  //        throw SemanticProblemException(
-  //            "pointer type must reference a type, not a value: " +
-  //            ptr_type.ref_type_name_);
-  //      }
-  //      auto type_item = std::get<std::shared_ptr<Type>>(item);
-  //      auto pointer_type =
-  //      std::make_shared<PointerType>(PointerType{type_item}); auto
-  //      new_type_item = std::make_shared<Type>(pointer_type); return
-  //      new_type_item; break;
-  //    }
+    const std::string &ref_type_name =
+        std::get<pas::ast::PointerTypeUP>(ast_type)->ref_type_name_;
+    auto type = std::make_shared<Type>(Type{TypeKind::Pointer});
+    Decl *refd_type = lookup_decl(ref_type_name);
+    if (refd_type == nullptr) {
+      unresolved_pointer_types_.emplace_back(type, ref_type_name);
+    } else if (refd_type->index() != 0) {
+      throw pas::SemanticProblemException(
+          "pointer type must reference a type, not a value: " +
+          ref_type_name);
+    } else {
+      type->item_type = std::get<TypeSP>(*refd_type);
+    }
+    return type;
+  }
+  case get_idx(pas::ast::TypeKind::File): {
+    return make_file_type(*std::get<pas::ast::FileTypeUP>(ast_type));
+  }
+  case get_idx(pas::ast::TypeKind::Task): {
+    return make_task_type(*std::get<pas::ast::TaskTypeUP>(ast_type));
+  }
+  case get_idx(pas::ast::TypeKind::Channel): {
+    return make_channel_type(*std::get<pas::ast::ChannelTypeUP>(ast_type));
+  }
   case get_idx(pas::ast::TypeKind::Named): {
     const auto &named_type_up = std::get<pas::ast::NamedTypeUP>(ast_type);
     const pas::ast::NamedType &named_type = *named_type_up;
-    std::optional<std::variant<TypeKind, Variable>> refd_type;
-    for (auto &scope : pascal_scopes_) {
-      if (scope.contains(named_type.type_name_)) {
-        refd_type = scope[named_type.type_name_];
-      }
-    }
+    Decl *refd_type = lookup_decl(named_type.type_name_);
 
-    if (!refd_type.has_value()) {
+    if (refd_type == nullptr) {
       throw pas::SemanticProblemException(
           "named type references an undeclared identifier: " +
           named_type.type_name_);
     }
 
-    if (refd_type.value().index() != 0) {
+    if (refd_type->index() != 0) {
       throw pas::SemanticProblemException(
           "named type must reference a type, not a value: " +
           named_type.type_name_);
     }
 
-    auto type = std::get<TypeKind>(refd_type.value());
-    return type;
+    return std::get<TypeSP>(*refd_type);
   }
   default: {
     assert(false);
@@ -236,32 +498,439 @@ Lowerer::make_type_from_ast_type(pas::ast::Type &ast_type) {
   }
 }
 
+// Fields of a plain record are sorted by decreasing alignment. Every size is
+//   a multiple of the alignment, so each field starts right where the
+//   previous one ends, and the only padding left is at the tail. Packed
+//   records keep the declared order and have no padding at all (byte
+//   packed), for the cases, when layout matters more than access speed.
+Lowerer::TypeSP
+Lowerer::make_record_type(pas::ast::RecordType &record_type) {
+  auto type = std::make_shared<Type>(Type{TypeKind::Record});
+  type->packed = record_type.packed_;
+
+  for (pas::ast::FieldList &field_list : record_type.fields_) {
+    TypeSP field_type = make_type_from_ast_type(field_list.type_);
+    if (field_type->kind == TypeKind::File) {
+      throw pas::NotImplementedException(
+          "files inside of records are not supported");
+    }
+    for (const std::string &ident : field_list.idents_) {
+      for (const Field &field : type->fields) {
+        if (field.name == ident) {
+          throw pas::SemanticProblemException("duplicate record field: " +
+                                              ident);
+        }
+      }
+      type->fields.push_back(Field{ident, field_type, 0});
+    }
+  }
+
+  std::vector<size_t> order(type->fields.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  if (!type->packed) {
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return get_type_alignment(type->fields[lhs].type) >
+             get_type_alignment(type->fields[rhs].type);
+    });
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    type->fields[order[i]].index = i;
+  }
+  return type;
+}
+
+void Lowerer::resolve_pointer_types() {
+  for (auto &[type, ref_type_name] : unresolved_pointer_types_) {
+    Decl *refd_type = lookup_decl(ref_type_name);
+    if (refd_type == nullptr) {
+      throw pas::SemanticProblemException(
+          "pointer type references an undeclared identifier: " +
+          ref_type_name);
+    }
+    if (refd_type->index() != 0) {
+      throw pas::SemanticProblemException(
+          "pointer type must reference a type, not a value: " +
+          ref_type_name);
+    }
+    type->item_type = std::get<TypeSP>(*refd_type);
+  }
+  unresolved_pointer_types_.clear();
+}
+
+bool Lowerer::is_compatible_pointer(const TypeSP &from, const TypeSP &to) {
+  return from->kind == TypeKind::Pointer && to->kind == TypeKind::Pointer &&
+         (from->item_type == nullptr || from->item_type == to->item_type);
+}
+
 void Lowerer::process_var_decl(pas::ast::VarDecl &var_decl) {
-  TypeKind var_type = make_type_from_ast_type(var_decl.type_);
+  TypeSP var_type = make_type_from_ast_type(var_decl.type_);
   for (const std::string &ident : var_decl.ident_list_) {
     if (pascal_scopes_.back().contains(ident)) {
       throw pas::SemanticProblemException("identifier is already in use: " +
                                           ident);
     }
-    pascal_scopes_.back()[ident] =
-        Variable(codegen_alloc_value_of_type(var_type), std::move(var_type));
+    // Variables of the program are globals, procedures access them too.
+    //   Zero initializer is an empty string for strings inside.
+    if (pascal_scopes_.size() == 2) {
+      llvm::Type *llvm_type = get_llvm_type_by_lang_type(var_type);
+      auto *global = new llvm::GlobalVariable(
+          *module_uptr_, llvm_type, false, llvm::GlobalValue::InternalLinkage,
+          llvm::Constant::getNullValue(llvm_type), ident);
+      pascal_scopes_.back()[ident] = Variable(global, var_type);
+      continue;
+    }
+    Variable variable(codegen_alloc_value_of_type(var_type), var_type);
+    codegen_init_strings(variable);
+    if (var_type->kind == TypeKind::File) {
+      current_func_builder_->CreateStore(
+          llvm::Constant::getNullValue(get_llvm_file_type()),
+          variable.allocation);
+    }
+    pascal_scopes_.back()[ident] = variable;
   }
 }
 
-void Lowerer::visit(pas::ast::MemoryStmt &memory_stmt) {}
+void Lowerer::add_loop_metadata(llvm::BranchInst *latch_branch,
+                                bool must_progress) {
+  // Loop id is a distinct node, that references itself.
+  //   https://llvm.org/docs/LangRef.html#llvm-loop
+  llvm::SmallVector<llvm::Metadata *, 2> operands = {nullptr};
+  if (must_progress) {
+    operands.push_back(llvm::MDNode::get(
+        context_, llvm::MDString::get(context_, "llvm.loop.mustprogress")));
+  }
+  llvm::MDNode *loop_id = llvm::MDNode::getDistinct(context_, operands);
+  loop_id->replaceOperandWith(0, loop_id);
+  latch_branch->setMetadata(llvm::LLVMContext::MD_loop, loop_id);
+}
+
+llvm::Value *Lowerer::eval_condition(pas::ast::Expr &expr) {
+  TypedValue cond = eval(expr);
+  if (cond.type->kind != TypeKind::Boolean) {
+    throw SemanticProblemException("condition must be of type Boolean");
+  }
+  release_string_temporaries();
+  return cond.value;
+}
 
-void Lowerer::visit(pas::ast::RepeatStmt &repeat_stmt) {}
+void Lowerer::visit(pas::ast::RepeatStmt &repeat_stmt) {
+  // Counters: executions of the statement and of the body.
+  ProfileSite site = add_profile_site("repeat", repeat_stmt.loc_, 2);
+  codegen_profile_increment(site, 0);
+  llvm::BasicBlock *body_block =
+      llvm::BasicBlock::Create(context_, "repeat_body", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "repeat_end", current_func_);
+  current_func_builder_->CreateBr(body_block);
+
+  current_func_builder_->SetInsertPoint(body_block);
+  codegen_profile_increment(site, 1);
+  visit(repeat_stmt.stmt_seq_);
+  codegen_budget_tick();
+  llvm::Value *cond = eval_condition(repeat_stmt.cond_expr_);
+  // Pascal doesn't require loops to terminate, so no mustprogress here.
+  llvm::BranchInst *latch_branch =
+      current_func_builder_->CreateCondBr(cond, exit_block, body_block);
+  add_loop_metadata(latch_branch, false);
+  if (!site.counts.empty()) {
+    set_branch_weights(latch_branch,
+                       {site.counts[0], site.counts[1] - site.counts[0]});
+  }
 
-void Lowerer::visit(pas::ast::CaseStmt &case_stmt) {}
+  current_func_builder_->SetInsertPoint(exit_block);
+}
 
-void Lowerer::visit(pas::ast::IfStmt &if_stmt) {}
+void Lowerer::visit(pas::ast::CaseStmt &case_stmt) {
+  TypedValue selector = eval(case_stmt.cond_expr_);
+  if (selector.type->kind != TypeKind::Integer &&
+      selector.type->kind != TypeKind::Char &&
+      selector.type->kind != TypeKind::Boolean) {
+    throw SemanticProblemException("case selector must be of an ordinal type");
+  }
+  bool is_signed = selector.type->kind == TypeKind::Integer;
+  auto *selector_type =
+      llvm::cast<llvm::IntegerType>(selector.value->getType());
+  unsigned width = selector_type->getBitWidth();
+  int64_t min_value =
+      is_signed ? llvm::APInt::getSignedMinValue(width).getSExtValue() : 0;
+  int64_t max_value =
+      is_signed ? llvm::APInt::getSignedMaxValue(width).getSExtValue()
+                : static_cast<int64_t>(llvm::APInt::getMaxValue(width)
+                                           .getZExtValue());
+
+  // All of the labels go to a single switch, so that the backend can pick
+  //   a jump table, a bit test or a binary search, whatever fits the
+  //   labels best. Interpreters, written in pascal, dispatch on opcode
+  //   in a big case statement, a chain of comparisons won't do.
+  // Counters: executions of the statement and of each branch.
+  ProfileSite site =
+      add_profile_site("case", case_stmt.loc_, 1 + case_stmt.cases_.size());
+  codegen_profile_increment(site, 0);
+  // Weights of the default and of each switch case. Count of a branch is
+  //   split evenly between its labels.
+  std::vector<uint64_t> weights = {0};
+  uint64_t switch_count = 0;
+
+  llvm::BasicBlock *end_block =
+      llvm::BasicBlock::Create(context_, "case_end", current_func_);
+  llvm::SwitchInst *switch_inst =
+      current_func_builder_->CreateSwitch(selector.value, end_block);
+
+  struct Range {
+    int64_t low;
+    int64_t high;
+    llvm::BasicBlock *block;
+  };
+  // Every label, for a check for duplicates.
+  std::vector<Range> labels;
+  // Ranges, that are too large to be expanded into switch cases. Checked
+  //   by comparisons, when switch didn't match.
+  std::vector<Range> large_ranges;
+
+  for (size_t i = 0; i < case_stmt.cases_.size(); ++i) {
+    pas::ast::Case &case_item = case_stmt.cases_[i];
+    llvm::BasicBlock *case_block =
+        llvm::BasicBlock::Create(context_, "case", current_func_, end_block);
+    unsigned first_case = switch_inst->getNumCases();
+
+    for (pas::ast::Element &label : case_item.labels_) {
+      Range range = {0, 0, case_block};
+      switch (label.index()) {
+      case get_idx(pas::ast::ElementKind::ConstExpr): {
+        range.low = eval_const_expr(std::get<pas::ast::ConstExpr>(label));
+        range.high = range.low;
+        break;
+      }
+      case get_idx(pas::ast::ElementKind::ConstExprRange): {
+        auto &bounds =
+            std::get<std::pair<pas::ast::ConstExpr, pas::ast::ConstExpr>>(
+                label);
+        range.low = eval_const_expr(bounds.first);
+        range.high = eval_const_expr(bounds.second);
+        if (range.low > range.high) {
+          throw SemanticProblemException(
+              "case label range is empty: " + std::to_string(range.low) +
+              ".." + std::to_string(range.high));
+        }
+        break;
+      }
+      default:
+        assert(false);
+        __builtin_unreachable();
+      }
+      if (range.low < min_value || range.high > max_value) {
+        throw SemanticProblemException(
+            "case label is out of range of the selector type: " +
+            std::to_string(range.low));
+      }
+      labels.push_back(range);
+
+      if (range.high - range.low + 1 > kMaxExpandedCaseRange) {
+        large_ranges.push_back(range);
+        continue;
+      }
+      for (int64_t value = range.low; value <= range.high; ++value) {
+        switch_inst->addCase(
+            llvm::ConstantInt::get(selector_type, value, is_signed),
+            case_block);
+      }
+    }
+
+    unsigned num_cases = switch_inst->getNumCases() - first_case;
+    if (!site.counts.empty() && num_cases != 0) {
+      switch_count += site.counts[i + 1];
+      weights.resize(weights.size() + num_cases,
+                     site.counts[i + 1] / num_cases);
+    }
+
+    current_func_builder_->SetInsertPoint(case_block);
+    codegen_profile_increment(site, i + 1);
+    lower_stmt(case_item.then_stmt_);
+    current_func_builder_->CreateBr(end_block);
+  }
+  if (!site.counts.empty()) {
+    weights[0] = site.counts[0] - std::min(site.counts[0], switch_count);
+    set_branch_weights(switch_inst, weights);
+  }
+
+  std::sort(
+      labels.begin(), labels.end(),
+      [](const Range &lhs, const Range &rhs) { return lhs.low < rhs.low; });
+  for (size_t i = 1; i < labels.size(); ++i) {
+    if (labels[i].low <= labels[i - 1].high) {
+      throw SemanticProblemException("duplicate case label: " +
+                                     std::to_string(labels[i].low));
+    }
+  }
+
+  if (!large_ranges.empty()) {
+    llvm::BasicBlock *check_block = llvm::BasicBlock::Create(
+        context_, "case_ranges", current_func_, end_block);
+    switch_inst->setDefaultDest(check_block);
+    current_func_builder_->SetInsertPoint(check_block);
+
+    // low <= x <= high is one unsigned comparison: x - low <= high - low.
+    llvm::Value *selector_value =
+        is_signed ? current_func_builder_->CreateSExt(
+                        selector.value, current_func_builder_->getInt64Ty())
+                  : current_func_builder_->CreateZExt(
+                        selector.value, current_func_builder_->getInt64Ty());
+    for (Range &range : large_ranges) {
+      llvm::Value *offset = current_func_builder_->CreateSub(
+          selector_value, current_func_builder_->getInt64(range.low));
+      llvm::Value *in_range = current_func_builder_->CreateICmpULE(
+          offset, current_func_builder_->getInt64(range.high - range.low));
+      llvm::BasicBlock *next_block = llvm::BasicBlock::Create(
+          context_, "case_ranges", current_func_, end_block);
+      current_func_builder_->CreateCondBr(in_range, range.block, next_block);
+      current_func_builder_->SetInsertPoint(next_block);
+    }
+    current_func_builder_->CreateBr(end_block);
+  }
+
+  current_func_builder_->SetInsertPoint(end_block);
+}
+
+void Lowerer::visit(pas::ast::IfStmt &if_stmt) {
+  // Counters: executions of the statement and of the then branch.
+  ProfileSite site = add_profile_site("if", if_stmt.loc_, 2);
+  codegen_profile_increment(site, 0);
+  llvm::Value *cond = eval_condition(if_stmt.cond_expr_);
+
+  llvm::BasicBlock *then_block =
+      llvm::BasicBlock::Create(context_, "then", current_func_);
+  llvm::BasicBlock *else_block = nullptr;
+  llvm::BasicBlock *end_block =
+      llvm::BasicBlock::Create(context_, "endif", current_func_);
+  if (if_stmt.else_stmt_.has_value()) {
+    else_block =
+        llvm::BasicBlock::Create(context_, "else", current_func_, end_block);
+  }
+  llvm::BranchInst *branch = current_func_builder_->CreateCondBr(
+      cond, then_block, else_block != nullptr ? else_block : end_block);
+  if (!site.counts.empty()) {
+    set_branch_weights(branch,
+                       {site.counts[1], site.counts[0] - site.counts[1]});
+  }
+
+  current_func_builder_->SetInsertPoint(then_block);
+  codegen_profile_increment(site, 1);
+  lower_stmt(if_stmt.then_stmt_);
+  current_func_builder_->CreateBr(end_block);
+
+  if (else_block != nullptr) {
+    current_func_builder_->SetInsertPoint(else_block);
+    lower_stmt(if_stmt.else_stmt_.value());
+    current_func_builder_->CreateBr(end_block);
+  }
+
+  current_func_builder_->SetInsertPoint(end_block);
+}
 
 void Lowerer::visit(pas::ast::EmptyStmt &empty_stmt) {}
 
-void Lowerer::visit(pas::ast::ForStmt &for_stmt) {}
+void Lowerer::visit(pas::ast::ForStmt &for_stmt) {
+  Decl *decl = lookup_decl(for_stmt.ident_);
+  if (decl == nullptr || decl->index() != 1) {
+    throw SemanticProblemException("for loop control variable not found: " +
+                                   for_stmt.ident_);
+  }
+  Variable control = std::get<Variable>(*decl);
+  TypeKind kind = control.type->kind;
+  if (kind != TypeKind::Integer && kind != TypeKind::Char &&
+      kind != TypeKind::Boolean) {
+    throw SemanticProblemException(
+        "for loop control variable must be of an ordinal type: " +
+        for_stmt.ident_);
+  }
+  bool is_signed = kind == TypeKind::Integer;
+  bool is_down = for_stmt.dir_ == pas::ast::WhichWay::DownTo;
+
+  // Bounds are evaluated once, before the loop.
+  llvm::Value *start =
+      codegen_convert(eval(for_stmt.start_val_expr_), control.type);
+  llvm::Value *finish =
+      codegen_convert(eval(for_stmt.finish_val_expr_), control.type);
+  if (for_stmt.is_parallel_) {
+    visit_parallel_for(for_stmt, control, start, finish);
+    return;
+  }
+
+  // Emitted in rotated form, just like LoopRotate would do:
+  //   if (start <= finish) {
+  //     i = start;
+  //     do { body; } while (i != finish && (++i, true));
+  //   }
+  //   The induction variable is a single phi in the header, its step is
+  //   constant and the exit compares it with a loop invariant, SCEV
+  //   computes the trip count (finish - start + 1) from this directly.
+  //   The exit is checked before the increment, so there's no overflow
+  //   even if finish is the largest value of the type.
+  llvm::CmpInst::Predicate enter_predicate =
+      is_down ? (is_signed ? llvm::CmpInst::ICMP_SGE : llvm::CmpInst::ICMP_UGE)
+              : (is_signed ? llvm::CmpInst::ICMP_SLE
+                           : llvm::CmpInst::ICMP_ULE);
+  llvm::Value *enter =
+      current_func_builder_->CreateICmp(enter_predicate, start, finish);
+  // Counters: executions of the statement, entries to the loop and
+  //   iterations. The loop has no block of its own before the body, entries
+  //   are counted without a branch.
+  ProfileSite site = add_profile_site("for", for_stmt.loc_, 3);
+  codegen_profile_increment(site, 0);
+  codegen_profile_increment(
+      site, 1,
+      current_func_builder_->CreateZExt(enter,
+                                        current_func_builder_->getInt64Ty()));
+
+  llvm::BasicBlock *preheader_block = current_func_builder_->GetInsertBlock();
+  llvm::BasicBlock *body_block =
+      llvm::BasicBlock::Create(context_, "for_body", current_func_);
+  llvm::BasicBlock *latch_block =
+      llvm::BasicBlock::Create(context_, "for_latch", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "for_end", current_func_);
+  llvm::BranchInst *enter_branch =
+      current_func_builder_->CreateCondBr(enter, body_block, exit_block);
+
+  current_func_builder_->SetInsertPoint(body_block);
+  llvm::PHINode *induction_var =
+      current_func_builder_->CreatePHI(start->getType(), 2, for_stmt.ident_);
+  induction_var->addIncoming(start, preheader_block);
+  codegen_profile_increment(site, 2);
+  // The body sees the value through the variable. Assigning to the control
+  //   variable inside of the loop is not allowed, so the phi is the only
+  //   source of truth.
+  current_func_builder_->CreateStore(induction_var, control.allocation);
+  lower_stmt(for_stmt.inner_stmt_);
+  codegen_budget_tick();
+  current_func_builder_->CreateBr(latch_block);
+
+  current_func_builder_->SetInsertPoint(latch_block);
+  llvm::Value *done =
+      current_func_builder_->CreateICmpEQ(induction_var, finish);
+  llvm::Value *step = llvm::ConstantInt::get(start->getType(), 1);
+  llvm::Value *next =
+      is_down ? current_func_builder_->CreateSub(induction_var, step, "",
+                                                 !is_signed, is_signed)
+              : current_func_builder_->CreateAdd(induction_var, step, "",
+                                                 !is_signed, is_signed);
+  induction_var->addIncoming(next, latch_block);
+  llvm::BranchInst *latch_branch =
+      current_func_builder_->CreateCondBr(done, exit_block, body_block);
+  add_loop_metadata(latch_branch, true);
+  if (!site.counts.empty()) {
+    set_branch_weights(enter_branch,
+                       {site.counts[1], site.counts[0] - site.counts[1]});
+    set_branch_weights(latch_branch,
+                       {site.counts[1], site.counts[2] - site.counts[1]});
+  }
+
+  current_func_builder_->SetInsertPoint(exit_block);
+}
 
 void Lowerer::visit(pas::ast::Assignment &assignment) {
-  llvm::Value *new_value = eval(assignment.expr_);
   pas::ast::Designator &designator = assignment.designator_;
 
   // if (!ident_to_item_.contains(designator.ident_)) {
@@ -329,38 +998,138 @@ void Lowerer::visit(pas::ast::Assignment &assignment) {
 
   // *value = new_value; // Copy assign a new value.
 
-  // TODO: check if item with identifier exists in the first place!!
-  // IMPORTANT!
-  std::variant<TypeKind, Variable> *decl = lookup_decl(designator.ident_);
-  if (decl == nullptr) {
-    throw SemanticProblemException("declaration not found: " +
+  Variable target = resolve_designator(designator);
+  if (target.type->kind == TypeKind::File) {
+    throw SemanticProblemException("files can't be assigned: " +
                                    designator.ident_);
   }
-  if (decl->index() != 1) {
-    throw SemanticProblemException(
-        "designator must reference a value, not a type: " + designator.ident_);
+
+  if (target.type->kind == TypeKind::Array ||
+      target.type->kind == TypeKind::Record) {
+    pas::ast::Designator *source_designator =
+        as_plain_designator(assignment.expr_);
+    if (source_designator == nullptr) {
+      throw SemanticProblemException(
+          "only a variable can be assigned to an array or a record: " +
+          designator.ident_);
+    }
+    Variable source = resolve_designator(*source_designator);
+    if (source.type != target.type) {
+      throw SemanticProblemException(
+          "incompatible types, must be of the same type for assignment");
+    }
+    // Size is a constant expression, it is folded, when data layout of the
+    //   target is known.
+    llvm::Constant *size = llvm::ConstantExpr::getSizeOf(
+        get_llvm_type_by_lang_type(target.type));
+    if (!contains_string(target.type)) {
+      current_func_builder_->CreateMemCpy(target.allocation,
+                                          llvm::MaybeAlign(), source.allocation,
+                                          llvm::MaybeAlign(), size);
+      return;
+    }
+
+    // Strings are shared by the copy: the source ones are retained, the
+    //   previous target ones are released. Assignment to itself (a[i] :=
+    //   a[j] with i = j) would release the strings, so it is skipped.
+    llvm::BasicBlock *copy_block =
+        llvm::BasicBlock::Create(context_, "copy", current_func_);
+    llvm::BasicBlock *exit_block =
+        llvm::BasicBlock::Create(context_, "copy_end", current_func_);
+    current_func_builder_->CreateCondBr(
+        current_func_builder_->CreateICmpNE(target.allocation,
+                                            source.allocation),
+        copy_block, exit_block);
+    current_func_builder_->SetInsertPoint(copy_block);
+    codegen_for_each_string(source.allocation, source.type,
+                            "pas_string_retain");
+    codegen_for_each_string(target.allocation, target.type,
+                            "pas_string_release");
+    current_func_builder_->CreateMemCpy(target.allocation, llvm::MaybeAlign(),
+                                        source.allocation, llvm::MaybeAlign(),
+                                        size);
+    current_func_builder_->CreateBr(exit_block);
+    current_func_builder_->SetInsertPoint(exit_block);
+    return;
+  }
+
+  if (target.type->kind == TypeKind::String) {
+    codegen_string_assign(target, designator, assignment.expr_);
+    return;
   }
-  Variable &variable = std::get<Variable>(*decl);
-  llvm::Value *base_value = variable.allocation;
 
-  current_func_builder_->CreateStore(new_value, base_value);
+  llvm::Value *new_value = codegen_convert(eval(assignment.expr_), target.type);
+  current_func_builder_->CreateStore(new_value, target.allocation);
+  release_string_temporaries();
+}
+
+llvm::Value *Lowerer::codegen_convert(TypedValue value, const TypeSP &type) {
+  if (value.type == type) {
+    return value.value;
+  }
+  if (value.type->kind == TypeKind::Set && type->kind == TypeKind::Set) {
+    return codegen_set_convert(value.value, value.type, type);
+  }
+  if (value.type->kind == TypeKind::Integer && type->kind == TypeKind::Real) {
+    return codegen_int_to_real(value.value);
+  }
+  if (value.type->kind == TypeKind::Pointer) {
+    if (!is_compatible_pointer(value.type, type)) {
+      throw SemanticProblemException(
+          "incompatible types, pointers must reference the same type");
+    }
+    return value.value;
+  }
+  if (value.value->getType() != get_llvm_type_by_lang_type(type)) {
+    throw SemanticProblemException(
+        "incompatible types, must be of the same type for assignment");
+  }
+  return value.value;
 }
 
 void Lowerer::visit(pas::ast::ProcCall &proc_call) {
   const std::string &proc_name = proc_call.proc_ident_;
 
-  if (proc_name == "write_int") {
+  // Procedures of the program hide the builtin ones.
+  if (lookup_subprogram(proc_name) != nullptr) {
+    codegen_call(proc_name, proc_call.params_);
+    release_string_temporaries();
+  } else if (proc_name == "write_int") {
     visit_write_int(proc_call);
   } else if (proc_name == "write_str") {
     visit_write_str(proc_call);
+  } else if (proc_name == "write_real") {
+    visit_write_real(proc_call);
+  } else if (proc_name == "read" || proc_name == "readln") {
+    visit_read(proc_call, proc_name == "readln");
+  } else if (proc_name == "write" || proc_name == "writeln") {
+    visit_write(proc_call, proc_name == "writeln");
+  } else if (proc_name == "assign" || proc_name == "reset" ||
+             proc_name == "rewrite" || proc_name == "close" ||
+             proc_name == "get") {
+    visit_file_procedure(proc_call);
+  } else if (proc_name == "spawn" || proc_name == "await" ||
+             proc_name == "new_channel" || proc_name == "send" ||
+             proc_name == "close_channel" || proc_name == "dispose_channel") {
+    visit_task_procedure(proc_call);
   } else {
-    throw pas::NotImplementedException(
-        "procedure calls are not supported yet, except write_int");
+    throw pas::SemanticProblemException("procedure not found: " + proc_name);
   }
 }
 
-std::variant<Lowerer::TypeKind, Lowerer::Variable> *
-Lowerer::lookup_decl(const std::string &identifier) {
+llvm::FunctionCallee
+Lowerer::get_runtime_function(const std::string &name,
+                              llvm::Type *result_type,
+                              llvm::ArrayRef<llvm::Type *> param_types) {
+  llvm::FunctionCallee callee = module_uptr_->getOrInsertFunction(
+      name, llvm::FunctionType::get(result_type, param_types, false));
+  // Runtime never throws, so no unwind edges are needed around calls.
+  llvm::cast<llvm::Function>(callee.getCallee())
+      ->addFnAttr(llvm::Attribute::NoUnwind);
+  return callee;
+}
+
+Lowerer::Decl *Lowerer::lookup_decl(const std::string &identifier) {
   for (auto it = pascal_scopes_.rbegin(); it != pascal_scopes_.rend(); ++it) {
     auto &scope = *it;
     auto item_it = scope.find(identifier);
@@ -371,112 +1140,307 @@ Lowerer::lookup_decl(const std::string &identifier) {
   return nullptr;
 }
 
+Lowerer::Variable
+Lowerer::resolve_designator(pas::ast::Designator &designator) {
+  Decl *decl = lookup_decl(designator.ident_);
+  if (decl == nullptr) {
+    throw SemanticProblemException("declaration not found: " +
+                                   designator.ident_);
+  }
+  if (decl->index() == 2) {
+    throw SemanticProblemException(
+        "procedure or function can't be used as a variable, calls need "
+        "parentheses: " +
+        designator.ident_);
+  }
+  if (decl->index() != 1) {
+    throw SemanticProblemException(
+        "designator must reference a value, not a type: " + designator.ident_);
+  }
+  Variable &variable = std::get<Variable>(*decl);
+
+  // Indices for getelementptr. Lower bounds are constant, so they are
+  //   subtracted right there, and the whole chain of element and field
+  //   accesses (a[i, j].x, a[i][j].x) is one instruction in the end. The loop
+  //   vectorizer and SCEV see a plain affine address. Dereference of a
+  //   pointer starts a new chain from the loaded address.
+  llvm::Value *base = variable.allocation;
+  TypeSP base_type = variable.type;
+  std::vector<llvm::Value *> indices = {current_func_builder_->getInt64(0)};
+  TypeSP type = variable.type;
+  auto get_address = [&]() {
+    if (indices.size() == 1) {
+      return base;
+    }
+    return current_func_builder_->CreateInBoundsGEP(
+        get_llvm_type_by_lang_type(base_type), base, indices);
+  };
+
+  for (pas::ast::DesignatorItem &item : designator.items_) {
+    switch (item.index()) {
+    case get_idx(pas::ast::DesignatorItemKind::FieldAccess): {
+      auto &field_access = std::get<pas::ast::DesignatorFieldAccess>(item);
+      if (type->kind != TypeKind::Record) {
+        throw SemanticProblemException(
+            "field access to a value, that is not a record: " +
+            designator.ident_);
+      }
+      auto field_it = std::find_if(
+          type->fields.begin(), type->fields.end(), [&](const Field &field) {
+            return field.name == field_access.ident_;
+          });
+      if (field_it == type->fields.end()) {
+        throw SemanticProblemException("record has no field named " +
+                                       field_access.ident_);
+      }
+      // Struct indices must be constant i32.
+      indices.push_back(current_func_builder_->getInt32(field_it->index));
+      type = field_it->type;
+      break;
+    }
+    case get_idx(pas::ast::DesignatorItemKind::PointerAccess): {
+      // f^ is the current value of the file, right in its buffer.
+      if (type->kind == TypeKind::File) {
+        base_type = type->item_type;
+        base = current_func_builder_->CreatePointerCast(
+            codegen_file_value(get_address(), type),
+            get_llvm_type_by_lang_type(base_type)->getPointerTo());
+        indices = {current_func_builder_->getInt64(0)};
+        type = base_type;
+        break;
+      }
+      if (type->kind != TypeKind::Pointer) {
+        throw SemanticProblemException(
+            "dereference of a value, that is not a pointer: " +
+            designator.ident_);
+      }
+      llvm::Value *pointer = current_func_builder_->CreateLoad(
+          get_llvm_type_by_lang_type(type), get_address());
+      base_type = type->item_type;
+      base = current_func_builder_->CreatePointerCast(
+          pointer, get_llvm_type_by_lang_type(base_type)->getPointerTo());
+      indices = {current_func_builder_->getInt64(0)};
+      type = base_type;
+      break;
+    }
+    case get_idx(pas::ast::DesignatorItemKind::ArrayAccess): {
+      auto &array_access = std::get<pas::ast::DesignatorArrayAccess>(item);
+      for (pas::ast::ExprUP &index_expr : array_access.expr_list_) {
+        if (type->kind != TypeKind::Array) {
+          throw SemanticProblemException(
+              "too many indices, value is not an array: " + designator.ident_);
+        }
+        TypedValue index_value = eval(*index_expr);
+        if (index_value.type->kind != TypeKind::Integer) {
+          throw SemanticProblemException(
+              "can only do indexing with integer type");
+        }
+        llvm::Value *index = index_value.value;
+        if (type->bounds.low != 0) {
+          index = current_func_builder_->CreateNSWSub(
+              index, current_func_builder_->getInt32(type->bounds.low));
+        }
+        indices.push_back(current_func_builder_->CreateSExt(
+            index, current_func_builder_->getInt64Ty()));
+        type = type->item_type;
+      }
+      break;
+    }
+    default:
+      assert(false);
+      __builtin_unreachable();
+    }
+  }
+
+  return Variable(get_address(), type);
+}
+
+pas::ast::Designator *Lowerer::as_plain_designator(pas::ast::Expr &expr) {
+  if (expr.op_.has_value() || expr.start_expr_.unary_op_.has_value() ||
+      !expr.start_expr_.ops_.empty() ||
+      !expr.start_expr_.start_term_.ops_.empty()) {
+    return nullptr;
+  }
+  pas::ast::Factor &factor = expr.start_expr_.start_term_.start_factor_;
+  if (factor.index() == get_idx(pas::ast::FactorKind::Expr)) {
+    return as_plain_designator(*std::get<pas::ast::ExprUP>(factor));
+  }
+  if (factor.index() != get_idx(pas::ast::FactorKind::Designator)) {
+    return nullptr;
+  }
+  return &std::get<pas::ast::Designator>(factor);
+}
+
 // TODO: say where a type assertion is checked in typechecker.
 //   In a fixed format manner. Invent an intuitive format for it.
 
-llvm::Value *Lowerer::eval(pas::ast::Factor &factor) {
+Lowerer::TypedValue Lowerer::eval(pas::ast::Factor &factor) {
+  return eval_operand(&factor);
+}
+
+Lowerer::TypedValue Lowerer::eval(pas::ast::Term &term) {
+  return eval_operand(&term);
+}
+
+Lowerer::TypedValue Lowerer::eval(pas::ast::SimpleExpr &simple_expr) {
+  return eval_operand(&simple_expr);
+}
+
+Lowerer::TypedValue Lowerer::eval(pas::ast::Expr &expr) {
+  return eval_operand(&expr);
+}
+
+// Operand with operators, that waits for the values of its operands.
+struct Lowerer::OperandFrame {
+  std::variant<pas::ast::Expr *, pas::ast::SimpleExpr *, pas::ast::Term *,
+               pas::ast::Negation *>
+      node;
+  // Operands, that are evaluated, and the value of them so far.
+  size_t evaluated = 0;
+  std::optional<TypedValue> value;
+};
+
+Lowerer::TypedValue Lowerer::eval_operand(Operand operand) {
+  // Factors, that are not nested expressions, come back here recursively.
+  return run_with_sufficient_stack([&]() {
+    std::vector<OperandFrame> frames;
+    TypedValue value = start_operand(operand, frames);
+    while (!frames.empty()) {
+      OperandFrame &frame = frames.back();
+      // Next operand of the frame, the frame is done without one.
+      std::optional<Operand> next;
+
+      if (auto *expr = std::get_if<pas::ast::Expr *>(&frame.node)) {
+        pas::ast::Expr::Op &op = (*expr)->op_.value();
+        if (frame.evaluated == 0) {
+          frame.value = value;
+          next = &op.expr;
+        } else {
+          value = apply_rel_op(op.rel, frame.value.value(), value);
+        }
+      } else if (auto *simple_expr =
+                     std::get_if<pas::ast::SimpleExpr *>(&frame.node)) {
+        if (frame.evaluated == 0) {
+          const std::optional<pas::ast::UnaryOp> &unary_op =
+              (*simple_expr)->unary_op_;
+          frame.value =
+              unary_op.has_value() ? apply_unary_op(*unary_op, value) : value;
+        } else {
+          frame.value =
+              apply_add_op((*simple_expr)->ops_[frame.evaluated - 1].op,
+                           frame.value.value(), value);
+        }
+        if (frame.evaluated < (*simple_expr)->ops_.size()) {
+          next = &(*simple_expr)->ops_[frame.evaluated].term;
+        } else {
+          value = frame.value.value();
+        }
+      } else if (auto *term = std::get_if<pas::ast::Term *>(&frame.node)) {
+        if (frame.evaluated == 0) {
+          frame.value = value;
+        } else {
+          frame.value = apply_mult_op((*term)->ops_[frame.evaluated - 1].op,
+                                      frame.value.value(), value);
+        }
+        if (frame.evaluated < (*term)->ops_.size()) {
+          next = &(*term)->ops_[frame.evaluated].factor;
+        } else {
+          value = frame.value.value();
+        }
+      } else {
+        value = apply_negation(value);
+      }
+
+      if (next.has_value()) {
+        frame.evaluated += 1;
+        // Invalidates the frame.
+        value = start_operand(next.value(), frames);
+      } else {
+        frames.pop_back();
+      }
+    }
+    return value;
+  });
+}
+
+Lowerer::TypedValue
+Lowerer::start_operand(Operand operand, std::vector<OperandFrame> &frames) {
+  while (true) {
+    // Operands without operators need no frames.
+    if (auto *expr = std::get_if<pas::ast::Expr *>(&operand)) {
+      if ((*expr)->op_.has_value()) {
+        frames.push_back(OperandFrame{*expr});
+      }
+      operand = &(*expr)->start_expr_;
+    } else if (auto *simple_expr =
+                   std::get_if<pas::ast::SimpleExpr *>(&operand)) {
+      if ((*simple_expr)->unary_op_.has_value() ||
+          !(*simple_expr)->ops_.empty()) {
+        frames.push_back(OperandFrame{*simple_expr});
+      }
+      operand = &(*simple_expr)->start_term_;
+    } else if (auto *term = std::get_if<pas::ast::Term *>(&operand)) {
+      if (!(*term)->ops_.empty()) {
+        frames.push_back(OperandFrame{*term});
+      }
+      operand = &(*term)->start_factor_;
+    } else {
+      pas::ast::Factor &factor = *std::get<pas::ast::Factor *>(operand);
+      if (auto *expr = std::get_if<pas::ast::ExprUP>(&factor)) {
+        operand = expr->get();
+      } else if (auto *negation = std::get_if<pas::ast::NegationUP>(&factor)) {
+        frames.push_back(OperandFrame{negation->get()});
+        operand = &(*negation)->factor_;
+      } else {
+        return eval_leaf_factor(factor);
+      }
+    }
+  }
+}
+
+Lowerer::TypedValue Lowerer::eval_leaf_factor(pas::ast::Factor &factor) {
   switch (factor.index()) {
   case get_idx(pas::ast::FactorKind::Bool): {
-    // No dedicated bool type for now for simplicity
-    //   (I don't have much time, too many things to do).
-    return current_func_builder_->getInt1(std::get<bool>(factor));
+    return TypedValue(current_func_builder_->getInt1(std::get<bool>(factor)),
+                      boolean_type_);
   }
   case get_idx(pas::ast::FactorKind::Number): {
-    return current_func_builder_->getInt32(std::get<int>(factor));
+    return TypedValue(current_func_builder_->getInt32(std::get<int>(factor)),
+                      integer_type_);
+  }
+  case get_idx(pas::ast::FactorKind::Real): {
+    return TypedValue(
+        llvm::ConstantFP::get(current_func_builder_->getDoubleTy(),
+                              std::get<double>(factor)),
+        real_type_);
   }
   case get_idx(pas::ast::FactorKind::String): {
-    throw NotImplementedException(
-        "string constants are not implemented for now..");
-    // return current_func_builder_->getInt32(std::get<int>(factor));
-    // return Value(std::get<std::string>(factor));
+    return eval_string_literal(std::get<std::string>(factor));
   }
   case get_idx(pas::ast::FactorKind::Nil): {
-    throw NotImplementedException("Nil is not supported yet");
+    return TypedValue(
+        llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+            get_llvm_type_by_lang_type(nil_type_))),
+        nil_type_);
   }
   case get_idx(pas::ast::FactorKind::FuncCall): {
-    throw NotImplementedException(
-        "function call evaluation is not supported for now");
-    // return eval(*std::get<pas::ast::FuncCallUP>(factor));
-    break;
-  }
-
-  case get_idx(pas::ast::FactorKind::Negation): {
-    llvm::Value *inner_value =
-        eval(std::get<pas::ast::NegationUP>(factor)->factor_);
-    // if (inner_value.index() != 0) {
-    //   throw SemanticProblemException(
-    //       "Negation is only applicable to integer type");
-    // }
-    return current_func_builder_->CreateNot(inner_value);
+    return eval(*std::get<pas::ast::FuncCallUP>(factor));
   }
-  case get_idx(pas::ast::FactorKind::Expr): {
-    llvm::Value *inner_value = eval(*std::get<pas::ast::ExprUP>(factor));
-    return inner_value;
+  case get_idx(pas::ast::FactorKind::SetValue): {
+    return eval(*std::get<pas::ast::SetValueUP>(factor));
   }
   case get_idx(pas::ast::FactorKind::Designator): {
     auto &designator = std::get<pas::ast::Designator>(factor);
-    // TODO: check if item with identifier exists in the first place!!
-    // IMPORTANT!
-    std::variant<TypeKind, Variable> *decl = lookup_decl(designator.ident_);
-    if (decl == nullptr) {
-      throw SemanticProblemException("declaration not found: " +
-                                     designator.ident_);
-    }
-    if (decl->index() != 1) {
-      throw SemanticProblemException(
-          "designator must reference a value, not a type: " +
-          designator.ident_);
+    Variable place = resolve_designator(designator);
+    // Strings and files are evaluated to their addresses.
+    if (place.type->kind == TypeKind::String ||
+        place.type->kind == TypeKind::File) {
+      return TypedValue(place.allocation, place.type);
     }
-    Variable &variable = std::get<Variable>(*decl);
-    llvm::Value *base_value = variable.allocation;
-
-    for (pas::ast::DesignatorItem &item : designator.items_) {
-      throw NotImplementedException(
-          "designator element access is not supported for now!");
-      //   switch (item.index()) {
-      //   case get_idx(pas::ast::DesignatorItemKind::FieldAccess): {
-      //     throw NotImplementedException("field access is not implemented");
-      //   }
-      //   case get_idx(pas::ast::DesignatorItemKind::PointerAccess): {
-      //     throw NotImplementedException("pointer access is not implemented");
-      //   }
-      //   case get_idx(pas::ast::DesignatorItemKind::ArrayAccess): {
-      //     //          if (base_value.index() != get_idx(ValueKind::Pointer))
-      //     {
-      //     //            throw NotImplementedException(
-      //     //                "value must be a pointer for array access");
-      //     //          }
-      //     if (base_value.index() != get_idx(ValueKind::String)) {
-      //       throw NotImplementedException(
-      //           "value must be a string for array access");
-      //     }
-      //     pas::ast::DesignatorArrayAccess &array_access =
-      //         std::get<pas::ast::DesignatorArrayAccess>(item);
-      //     if (array_access.expr_list_.size() != 1) {
-      //       throw NotImplementedException(
-      //           "array access for more than one index is not supported");
-      //     }
-      //     Value value_index = eval(*array_access.expr_list_[0]);
-      //     if (value_index.index() != get_idx(ValueKind::Integer)) {
-      //       throw SemanticProblemException(
-      //           "can only do indexing with integer type");
-      //     }
-      //     int index = std::get<int>(value_index);
-      //     auto &value = std::get<std::string>(base_value);
-      //     if (index < 0 || index >= value.size()) {
-      //       // Won't be reported if it's a compiler, not an interpreter.
-      //       //   Only a thing like valgrind or memory sanitizer.
-      //       throw RuntimeProblemException("index is out of bounds: " +
-      //                                     std::to_string(index));
-      //     }
-      //     base_value = Value(std::in_place_type<char>, value[index]);
-      //     break;
-      //   }
-      //   }
-    }
-    return current_func_builder_->CreateLoad(
-        get_llvm_type_by_lang_type(variable.type), base_value,
+    llvm::Value *value = current_func_builder_->CreateLoad(
+        get_llvm_type_by_lang_type(place.type), place.allocation,
         designator.ident_);
+    return TypedValue(value, place.type);
   }
   default:
     assert(false);
@@ -484,117 +1448,260 @@ llvm::Value *Lowerer::eval(pas::ast::Factor &factor) {
   }
 }
 
-llvm::Value *Lowerer::eval(pas::ast::Term &term) {
-  llvm::Value *value = eval(term.start_factor_);
-  for (pas::ast::Term::Op &op : term.ops_) {
-    // if (value.index() != 0) {
-    //   throw SemanticProblemException("can only do math with integer type");
-    // }
-    llvm::Value *rhs_value = eval(op.factor);
-    // if (rhs_value.index() != 0) {
-    //   throw SemanticProblemException("can only do math with integer type");
-    // }
-    switch (op.op) {
-    case pas::ast::MultOp::And: {
-      value = current_func_builder_->CreateLogicalAnd(value, rhs_value);
-      break;
-    }
-    case pas::ast::MultOp::IntDiv: {
-      value = current_func_builder_->CreateSDiv(value, rhs_value);
-      break;
-    }
-    case pas::ast::MultOp::Modulo: {
-      value = current_func_builder_->CreateSRem(value, rhs_value);
+Lowerer::TypedValue Lowerer::apply_negation(TypedValue value) {
+  if (value.type->kind != TypeKind::Boolean &&
+      value.type->kind != TypeKind::Integer) {
+    throw SemanticProblemException(
+        "negation is only applicable to Boolean and Integer types");
+  }
+  return TypedValue(current_func_builder_->CreateNot(value.value),
+                    value.type);
+}
+
+static void check_operand_kinds(const char *op_name, bool lhs_ok,
+                                bool rhs_ok) {
+  if (!lhs_ok || !rhs_ok) {
+    throw SemanticProblemException(std::string("invalid operand types for ") +
+                                   op_name);
+  }
+}
+
+Lowerer::TypedValue Lowerer::apply_mult_op(pas::ast::MultOp op,
+                                           TypedValue value,
+                                           TypedValue rhs_value) {
+  TypeKind lhs_kind = value.type->kind;
+  TypeKind rhs_kind = rhs_value.type->kind;
+  switch (op) {
+  case pas::ast::MultOp::And: {
+    check_operand_kinds("and", lhs_kind == TypeKind::Boolean,
+                        rhs_kind == TypeKind::Boolean);
+    value.value =
+        current_func_builder_->CreateLogicalAnd(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::MultOp::IntDiv: {
+    check_operand_kinds("div", lhs_kind == TypeKind::Integer,
+                        rhs_kind == TypeKind::Integer);
+    value.value =
+        current_func_builder_->CreateSDiv(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::MultOp::Modulo: {
+    check_operand_kinds("mod", lhs_kind == TypeKind::Integer,
+                        rhs_kind == TypeKind::Integer);
+    value.value =
+        current_func_builder_->CreateSRem(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::MultOp::Multiply: {
+    if (lhs_kind == TypeKind::Set || rhs_kind == TypeKind::Set) {
+      check_operand_kinds("*", lhs_kind == TypeKind::Set,
+                          rhs_kind == TypeKind::Set);
+      value = codegen_set_intersection(value, rhs_value);
       break;
     }
-    case pas::ast::MultOp::Multiply: {
-      // nsw, nuw and etc.
-      //   https://stackoverflow.com/a/61210926
-      value = current_func_builder_->CreateMul(value, rhs_value);
+    if (unify_reals(value, rhs_value)) {
+      value.value =
+          current_func_builder_->CreateFMul(value.value, rhs_value.value);
       break;
     }
-    case pas::ast::MultOp::RealDiv: {
-      throw NotImplementedException("real numbers are not supported");
+    check_operand_kinds("*", lhs_kind == TypeKind::Integer,
+                        rhs_kind == TypeKind::Integer);
+    // nsw, nuw and etc.
+    //   https://stackoverflow.com/a/61210926
+    value.value =
+        current_func_builder_->CreateMul(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::MultOp::RealDiv: {
+    // The quotient is Real, even of two Integers.
+    check_operand_kinds("/", is_number(lhs_kind), is_number(rhs_kind));
+    if (lhs_kind == TypeKind::Integer) {
+      value = TypedValue(codegen_int_to_real(value.value), real_type_);
     }
-    default:
-      assert(false);
-      __builtin_unreachable();
+    if (rhs_kind == TypeKind::Integer) {
+      rhs_value =
+          TypedValue(codegen_int_to_real(rhs_value.value), real_type_);
     }
+    value.value =
+        current_func_builder_->CreateFDiv(value.value, rhs_value.value);
+    break;
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+  return value;
+}
+
+// Unary operator applies to the first term only: -a + b is (-a) + b.
+Lowerer::TypedValue Lowerer::apply_unary_op(pas::ast::UnaryOp op,
+                                            TypedValue value) {
+  if (!is_number(value.type->kind)) {
+    throw SemanticProblemException(
+        "unary plus and minus are only applicable to Integer and Real "
+        "types");
+  }
+  if (op == pas::ast::UnaryOp::Minus) {
+    value.value = value.type->kind == TypeKind::Real
+                      ? current_func_builder_->CreateFNeg(value.value)
+                      : current_func_builder_->CreateNeg(value.value);
   }
   return value;
 }
 
-llvm::Value *Lowerer::eval(pas::ast::SimpleExpr &simple_expr) {
-  // NOTE: unary op is ignored for now.
-  llvm::Value *value = eval(simple_expr.start_term_);
-  for (pas::ast::SimpleExpr::Op &op : simple_expr.ops_) {
-    // if (value.index() != 0) {
-    //   throw SemanticProblemException("can only do math with integer type");
-    // }
-    llvm::Value *rhs_value = eval(op.term);
-    // if (rhs_value.index() != 0) {
-    //   throw SemanticProblemException("can only do math with integer type");
-    // }
-    switch (op.op) {
-    case pas::ast::AddOp::Plus: {
-      value = current_func_builder_->CreateAdd(value, rhs_value);
+Lowerer::TypedValue Lowerer::apply_add_op(pas::ast::AddOp op, TypedValue value,
+                                          TypedValue rhs_value) {
+  TypeKind lhs_kind = value.type->kind;
+  TypeKind rhs_kind = rhs_value.type->kind;
+  bool is_set_op = lhs_kind == TypeKind::Set || rhs_kind == TypeKind::Set;
+  switch (op) {
+  case pas::ast::AddOp::Plus: {
+    if (is_set_op) {
+      check_operand_kinds("+", lhs_kind == TypeKind::Set,
+                          rhs_kind == TypeKind::Set);
+      value = codegen_set_union(value, rhs_value);
       break;
     }
-    case pas::ast::AddOp::Minus: {
-      value = current_func_builder_->CreateSub(value, rhs_value);
+    if (lhs_kind == TypeKind::String || rhs_kind == TypeKind::String) {
+      check_operand_kinds("+", lhs_kind == TypeKind::String,
+                          rhs_kind == TypeKind::String);
+      value = codegen_string_concat(value, rhs_value);
       break;
     }
-    case pas::ast::AddOp::Or: {
-      value = current_func_builder_->CreateLogicalOr(value, rhs_value);
+    if (unify_reals(value, rhs_value)) {
+      value.value =
+          current_func_builder_->CreateFAdd(value.value, rhs_value.value);
       break;
     }
-    default:
-      assert(false);
-      __builtin_unreachable();
+    check_operand_kinds("+", lhs_kind == TypeKind::Integer,
+                        rhs_kind == TypeKind::Integer);
+    value.value =
+        current_func_builder_->CreateAdd(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::AddOp::Minus: {
+    if (is_set_op) {
+      check_operand_kinds("-", lhs_kind == TypeKind::Set,
+                          rhs_kind == TypeKind::Set);
+      value = codegen_set_difference(value, rhs_value);
+      break;
     }
+    if (unify_reals(value, rhs_value)) {
+      value.value =
+          current_func_builder_->CreateFSub(value.value, rhs_value.value);
+      break;
+    }
+    check_operand_kinds("-", lhs_kind == TypeKind::Integer,
+                        rhs_kind == TypeKind::Integer);
+    value.value =
+        current_func_builder_->CreateSub(value.value, rhs_value.value);
+    break;
+  }
+  case pas::ast::AddOp::Or: {
+    check_operand_kinds("or", lhs_kind == TypeKind::Boolean,
+                        rhs_kind == TypeKind::Boolean);
+    value.value =
+        current_func_builder_->CreateLogicalOr(value.value, rhs_value.value);
+    break;
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
   }
   return value;
 }
 
-llvm::Value *Lowerer::eval(pas::ast::Expr &expr) {
-  llvm::Value *value = eval(expr.start_expr_);
-  if (expr.op_.has_value()) {
-    pas::ast::Expr::Op &op = expr.op_.value();
-    switch (op.rel) {
-    case pas::ast::RelOp::Equal: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpEQ(value, rhs_value);
-    }
-    case pas::ast::RelOp::GreaterEqual: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpSGE(value, rhs_value);
-    }
-    case pas::ast::RelOp::Greater: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpSGT(value, rhs_value);
-    }
-    case pas::ast::RelOp::LessEqual: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpSLE(value, rhs_value);
-    }
-    case pas::ast::RelOp::Less: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpSLT(value, rhs_value);
-    }
-    case pas::ast::RelOp::NotEqual: {
-      llvm::Value *rhs_value = eval(op.expr);
-      return current_func_builder_->CreateICmpNE(value, rhs_value);
+Lowerer::TypedValue Lowerer::apply_rel_op(pas::ast::RelOp rel,
+                                          TypedValue value,
+                                          TypedValue rhs_value) {
+  if (rel == pas::ast::RelOp::In) {
+    if (rhs_value.type->kind != TypeKind::Set) {
+      throw SemanticProblemException(
+          "right hand side of \"in\" must be a set");
     }
-    case pas::ast::RelOp::In: {
-      // Dispose "value" here.
-      throw NotImplementedException("relation \"in\" is not supported");
+    return codegen_set_contains(rhs_value, value);
+  }
+  if (value.type->kind == TypeKind::Set ||
+      rhs_value.type->kind == TypeKind::Set) {
+    return codegen_set_compare(rel, value, rhs_value);
+  }
+
+  if (value.type->kind == TypeKind::Pointer) {
+    if (!is_compatible_pointer(value.type, rhs_value.type) &&
+        !is_compatible_pointer(rhs_value.type, value.type)) {
+      throw SemanticProblemException(
+          "incompatible types, pointers must reference the same type");
     }
-    default:
-      assert(false);
-      __builtin_unreachable();
+    if (rel != pas::ast::RelOp::Equal &&
+        rel != pas::ast::RelOp::NotEqual) {
+      throw SemanticProblemException(
+          "pointers can only be compared with = and <>");
     }
+    rhs_value.type = value.type;
   }
-  return value;
+  if (unify_reals(value, rhs_value)) {
+    return codegen_real_compare(rel, value, rhs_value);
+  }
+  if (value.type != rhs_value.type) {
+    throw SemanticProblemException(
+        "incompatible types, must be of the same type for comparison");
+  }
+  // Strings are compared by the runtime. = and <> compare the result of
+  //   the equality test with true, the others compare the ordering
+  //   (-1, 0 or 1) with 0.
+  if (value.type->kind == TypeKind::String &&
+      (rel == pas::ast::RelOp::Equal ||
+       rel == pas::ast::RelOp::NotEqual)) {
+    value = codegen_string_equal(value, rhs_value);
+    rhs_value = TypedValue(current_func_builder_->getTrue(), boolean_type_);
+  } else if (value.type->kind == TypeKind::String) {
+    value = codegen_string_compare(value, rhs_value);
+    rhs_value = TypedValue(current_func_builder_->getInt32(0), integer_type_);
+  }
+  if (value.type->kind != TypeKind::Integer &&
+      value.type->kind != TypeKind::Char &&
+      value.type->kind != TypeKind::Boolean &&
+      value.type->kind != TypeKind::Pointer) {
+    throw NotImplementedException(
+        "comparison is only supported for ordinal types and sets");
+  }
+
+  // Chars and booleans are unsigned.
+  bool is_signed = value.type->kind == TypeKind::Integer;
+  llvm::CmpInst::Predicate predicate;
+  switch (rel) {
+  case pas::ast::RelOp::Equal: {
+    predicate = llvm::CmpInst::ICMP_EQ;
+    break;
+  }
+  case pas::ast::RelOp::GreaterEqual: {
+    predicate = is_signed ? llvm::CmpInst::ICMP_SGE : llvm::CmpInst::ICMP_UGE;
+    break;
+  }
+  case pas::ast::RelOp::Greater: {
+    predicate = is_signed ? llvm::CmpInst::ICMP_SGT : llvm::CmpInst::ICMP_UGT;
+    break;
+  }
+  case pas::ast::RelOp::LessEqual: {
+    predicate = is_signed ? llvm::CmpInst::ICMP_SLE : llvm::CmpInst::ICMP_ULE;
+    break;
+  }
+  case pas::ast::RelOp::Less: {
+    predicate = is_signed ? llvm::CmpInst::ICMP_SLT : llvm::CmpInst::ICMP_ULT;
+    break;
+  }
+  case pas::ast::RelOp::NotEqual: {
+    predicate = llvm::CmpInst::ICMP_NE;
+    break;
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+  return TypedValue(current_func_builder_->CreateICmp(predicate, value.value,
+                                                      rhs_value.value),
+                    boolean_type_);
 }
 
 void Lowerer::visit_write_int(pas::ast::ProcCall &proc_call) {
@@ -602,23 +1709,39 @@ void Lowerer::visit_write_int(pas::ast::ProcCall &proc_call) {
     throw pas::SemanticProblemException(
         "procedure write_int accepts only one parameter of type Integer");
   }
-  // TODO: typecheck the type.
-
-  llvm::Value *arg = eval(proc_call.params_[0]);
 
-  // if (arg.index() != get_idx(TypeKind::Integer)) {
-  //   throw pas::SemanticProblemException(
-  //       "procedure write_int parameter must be of type Integer");
-  // }
+  TypedValue arg = eval(proc_call.params_[0]);
+  if (arg.type->kind != TypeKind::Integer) {
+    throw pas::SemanticProblemException(
+        "procedure write_int parameter must be of type Integer");
+  }
 
   // https://stackoverflow.com/a/22310371
-  llvm::Function *write_int_func = module_uptr_->getFunction("write_int");
-  if (write_int_func == nullptr) {
-    throw pas::RuntimeProblemException("compiler internal error: write_int was "
-                                       "not declared, but it must have been");
+  current_func_builder_->CreateCall(
+      get_runtime_function("pas_write_int", current_func_builder_->getVoidTy(),
+                           {current_func_builder_->getInt32Ty()}),
+      {arg.value});
+  release_string_temporaries();
+}
+
+void Lowerer::visit_write_real(pas::ast::ProcCall &proc_call) {
+  if (proc_call.params_.size() != 1) {
+    throw pas::SemanticProblemException(
+        "procedure write_real accepts only one parameter of type Real");
   }
-  std::vector<llvm::Value *> write_int_args = {arg};
-  current_func_builder_->CreateCall(write_int_func, write_int_args);
+
+  TypedValue arg = eval(proc_call.params_[0]);
+  if (!is_number(arg.type->kind)) {
+    throw pas::SemanticProblemException(
+        "procedure write_real parameter must be of type Real");
+  }
+
+  current_func_builder_->CreateCall(
+      get_runtime_function("pas_write_real",
+                           current_func_builder_->getVoidTy(),
+                           {current_func_builder_->getDoubleTy()}),
+      {codegen_convert(arg, real_type_)});
+  release_string_temporaries();
 }
 
 void Lowerer::visit_write_str(pas::ast::ProcCall &proc_call) {
@@ -627,17 +1750,48 @@ void Lowerer::visit_write_str(pas::ast::ProcCall &proc_call) {
         "procedure write_str accepts only one parameter of type String");
   }
 
-  // Value arg = eval(proc_call.params_[0]);
-
-  // if (arg.index() != get_idx(ValueKind::String)) {
-  //   throw SemanticProblemException(
-  //       "procedure write_str parameter must be of type String");
-  // }
+  TypedValue arg = eval(proc_call.params_[0]);
+  if (arg.type->kind != TypeKind::String) {
+    throw SemanticProblemException(
+        "procedure write_str parameter must be of type String");
+  }
 
-  // std::cout << std::get<std::string>(arg);
+  current_func_builder_->CreateCall(
+      get_runtime_function("pas_write_str", current_func_builder_->getVoidTy(),
+                           {get_llvm_string_type()->getPointerTo()}),
+      {arg.value});
+  release_string_temporaries();
 }
 
-void Lowerer::visit(pas::ast::WhileStmt &while_stmt) {}
+void Lowerer::visit(pas::ast::WhileStmt &while_stmt) {
+  // Counters: executions of the statement and of the body.
+  ProfileSite site = add_profile_site("while", while_stmt.loc_, 2);
+  codegen_profile_increment(site, 0);
+  llvm::BasicBlock *cond_block =
+      llvm::BasicBlock::Create(context_, "while_cond", current_func_);
+  llvm::BasicBlock *body_block =
+      llvm::BasicBlock::Create(context_, "while_body", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "while_end", current_func_);
+  current_func_builder_->CreateBr(cond_block);
+
+  current_func_builder_->SetInsertPoint(cond_block);
+  llvm::Value *cond = eval_condition(while_stmt.cond_expr_);
+  llvm::BranchInst *branch =
+      current_func_builder_->CreateCondBr(cond, body_block, exit_block);
+  if (!site.counts.empty()) {
+    set_branch_weights(branch, {site.counts[1], site.counts[0]});
+  }
+
+  current_func_builder_->SetInsertPoint(body_block);
+  codegen_profile_increment(site, 1);
+  lower_stmt(while_stmt.inner_stmt_);
+  codegen_budget_tick();
+  // Pascal doesn't require loops to terminate, so no mustprogress here.
+  add_loop_metadata(current_func_builder_->CreateBr(cond_block), false);
+
+  current_func_builder_->SetInsertPoint(exit_block);
+}
 
 } // namespace visitor
 } // namespace pas
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <variant>
+#include <vector>
 
+#include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -10,10 +16,30 @@
 #include "ast/ast.hpp"
 #include "ast/utils/get_idx.hpp"
 #include "ast/visit.hpp"
+#include "stdlib/profile.hpp"
 
 namespace pas {
 namespace visitor {
 
+struct LowererOptions {
+  // DWARF debug info, so that debuggers and profilers see Pascal lines and
+  //   procedures.
+  bool debug_info = false;
+  // Instrumented program writes its profile to this file at exit.
+  std::optional<std::string> profile_generate_path;
+  // Profile to optimize for, read from -fprofile-use file.
+  const pas::profile::Profile *profile = nullptr;
+  // Floating point operations may be reassociated and approximated,
+  //   assuming there are no NaNs and infinities, as with -ffast-math of C
+  //   compilers.
+  bool fast_math = false;
+  // Instruction budget (-fbudget) in ticks and wall clock limit
+  //   (-ftime-limit) of untrusted programs, 0 is no limit. Ticks are
+  //   counted, if either is set (stdlib/budget.hpp).
+  uint64_t budget_ticks = 0;
+  uint64_t time_limit_ms = 0;
+};
+
 // Примеры IR-а.
 //   https://mcyoung.xyz/2023/08/01/llvm-ir/
 
@@ -24,81 +50,422 @@ public:
     llvm::InitializeNativeTargetAsmPrinter();
   }
 
+  using Options = LowererOptions;
+
   Lowerer(llvm::LLVMContext &context, const std::string &file_name,
-          pas::ast::CompilationUnit &cu);
+          pas::ast::CompilationUnit &cu, const Options &options = Options());
 
   std::unique_ptr<llvm::Module> release_module();
 
+  // Sizes of the symbol tables (pascal_scopes_), -fmem-report.
+  struct ScopeStats {
+    // Scopes, that were closed, and the deepest nesting of them.
+    size_t scopes = 0;
+    size_t max_depth = 0;
+    // Identifiers of all the scopes and the most of them, that were
+    //   visible at once.
+    size_t symbols = 0;
+    size_t max_visible_symbols = 0;
+    // Estimated heap of the hash tables of the visible scopes at most.
+    size_t max_bytes = 0;
+  };
+  const ScopeStats &get_scope_stats() const { return scope_stats_; }
+
 private:
   MAKE_VISIT_STMT_FRIEND();
 
-  llvm::Value *eval(pas::ast::Factor &factor);
-  llvm::Value *eval(pas::ast::Term &term);
-  llvm::Value *eval(pas::ast::SimpleExpr &simple_expr);
-  llvm::Value *eval(pas::ast::Expr &expr);
+  struct TypedValue;
+  TypedValue eval(pas::ast::Factor &factor);
+  TypedValue eval(pas::ast::Term &term);
+  TypedValue eval(pas::ast::SimpleExpr &simple_expr);
+  TypedValue eval(pas::ast::Expr &expr);
+
+  // Expressions are evaluated from an explicit stack of the operands, that
+  //   are being evaluated, not recursively: parentheses and "not"s may nest
+  //   deeper, than the stack of the thread allows. Factors, that contain
+  //   expressions otherwise (indices, arguments), evaluate them with a new
+  //   stack of operands.
+  using Operand = std::variant<pas::ast::Expr *, pas::ast::SimpleExpr *,
+                               pas::ast::Term *, pas::ast::Factor *>;
+  struct OperandFrame;
+  TypedValue eval_operand(Operand operand);
+  // Pushes the frames of the operand and of its first operands down to a
+  //   factor, that is not a nested expression, and returns its value.
+  TypedValue start_operand(Operand operand,
+                           std::vector<OperandFrame> &frames);
+  TypedValue eval_leaf_factor(pas::ast::Factor &factor);
+  TypedValue apply_negation(TypedValue value);
+  TypedValue apply_mult_op(pas::ast::MultOp op, TypedValue lhs,
+                           TypedValue rhs);
+  TypedValue apply_unary_op(pas::ast::UnaryOp op, TypedValue value);
+  TypedValue apply_add_op(pas::ast::AddOp op, TypedValue lhs, TypedValue rhs);
+  TypedValue apply_rel_op(pas::ast::RelOp rel, TypedValue lhs, TypedValue rhs);
 
   void visit(pas::ast::CompilationUnit &cu);
   void visit(pas::ast::ProgramModule &pm);
-  void visit_toplevel(pas::ast::Block &block);
+  void visit_toplevel(pas::ast::ProgramModule &pm);
 
   void process_decls(pas::ast::Declarations &decls);
   void process_type_def(pas::ast::TypeDef &type_def);
   void process_var_decl(pas::ast::VarDecl &var_decl);
 
-  struct PointerType;
   enum class TypeKind : size_t {
     // Base types
     Integer = 0,
     Char = 1,
     String = 2,
+    Boolean = 3,
+
+    // Composite types.
+    Array = 4,
+    Set = 5,
+    Record = 6,
 
     // Pointer to another value.
-    // Pointer = 3
+    Pointer = 7,
+
+    // File of values of the item type, item type is null for Text.
+    File = 8,
+
+    // Double precision floating point number.
+    Real = 9,
+
+    // Handles of the runtime (stdlib/task.hpp), item type is the result
+    //   type of a task, null for procedures, and the type of the values of
+    //   a channel.
+    Task = 10,
+    Channel = 11
+  };
+
+  struct Type;
+  struct Field;
+  // Types must be referenced as shared_ptrs: the same type object is
+  //   referenced by all of the synonims, variables and composite types
+  //   built on top of it. Objects in unordered_map can move around memory,
+  //   so we can't just point into the scopes.
+  using TypeSP = std::shared_ptr<Type>;
+
+  // Inclusive bounds of a subrange, e.g. 1..10.
+  struct Bounds {
+    int low;
+    int high;
+  };
+
+  struct Field {
+    std::string name;
+    TypeSP type;
+    unsigned index;
   };
 
   // Always unveiled, synonims are expanded, when type is added to the
   // identifier mapping.
-  // using Type = std::variant<std::monostate, std::monostate,
-  //                           std::monostate>;
-  //        // Types must be referenced as shared_ptrs:
-  //        //   the objects in unordered_map (and plain map, almost any
-  //        container)
-  //        //   can move around memory, we have to account for that.
-  //        // For an unordered map, if it is a hashtable, it happens, then
-  //        //   there's too much chance of collision, we have to expand
-  //        //   storage so that items are evenly spread.
-  //        std::shared_ptr<Type> ref_type;
-  //    };
-
-  llvm::AllocaInst *codegen_alloc_value_of_type(TypeKind type);
-  TypeKind make_type_from_ast_type(pas::ast::Type &type);
-  llvm::Type *get_llvm_type_by_lang_type(TypeKind type);
+  struct Type {
+    TypeKind kind;
+
+    // Array: bounds of the index and the type of an item. Multidimensional
+    //   arrays are arrays of arrays, "array[1..2, 1..3] of T" is the same as
+    //   "array[1..2] of array[1..3] of T". This way storage is contiguous
+    //   and row-major.
+    // Set: bounds of the base subrange, bit i is element low + i.
+    // Pointer: item type is the referenced type, it is null for nil.
+    Bounds bounds = {0, 0};
+    TypeSP item_type;
+
+    // Record: fields in the order of declaration. Field index is the
+    //   position of the field in the LLVM struct, which may differ.
+    std::vector<Field> fields;
+    bool packed = false;
+  };
+
+  struct TypedValue {
+    llvm::Value *value;
+    TypeSP type;
+  };
+
+  llvm::AllocaInst *codegen_alloc_value_of_type(const TypeSP &type);
+  TypeSP make_type_from_ast_type(pas::ast::Type &type);
+  llvm::Type *get_llvm_type_by_lang_type(const TypeSP &type);
+  // ABI alignment of the type in memory, as on common 64-bit targets.
+  //   Used for the layout of records, before the data layout is known.
+  uint64_t get_type_alignment(const TypeSP &type);
+  uint64_t get_type_size(const TypeSP &type);
+  TypeSP make_record_type(pas::ast::RecordType &record_type);
+  // Pointers may reference types declared later in the same type section,
+  //   "^Node" in "Node = record next: ^Node end".
+  void resolve_pointer_types();
+  // Pointers to the same type are compatible, nil is compatible with all.
+  static bool is_compatible_pointer(const TypeSP &from, const TypeSP &to);
+  int eval_const_factor(pas::ast::ConstFactor &const_factor);
+  int eval_const_expr(pas::ast::ConstExpr &const_expr);
+
+  // Converts value to the type, if the language allows it implicitly.
+  llvm::Value *codegen_convert(TypedValue value, const TypeSP &type);
+
+  // Reals are doubles. An Integer is converted to Real, where a Real is
+  //   expected, and when it is an operand of an operation with a Real.
+  //   Implemented in lowerer_reals.cpp.
+  static bool is_number(TypeKind kind);
+  llvm::Value *codegen_int_to_real(llvm::Value *value);
+  // Converts both operands to Real, if one of them is Real and the other
+  //   is a number, returns false otherwise.
+  bool unify_reals(TypedValue &lhs, TypedValue &rhs);
+  TypedValue codegen_real_compare(pas::ast::RelOp rel, TypedValue lhs,
+                                  TypedValue rhs);
+  // Sets the fast-math flags of the builder and the attributes of the
+  //   function, if the option is on.
+  void set_fast_math(llvm::Function *function, llvm::IRBuilder<> &builder);
+
+  // Sets are bitsets. Up to 64 elements fit into one integer register,
+  //   larger sets are vectors of 64-bit words, so that union, intersection
+  //   and comparison are done for all of the words at once (SIMD).
+  //   Implemented in lowerer_sets.cpp.
+  static constexpr int64_t kMaxSetElements = 4096;
+  llvm::Type *get_llvm_set_type(const Bounds &bounds);
+  TypedValue eval(pas::ast::SetValue &set_value);
+  llvm::Value *codegen_set_convert(llvm::Value *value, const TypeSP &from,
+                                   const TypeSP &to);
+  // Converts both operands to a set type, that can hold both of them.
+  TypeSP unify_sets(TypedValue &lhs, TypedValue &rhs);
+  TypedValue codegen_set_union(TypedValue lhs, TypedValue rhs);
+  TypedValue codegen_set_intersection(TypedValue lhs, TypedValue rhs);
+  TypedValue codegen_set_difference(TypedValue lhs, TypedValue rhs);
+  TypedValue codegen_set_compare(pas::ast::RelOp rel, TypedValue lhs,
+                                 TypedValue rhs);
+  TypedValue codegen_set_contains(TypedValue set, TypedValue element);
 
   struct Variable {
-    llvm::AllocaInst *allocation;
-    TypeKind type;
+    llvm::Value *allocation;
+    TypeSP type;
   };
 
-  std::variant<TypeKind, Variable> *lookup_decl(const std::string &identifier);
+  // All parameters are var parameters, they are passed as pointers to the
+  //   variables of the caller. Result type is null for procedures.
+  struct Subprogram {
+    llvm::Function *function;
+    std::vector<TypeSP> param_types;
+    TypeSP result_type;
+  };
+
+  using Decl = std::variant<TypeSP, Variable, Subprogram>;
+
+  // Strings are values of { i32 length, i32 capacity, [2 x i64] storage },
+  //   see stdlib/string.hpp, all of the work is done by the runtime.
+  //   Expressions of type String evaluate to the address of the value.
+  //   Results of concatenation are temporaries, they are released at the
+  //   end of the statement, unless moved into a variable.
+  //   Implemented in lowerer_strings.cpp.
+  llvm::StructType *get_llvm_string_type();
+  TypedValue eval_string_literal(const std::string &text);
+  llvm::Value *codegen_string_temporary();
+  bool is_string_temporary(llvm::Value *value);
+  void release_string_temporaries();
+  TypedValue codegen_string_concat(TypedValue lhs, TypedValue rhs);
+  // Returns lhs compared with rhs as an Integer -1, 0 or 1.
+  TypedValue codegen_string_compare(TypedValue lhs, TypedValue rhs);
+  // Returns lhs = rhs as a Boolean. Lengths are compared inline, the
+  //   characters only if the lengths are equal.
+  TypedValue codegen_string_equal(TypedValue lhs, TypedValue rhs);
+  void codegen_string_assign(Variable target, pas::ast::Designator &designator,
+                             pas::ast::Expr &expr);
+  // Strings inside of arrays and records are owned by them too.
+  static bool contains_string(const TypeSP &type);
+  void codegen_for_each_string(llvm::Value *address, const TypeSP &type,
+                               const std::string &function_name);
+  void codegen_init_strings(Variable variable);
+
+  // Computes address of the designated value. Element accesses are
+  //   accumulated and emitted as a single getelementptr.
+  Variable resolve_designator(pas::ast::Designator &designator);
+  // Returns the designator, if expression consists of it only. Aggregates
+  //   are copied from memory to memory, not through registers.
+  static pas::ast::Designator *as_plain_designator(pas::ast::Expr &expr);
+
+  Decl *lookup_decl(const std::string &identifier);
+
+  // Declares a function of the runtime library (stdlib.hpp) on first use.
+  llvm::FunctionCallee
+  get_runtime_function(const std::string &name, llvm::Type *result_type,
+                       llvm::ArrayRef<llvm::Type *> param_types);
 
 private:
+  // Procedures and functions of the program. Prototypes are declared
+  //   before any body is lowered, so calls may go forward and recurse.
+  //   String results are written through a hidden first parameter into a
+  //   temporary of the caller, other results are returned by value.
+  //   Implemented in lowerer_subprograms.cpp.
+  void declare_subprogram(pas::ast::SubprogDecl &subprog_decl);
+  void lower_subprogram(pas::ast::SubprogDecl &subprog_decl);
+  // Finds the innermost procedure or function, variables are skipped, so
+  //   that the result variable doesn't hide the function inside of it.
+  Subprogram *lookup_subprogram(const std::string &identifier);
+  // Returns the result, its value is null for procedures.
+  TypedValue codegen_call(const std::string &name,
+                          std::vector<pas::ast::Expr> &params);
+  TypedValue eval(pas::ast::FuncCall &func_call);
+  void release_variables(std::vector<pas::ast::VarDecl> &var_decls);
+
+  // Standard functions (abs, ord, length, ...) are lowered inline to
+  //   instructions and intrinsics, not to runtime calls, so that they fold
+  //   and vectorize. eof calls the runtime only at the end of the buffer,
+  //   pos calls the vectorized search of the runtime. Functions of the
+  //   program with the same names hide them. Implemented in
+  //   lowerer_builtins.cpp.
+  struct Builtin {
+    // All of the parameters are of the same type of one of these kinds.
+    std::vector<TypeKind> param_kinds;
+    // "of type Integer" and etc., for the errors.
+    const char *param_description;
+    size_t num_params;
+    TypedValue (*lower)(Lowerer &lowerer, std::vector<TypedValue> &args);
+  };
+  // Returns null, if there is no such builtin.
+  static const Builtin *lookup_builtin(const std::string &name);
+  TypedValue eval_builtin(const std::string &name, const Builtin &builtin,
+                          std::vector<pas::ast::Expr> &params);
+
+  // Objects of the local pointers, that don't escape the procedure (see
+  //   escape_analysis.hpp), are allocated on its stack.
+  static constexpr uint64_t kMaxStackObjectSize = 4096;
+  void promote_objects_to_stack(pas::ast::Block &block);
+
+  // Debug info: a compile unit for the file, a subprogram for every
+  //   function and a location for every statement. Does nothing, unless
+  //   enabled. Implemented in lowerer_debug_info.cpp.
+  void create_debug_compile_unit(const std::string &file_name);
+  void create_debug_subprogram(llvm::Function *function,
+                               const std::string &name,
+                               const pas::ast::SourceLoc &loc);
+  void finalize_debug_subprogram();
+  void set_debug_location(const pas::ast::SourceLoc &loc);
+
+  // Profile guided optimization. A site is a procedure entry, an if, a
+  //   loop or a case with a few counters. Instrumented code increments
+  //   them, main writes them to the file at exit (stdlib/profile.hpp).
+  //   With a profile, the counts of the sites become branch weights and
+  //   entry counts. Sites are numbered in the order of lowering, so that
+  //   both modes see the same sites. Implemented in lowerer_profile.cpp.
+  struct ProfileSite {
+    size_t first_counter;
+    // Counts from the profile, empty if there's no profile or it doesn't
+    //   match the program.
+    std::vector<uint64_t> counts;
+  };
+  void begin_profile_function(const pas::ast::SourceLoc &loc);
+  ProfileSite add_profile_site(const std::string &kind,
+                               const pas::ast::SourceLoc &loc,
+                               size_t num_counters);
+  void codegen_profile_increment(const ProfileSite &site, size_t counter,
+                                 llvm::Value *step = nullptr);
+  // Weights from the counts, scaled to 32 bits. Null without profile.
+  llvm::MDNode *make_branch_weights(llvm::ArrayRef<uint64_t> counts);
+  void set_branch_weights(llvm::Instruction *branch,
+                          llvm::ArrayRef<uint64_t> counts);
+  void codegen_profile_write();
+  void add_profile_summary();
+
+  // Budget of untrusted programs. A tick is counted at the entry of every
+  //   procedure and on the back edge of every loop, the program starts the
+  //   clock. Implemented in lowerer_budget.cpp.
+  bool is_budget_enabled() const {
+    return options_.budget_ticks != 0 || options_.time_limit_ms != 0;
+  }
+  llvm::GlobalVariable *get_budget_counter();
+  void codegen_budget_start();
+  void codegen_budget_tick();
+
+  // Weights of the inline fast paths against the calls of the runtime.
+  static constexpr uint32_t kFastPathWeight = 1000;
+  static constexpr uint32_t kSlowPathWeight = 1;
+
+  // Files of stdlib/file.hpp: Text and typed files of plain data. Values of
+  //   typed files are accessed right in the buffer of the file, the runtime
+  //   is called only to refill it. Without a file, read and readln read
+  //   standard input. Implemented in lowerer_files.cpp.
+  llvm::StructType *get_llvm_file_type();
+  // Values are copied to and from files byte by byte, so they can't own
+  //   or reference anything.
+  static bool is_plain_data(const TypeSP &type);
+  TypeSP make_file_type(pas::ast::FileType &file_type);
+  // Returns the address of the current value of a typed file (f^) in the
+  //   buffer, aborts at the end of the file.
+  llvm::Value *codegen_file_value(llvm::Value *file, const TypeSP &type);
+  // Moves on to the next value, value is the current one.
+  void codegen_file_advance(llvm::Value *file, llvm::Value *value,
+                            const TypeSP &type);
+  // Returns true, if there are no more values or characters.
+  llvm::Value *codegen_file_eof(llvm::Value *file, const TypeSP &type);
+  // Returns the first parameter, if it is a file, null value otherwise.
+  TypedValue eval_file_param(std::vector<pas::ast::Expr> &params);
+  TypedValue codegen_input_file();
+  void visit_read(pas::ast::ProcCall &proc_call, bool is_readln);
+  void visit_write(pas::ast::ProcCall &proc_call, bool is_writeln);
+  // assign, reset, rewrite, close and get.
+  void visit_file_procedure(pas::ast::ProcCall &proc_call);
+
+  // New and Dispose use the pool allocator of stdlib/alloc.hpp, the fast
+  //   paths are inline. Implemented in lowerer_memory.cpp.
   void visit(pas::ast::MemoryStmt &memory_stmt);
+  llvm::Value *get_alloc_cache();
+  llvm::Value *codegen_new(const TypeSP &type);
+  void codegen_dispose(llvm::Value *object, const TypeSP &type,
+                       bool on_stack);
+
+  // Tasks and channels of stdlib/task.hpp. spawn(t, p(a, b)) copies the
+  //   arguments into the frame of the task, as value parameters, and a
+  //   small function calls p with the copies on a thread of the pool.
+  //   await(t) waits for the task, as a function it returns the result.
+  //   Arguments, results and channel items are copied by the runtime byte
+  //   by byte, so they are plain data, pointers or channels. Implemented
+  //   in lowerer_tasks.cpp.
+  static bool is_transferable(const TypeSP &type);
+  TypeSP make_task_type(pas::ast::TaskType &task_type);
+  TypeSP make_channel_type(pas::ast::ChannelType &channel_type);
+  // Frame is { result, parameters... }, the result is omitted for
+  //   procedures.
+  llvm::StructType *get_task_frame_type(const Subprogram &subprogram);
+  llvm::Function *get_task_body(const Subprogram &subprogram);
+  // Waits for the task and returns its handle (the address of the frame).
+  llvm::Value *codegen_await(Variable task);
+  void codegen_task_release(Variable task, llvm::Value *handle);
+  // spawn, await, new_channel, send, close_channel and dispose_channel.
+  void visit_task_procedure(pas::ast::ProcCall &proc_call);
+  // await(t) of a task of a function and receive(c, x), which returns
+  //   false, when the channel is closed and empty.
+  TypedValue eval_task_function(pas::ast::FuncCall &func_call);
+
+  // Marks the branch as the latch of a loop, so that loop passes can
+  //   recognize it. Counted (for) loops always terminate, others may not.
+  void add_loop_metadata(llvm::BranchInst *latch_branch, bool must_progress);
+  llvm::Value *eval_condition(pas::ast::Expr &expr);
   void visit(pas::ast::RepeatStmt &repeat_stmt);
+  // Label ranges up to this size are expanded into separate switch cases.
+  static constexpr int64_t kMaxExpandedCaseRange = 256;
   void visit(pas::ast::CaseStmt &case_stmt);
 
   void visit(pas::ast::StmtSeq &stmt_seq);
+  // Code of the statement is attributed to its line.
+  void lower_stmt(pas::ast::Stmt &stmt);
 
   void visit(pas::ast::IfStmt &if_stmt);
 
   void visit(pas::ast::EmptyStmt &empty_stmt);
 
   void visit(pas::ast::ForStmt &for_stmt);
+  // Parallel for loops. The body is outlined into a function of a range
+  //   of iterations, that the pool of stdlib/parallel.hpp runs on its
+  //   threads. Variables of the procedure are passed to it by reference,
+  //   reduction variables are accumulated privately by every chunk and
+  //   added to the shared ones atomically. Implemented in
+  //   lowerer_parallel.cpp.
+  void visit_parallel_for(pas::ast::ForStmt &for_stmt, Variable control,
+                          llvm::Value *start, llvm::Value *finish);
 
   void visit(pas::ast::Assignment &assignment);
 
   void visit(pas::ast::ProcCall &proc_call);
   void visit_write_int(pas::ast::ProcCall &proc_call);
   void visit_write_str(pas::ast::ProcCall &proc_call);
+  void visit_write_real(pas::ast::ProcCall &proc_call);
 
   void visit(pas::ast::WhileStmt &while_stmt);
 
@@ -143,8 +510,49 @@ private:
   //   константа (immediate const, типо 5 и 2 в 5+2); не только то, что в
   //   выражениях типо 5+2 с обеих сторон числа.
   // Во время проверки типов рекурсивной производится и сама кодонерегация.
-  std::vector<std::unordered_map<PascalIdent, std::variant<TypeKind, Variable>>>
-      pascal_scopes_;
+  std::vector<std::unordered_map<PascalIdent, Decl>> pascal_scopes_;
+  // Pops the innermost scope, its size goes to the stats first.
+  void close_scope();
+  ScopeStats scope_stats_;
+
+  llvm::StructType *llvm_string_type_ = nullptr;
+  llvm::StructType *llvm_file_type_ = nullptr;
+  std::unordered_map<std::string, llvm::Constant *> string_literals_;
+  // Temporary strings of the current statement.
+  std::vector<llvm::Value *> string_temporaries_;
+  // Allocator cache of the current function, loaded on first use.
+  llvm::Value *alloc_cache_ = nullptr;
+  // Stack slots of New for the local pointers of the current function.
+  std::unordered_map<PascalIdent, llvm::AllocaInst *> stack_objects_;
+  std::vector<std::pair<TypeSP, std::string>> unresolved_pointer_types_;
+
+  Options options_;
+
+  std::unique_ptr<llvm::DIBuilder> di_builder_;
+  llvm::DIFile *di_file_ = nullptr;
+
+  // Counters are referenced through a placeholder, until the number of
+  //   them is known.
+  llvm::GlobalVariable *profile_counters_ = nullptr;
+  size_t num_profile_counters_ = 0;
+  std::string profile_layout_;
+  // Sites of the current function in the profile, null after mismatch.
+  const std::vector<pas::profile::Site> *profile_sites_ = nullptr;
+  size_t profile_site_index_ = 0;
+  // Ticks left in the slice of the budget, the runtime refills it.
+  llvm::GlobalVariable *budget_counter_ = nullptr;
+  // Code of the current function runs on several threads, counters are
+  //   incremented atomically.
+  bool is_parallel_body_ = false;
+
+  // Builtin types, results of operations have these types.
+  TypeSP integer_type_;
+  TypeSP char_type_;
+  TypeSP string_type_;
+  TypeSP boolean_type_;
+  TypeSP real_type_;
+  TypeSP nil_type_;
+  TypeSP text_type_;
 
   // Чтобы посмотреть в действии, как работает трансляция, посмотрите видео
   // Андреаса Клинга.
@@ -0,0 +1,77 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+
+namespace pas {
+namespace visitor {
+
+// Procedures are lowered before main, the counter is made on first use.
+llvm::GlobalVariable *Lowerer::get_budget_counter() {
+  if (budget_counter_ == nullptr) {
+    llvm::Type *i64_type = llvm::Type::getInt64Ty(context_);
+    budget_counter_ = new llvm::GlobalVariable(
+        *module_uptr_, i64_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantInt::get(i64_type, 0), "budget.counter");
+    budget_counter_->setAlignment(llvm::Align(8));
+  }
+  return budget_counter_;
+}
+
+void Lowerer::codegen_budget_start() {
+  if (!is_budget_enabled()) {
+    return;
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::GlobalVariable *counter = get_budget_counter();
+  builder.CreateCall(
+      get_runtime_function("pas_budget_start", builder.getVoidTy(),
+                           {counter->getType(), builder.getInt64Ty(),
+                            builder.getInt64Ty()}),
+      {counter, builder.getInt64(options_.budget_ticks),
+       builder.getInt64(options_.time_limit_ms)});
+}
+
+void Lowerer::codegen_budget_tick() {
+  if (!is_budget_enabled()) {
+    return;
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::GlobalVariable *counter = get_budget_counter();
+  // Relaxed (monotonic) loads and stores are plain moves, but bodies of
+  //   parallel loops and tasks may race on the counter without UB. A lost
+  //   tick costs nothing, so there is no read-modify-write.
+  llvm::LoadInst *count = builder.CreateLoad(builder.getInt64Ty(), counter);
+  count->setAtomic(llvm::AtomicOrdering::Monotonic);
+  count->setAlignment(llvm::Align(8));
+  llvm::Value *next = builder.CreateSub(count, builder.getInt64(1));
+  llvm::StoreInst *store = builder.CreateStore(next, counter);
+  store->setAtomic(llvm::AtomicOrdering::Monotonic);
+  store->setAlignment(llvm::Align(8));
+
+  llvm::BasicBlock *refill_block =
+      llvm::BasicBlock::Create(context_, "budget_refill", current_func_);
+  llvm::BasicBlock *continue_block =
+      llvm::BasicBlock::Create(context_, "budget_end", current_func_);
+  builder.CreateCondBr(
+      builder.CreateICmpSLT(next, builder.getInt64(0)), refill_block,
+      continue_block,
+      llvm::MDBuilder(context_).createBranchWeights(kSlowPathWeight,
+                                                    kFastPathWeight));
+
+  builder.SetInsertPoint(refill_block);
+  llvm::CallInst *refill = builder.CreateCall(
+      get_runtime_function("pas_budget_refill", builder.getVoidTy(),
+                           {counter->getType()}),
+      {counter});
+  refill->addFnAttr(llvm::Attribute::Cold);
+  builder.CreateBr(continue_block);
+
+  builder.SetInsertPoint(continue_block);
+}
+
+} // namespace visitor
+} // namespace pas
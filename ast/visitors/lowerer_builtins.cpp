@@ -0,0 +1,227 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+const Lowerer::Builtin *Lowerer::lookup_builtin(const std::string &name) {
+  using Args = std::vector<TypedValue>;
+  static const std::vector<TypeKind> integer = {TypeKind::Integer};
+  static const std::vector<TypeKind> number = {TypeKind::Integer,
+                                               TypeKind::Real};
+  static const std::vector<TypeKind> ordinal = {
+      TypeKind::Integer, TypeKind::Char, TypeKind::Boolean};
+  static const std::unordered_map<std::string, Builtin> builtins = {
+      {"abs",
+       {number, "of type Integer or Real", 1,
+        [](Lowerer &lowerer, Args &args) {
+          llvm::IRBuilder<> &builder = *lowerer.current_func_builder_;
+          if (args[0].type->kind == TypeKind::Real) {
+            return TypedValue(builder.CreateUnaryIntrinsic(
+                                  llvm::Intrinsic::fabs, args[0].value),
+                              args[0].type);
+          }
+          // abs(-MaxInt - 1) wraps around, as the negation does.
+          return TypedValue(
+              builder.CreateBinaryIntrinsic(llvm::Intrinsic::abs,
+                                            args[0].value, builder.getFalse()),
+              args[0].type);
+        }}},
+      {"sqr",
+       {number, "of type Integer or Real", 1,
+        [](Lowerer &lowerer, Args &args) {
+          llvm::IRBuilder<> &builder = *lowerer.current_func_builder_;
+          return TypedValue(args[0].type->kind == TypeKind::Real
+                                ? builder.CreateFMul(args[0].value,
+                                                     args[0].value)
+                                : builder.CreateMul(args[0].value,
+                                                    args[0].value),
+                            args[0].type);
+        }}},
+      {"odd",
+       {integer, "of type Integer", 1,
+        [](Lowerer &lowerer, Args &args) {
+          return TypedValue(
+              lowerer.current_func_builder_->CreateTrunc(
+                  args[0].value, lowerer.current_func_builder_->getInt1Ty()),
+              lowerer.boolean_type_);
+        }}},
+      {"ord",
+       {ordinal, "of an ordinal type", 1,
+        [](Lowerer &lowerer, Args &args) {
+          // Chars and booleans are unsigned.
+          return TypedValue(
+              lowerer.current_func_builder_->CreateZExtOrTrunc(
+                  args[0].value, lowerer.current_func_builder_->getInt32Ty()),
+              lowerer.integer_type_);
+        }}},
+      {"chr",
+       {integer, "of type Integer", 1,
+        [](Lowerer &lowerer, Args &args) {
+          return TypedValue(
+              lowerer.current_func_builder_->CreateTrunc(
+                  args[0].value, lowerer.current_func_builder_->getInt8Ty()),
+              lowerer.char_type_);
+        }}},
+      {"succ",
+       {ordinal, "of an ordinal type", 1,
+        [](Lowerer &lowerer, Args &args) {
+          return TypedValue(lowerer.current_func_builder_->CreateAdd(
+                                args[0].value,
+                                llvm::ConstantInt::get(
+                                    args[0].value->getType(), 1)),
+                            args[0].type);
+        }}},
+      {"pred",
+       {ordinal, "of an ordinal type", 1,
+        [](Lowerer &lowerer, Args &args) {
+          return TypedValue(lowerer.current_func_builder_->CreateSub(
+                                args[0].value,
+                                llvm::ConstantInt::get(
+                                    args[0].value->getType(), 1)),
+                            args[0].type);
+        }}},
+      {"length",
+       {{TypeKind::String}, "of type String", 1,
+        [](Lowerer &lowerer, Args &args) {
+          // The length is the first field of the value, see
+          //   stdlib/string.hpp.
+          llvm::IRBuilder<> &builder = *lowerer.current_func_builder_;
+          return TypedValue(
+              builder.CreateLoad(
+                  builder.getInt32Ty(),
+                  builder.CreateStructGEP(lowerer.get_llvm_string_type(),
+                                          args[0].value, 0),
+                  "length"),
+              lowerer.integer_type_);
+        }}},
+      {"pos",
+       {{TypeKind::String}, "of type String", 2,
+        [](Lowerer &lowerer, Args &args) {
+          // pos(sub, s) searches with the vectorized kernel of the runtime.
+          llvm::IRBuilder<> &builder = *lowerer.current_func_builder_;
+          llvm::Type *pointer_type =
+              lowerer.get_llvm_string_type()->getPointerTo();
+          return TypedValue(
+              builder.CreateCall(
+                  lowerer.get_runtime_function("pas_string_pos",
+                                               builder.getInt32Ty(),
+                                               {pointer_type, pointer_type}),
+                  {args[0].value, args[1].value}),
+              lowerer.integer_type_);
+        }}},
+      {"sqrt",
+       {number, "of type Integer or Real", 1,
+        [](Lowerer &lowerer, Args &args) {
+          // The root is Real, of an Integer too. The root of a negative
+          //   number is NaN.
+          return TypedValue(
+              lowerer.current_func_builder_->CreateUnaryIntrinsic(
+                  llvm::Intrinsic::sqrt,
+                  lowerer.codegen_convert(args[0], lowerer.real_type_)),
+              lowerer.real_type_);
+        }}},
+      {"trunc",
+       {{TypeKind::Real}, "of type Real", 1,
+        [](Lowerer &lowerer, Args &args) {
+          // Rounds towards zero. The result is undefined, if it doesn't
+          //   fit into Integer.
+          return TypedValue(lowerer.current_func_builder_->CreateFPToSI(
+                                args[0].value,
+                                lowerer.current_func_builder_->getInt32Ty()),
+                            lowerer.integer_type_);
+        }}},
+      {"round",
+       {{TypeKind::Real}, "of type Real", 1,
+        [](Lowerer &lowerer, Args &args) {
+          // Halves are rounded away from zero.
+          llvm::IRBuilder<> &builder = *lowerer.current_func_builder_;
+          return TypedValue(
+              builder.CreateFPToSI(
+                  builder.CreateUnaryIntrinsic(llvm::Intrinsic::round,
+                                               args[0].value),
+                  builder.getInt32Ty()),
+              lowerer.integer_type_);
+        }}},
+      {"min",
+       {ordinal, "of an ordinal type", 2,
+        [](Lowerer &lowerer, Args &args) {
+          llvm::Intrinsic::ID id = args[0].type->kind == TypeKind::Integer
+                                       ? llvm::Intrinsic::smin
+                                       : llvm::Intrinsic::umin;
+          return TypedValue(
+              lowerer.current_func_builder_->CreateBinaryIntrinsic(
+                  id, args[0].value, args[1].value),
+              args[0].type);
+        }}},
+      {"max",
+       {ordinal, "of an ordinal type", 2,
+        [](Lowerer &lowerer, Args &args) {
+          llvm::Intrinsic::ID id = args[0].type->kind == TypeKind::Integer
+                                       ? llvm::Intrinsic::smax
+                                       : llvm::Intrinsic::umax;
+          return TypedValue(
+              lowerer.current_func_builder_->CreateBinaryIntrinsic(
+                  id, args[0].value, args[1].value),
+              args[0].type);
+        }}},
+      {"eof",
+       {{TypeKind::File}, "a file", 1,
+        [](Lowerer &lowerer, Args &args) {
+          return TypedValue(
+              lowerer.codegen_file_eof(args[0].value, args[0].type),
+              lowerer.boolean_type_);
+        }}},
+  };
+
+  auto it = builtins.find(name);
+  return it != builtins.end() ? &it->second : nullptr;
+}
+
+Lowerer::TypedValue
+Lowerer::eval_builtin(const std::string &name, const Builtin &builtin,
+                      std::vector<pas::ast::Expr> &params) {
+  std::vector<TypedValue> args;
+  // eof() is eof of the standard input.
+  if (params.empty() && builtin.param_kinds.size() == 1 &&
+      builtin.param_kinds[0] == TypeKind::File) {
+    args.push_back(codegen_input_file());
+    return builtin.lower(*this, args);
+  }
+  if (params.size() != builtin.num_params) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + name + ": expected " +
+        std::to_string(builtin.num_params) + ", got " +
+        std::to_string(params.size()));
+  }
+
+  for (pas::ast::Expr &param : params) {
+    args.push_back(eval(param));
+    const TypeSP &type = args.back().type;
+    if (std::find(builtin.param_kinds.begin(), builtin.param_kinds.end(),
+                  type->kind) == builtin.param_kinds.end()) {
+      throw pas::SemanticProblemException("parameters of " + name +
+                                          " must be " +
+                                          builtin.param_description);
+    }
+    if (type != args.front().type) {
+      throw pas::SemanticProblemException(
+          "incompatible types, parameters of " + name +
+          " must be of the same type");
+    }
+  }
+  return builtin.lower(*this, args);
+}
+
+} // namespace visitor
+} // namespace pas
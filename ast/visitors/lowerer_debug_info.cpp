@@ -0,0 +1,67 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include "ast/ast.hpp"
+
+namespace pas {
+namespace visitor {
+
+void Lowerer::create_debug_compile_unit(const std::string &file_name) {
+  module_uptr_->addModuleFlag(llvm::Module::Warning, "Debug Info Version",
+                              llvm::DEBUG_METADATA_VERSION);
+  module_uptr_->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+
+  // Debuggers look for the source by the directory and the name.
+  llvm::SmallString<128> path(file_name);
+  llvm::sys::fs::make_absolute(path);
+  di_builder_ = std::make_unique<llvm::DIBuilder>(*module_uptr_);
+  di_file_ = di_builder_->createFile(llvm::sys::path::filename(path),
+                                     llvm::sys::path::parent_path(path));
+  di_builder_->createCompileUnit(llvm::dwarf::DW_LANG_Pascal83, di_file_,
+                                 "pascal", false, "", 0);
+}
+
+void Lowerer::create_debug_subprogram(llvm::Function *function,
+                                      const std::string &name,
+                                      const pas::ast::SourceLoc &loc) {
+  if (di_builder_ == nullptr) {
+    return;
+  }
+  // Types of the parameters are not described, only the lines.
+  llvm::DISubroutineType *type = di_builder_->createSubroutineType(
+      di_builder_->getOrCreateTypeArray({}));
+  llvm::DISubprogram::DISPFlags flags = llvm::DISubprogram::SPFlagDefinition;
+  if (function->hasLocalLinkage()) {
+    flags |= llvm::DISubprogram::SPFlagLocalToUnit;
+  }
+  llvm::DISubprogram *subprogram = di_builder_->createFunction(
+      di_file_, name, function->getName(), di_file_, loc.line, type, loc.line,
+      llvm::DINode::FlagPrototyped, flags);
+  function->setSubprogram(subprogram);
+  // Prologue (allocas of the variables) belongs to the heading.
+  set_debug_location(loc);
+}
+
+void Lowerer::finalize_debug_subprogram() {
+  if (di_builder_ == nullptr) {
+    return;
+  }
+  di_builder_->finalizeSubprogram(current_func_->getSubprogram());
+  current_func_builder_->SetCurrentDebugLocation(llvm::DebugLoc());
+}
+
+void Lowerer::set_debug_location(const pas::ast::SourceLoc &loc) {
+  if (di_builder_ == nullptr || loc.line == 0) {
+    return;
+  }
+  current_func_builder_->SetCurrentDebugLocation(llvm::DILocation::get(
+      context_, loc.line, loc.column, current_func_->getSubprogram()));
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,394 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+#include "stdlib/file.hpp"
+
+namespace pas {
+namespace visitor {
+
+llvm::StructType *Lowerer::get_llvm_file_type() {
+  if (llvm_file_type_ == nullptr) {
+    llvm::Type *pointer_type = llvm::Type::getInt8Ty(context_)->getPointerTo();
+    llvm_file_type_ = llvm::StructType::create(
+        context_, {pointer_type, pointer_type, pointer_type}, "pas_file");
+  }
+  return llvm_file_type_;
+}
+
+bool Lowerer::is_plain_data(const TypeSP &type) {
+  switch (type->kind) {
+  case TypeKind::Integer:
+  case TypeKind::Char:
+  case TypeKind::Boolean:
+  case TypeKind::Real:
+  case TypeKind::Set:
+    return true;
+  case TypeKind::Array:
+    return is_plain_data(type->item_type);
+  case TypeKind::Record:
+    return std::all_of(type->fields.begin(), type->fields.end(),
+                       [](const Field &field) {
+                         return is_plain_data(field.type);
+                       });
+  default:
+    return false;
+  }
+}
+
+Lowerer::TypeSP Lowerer::make_file_type(pas::ast::FileType &file_type) {
+  TypeSP item_type = make_type_from_ast_type(file_type.item_type_);
+  if (!is_plain_data(item_type)) {
+    throw pas::SemanticProblemException(
+        "items of a file can't be or contain strings, pointers or files");
+  }
+  return std::make_shared<Type>(Type{TypeKind::File, {0, 0}, item_type});
+}
+
+llvm::Value *Lowerer::codegen_file_value(llvm::Value *file,
+                                         const TypeSP &type) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  uint64_t size = get_type_size(type->item_type);
+
+  // The value is in the buffer, unless it's the end of the buffer.
+  llvm::Value *pos = builder.CreateLoad(
+      pointer_type, builder.CreateStructGEP(get_llvm_file_type(), file, 0),
+      "file.pos");
+  llvm::Value *end = builder.CreateLoad(
+      pointer_type, builder.CreateStructGEP(get_llvm_file_type(), file, 1),
+      "file.end");
+  llvm::Value *available =
+      builder.CreateSub(builder.CreatePtrToInt(end, builder.getInt64Ty()),
+                        builder.CreatePtrToInt(pos, builder.getInt64Ty()));
+
+  llvm::BasicBlock *check_block = builder.GetInsertBlock();
+  llvm::BasicBlock *fill_block =
+      llvm::BasicBlock::Create(context_, "file_fill", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "file_value", current_func_);
+  builder.CreateCondBr(
+      builder.CreateICmpUGE(available, builder.getInt64(size)), exit_block,
+      fill_block,
+      llvm::MDBuilder(context_).createBranchWeights(kFastPathWeight,
+                                                    kSlowPathWeight));
+
+  builder.SetInsertPoint(fill_block);
+  llvm::Value *filled_pos = builder.CreateCall(
+      get_runtime_function("pas_file_fill_value", pointer_type,
+                           {file->getType(), builder.getInt64Ty()}),
+      {file, builder.getInt64(size)});
+  builder.CreateBr(exit_block);
+
+  builder.SetInsertPoint(exit_block);
+  llvm::PHINode *value = builder.CreatePHI(pointer_type, 2, "file.value");
+  value->addIncoming(pos, check_block);
+  value->addIncoming(filled_pos, fill_block);
+  return value;
+}
+
+void Lowerer::codegen_file_advance(llvm::Value *file, llvm::Value *value,
+                                   const TypeSP &type) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  builder.CreateStore(
+      builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), value,
+                                         get_type_size(type->item_type)),
+      builder.CreateStructGEP(get_llvm_file_type(), file, 0));
+}
+
+llvm::Value *Lowerer::codegen_file_eof(llvm::Value *file, const TypeSP &type) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  // Text files end, when there are no more characters.
+  uint64_t size =
+      type->item_type != nullptr ? get_type_size(type->item_type) : 1;
+
+  llvm::Value *pos = builder.CreateLoad(
+      pointer_type, builder.CreateStructGEP(get_llvm_file_type(), file, 0));
+  llvm::Value *end = builder.CreateLoad(
+      pointer_type, builder.CreateStructGEP(get_llvm_file_type(), file, 1));
+  llvm::Value *available =
+      builder.CreateSub(builder.CreatePtrToInt(end, builder.getInt64Ty()),
+                        builder.CreatePtrToInt(pos, builder.getInt64Ty()));
+
+  llvm::BasicBlock *check_block = builder.GetInsertBlock();
+  llvm::BasicBlock *fill_block =
+      llvm::BasicBlock::Create(context_, "eof_fill", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "eof_end", current_func_);
+  builder.CreateCondBr(
+      builder.CreateICmpUGE(available, builder.getInt64(size)), exit_block,
+      fill_block,
+      llvm::MDBuilder(context_).createBranchWeights(kFastPathWeight,
+                                                    kSlowPathWeight));
+
+  builder.SetInsertPoint(fill_block);
+  llvm::Value *is_filled = builder.CreateCall(
+      get_runtime_function("pas_file_fill", builder.getInt8Ty(),
+                           {file->getType(), builder.getInt64Ty()}),
+      {file, builder.getInt64(size)});
+  llvm::Value *is_end = builder.CreateICmpEQ(is_filled, builder.getInt8(0));
+  builder.CreateBr(exit_block);
+
+  builder.SetInsertPoint(exit_block);
+  llvm::PHINode *eof = builder.CreatePHI(builder.getInt1Ty(), 2, "eof");
+  eof->addIncoming(builder.getFalse(), check_block);
+  eof->addIncoming(is_end, fill_block);
+  return eof;
+}
+
+// Files can't be parts of arrays and records, so a file is always a plain
+//   variable. It is told apart without evaluating the parameter.
+Lowerer::TypedValue
+Lowerer::eval_file_param(std::vector<pas::ast::Expr> &params) {
+  if (params.empty()) {
+    return TypedValue(nullptr, nullptr);
+  }
+  pas::ast::Designator *designator = as_plain_designator(params[0]);
+  if (designator == nullptr || !designator->items_.empty()) {
+    return TypedValue(nullptr, nullptr);
+  }
+  Decl *decl = lookup_decl(designator->ident_);
+  if (decl == nullptr || decl->index() != 1 ||
+      std::get<Variable>(*decl).type->kind != TypeKind::File) {
+    return TypedValue(nullptr, nullptr);
+  }
+  Variable &file = std::get<Variable>(*decl);
+  return TypedValue(file.allocation, file.type);
+}
+
+Lowerer::TypedValue Lowerer::codegen_input_file() {
+  return TypedValue(
+      current_func_builder_->CreateCall(get_runtime_function(
+          "pas_file_input", get_llvm_file_type()->getPointerTo(), {})),
+      text_type_);
+}
+
+void Lowerer::visit_read(pas::ast::ProcCall &proc_call, bool is_readln) {
+  const std::string &proc_name = proc_call.proc_ident_;
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  TypedValue file = eval_file_param(proc_call.params_);
+  size_t first_item = 1;
+  if (file.value == nullptr) {
+    file = codegen_input_file();
+    first_item = 0;
+  }
+  const TypeSP &item_type = file.type->item_type;
+  if (is_readln && item_type != nullptr) {
+    throw pas::SemanticProblemException("readln requires a text file");
+  }
+  llvm::Type *file_pointer_type = get_llvm_file_type()->getPointerTo();
+
+  for (size_t i = first_item; i < proc_call.params_.size(); ++i) {
+    pas::ast::Designator *designator =
+        as_plain_designator(proc_call.params_[i]);
+    if (designator == nullptr) {
+      throw pas::SemanticProblemException(
+          "parameter " + std::to_string(i + 1) + " of " + proc_name +
+          " must be a variable");
+    }
+    Variable target = resolve_designator(*designator);
+
+    // read(f, x) is x := f^; get(f).
+    if (item_type != nullptr) {
+      if (target.type != item_type) {
+        throw pas::SemanticProblemException(
+            "incompatible types, parameter " + std::to_string(i + 1) + " of " +
+            proc_name + " must be of the type of the file items");
+      }
+      llvm::Value *value = codegen_file_value(file.value, file.type);
+      builder.CreateMemCpy(target.allocation, llvm::MaybeAlign(), value,
+                           llvm::MaybeAlign(), get_type_size(item_type));
+      codegen_file_advance(file.value, value, file.type);
+      continue;
+    }
+
+    switch (target.type->kind) {
+    case TypeKind::Integer: {
+      builder.CreateStore(
+          builder.CreateCall(get_runtime_function("pas_file_read_int",
+                                                  builder.getInt32Ty(),
+                                                  {file_pointer_type}),
+                             {file.value}),
+          target.allocation);
+      break;
+    }
+    case TypeKind::Real: {
+      builder.CreateStore(
+          builder.CreateCall(get_runtime_function("pas_file_read_real",
+                                                  builder.getDoubleTy(),
+                                                  {file_pointer_type}),
+                             {file.value}),
+          target.allocation);
+      break;
+    }
+    case TypeKind::Char: {
+      builder.CreateStore(
+          builder.CreateCall(get_runtime_function("pas_file_read_char",
+                                                  builder.getInt8Ty(),
+                                                  {file_pointer_type}),
+                             {file.value}),
+          target.allocation);
+      break;
+    }
+    case TypeKind::String: {
+      builder.CreateCall(
+          get_runtime_function(
+              "pas_file_read_str", builder.getVoidTy(),
+              {file_pointer_type, get_llvm_string_type()->getPointerTo()}),
+          {file.value, target.allocation});
+      break;
+    }
+    default:
+      throw pas::SemanticProblemException(
+          "parameters of " + proc_name +
+          " must be of type Integer, Real, Char or String");
+    }
+  }
+  if (is_readln) {
+    builder.CreateCall(get_runtime_function("pas_file_read_line",
+                                            builder.getVoidTy(),
+                                            {file_pointer_type}),
+                       {file.value});
+  }
+}
+
+void Lowerer::visit_write(pas::ast::ProcCall &proc_call, bool is_writeln) {
+  const std::string &proc_name = proc_call.proc_ident_;
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  TypedValue file = eval_file_param(proc_call.params_);
+  if (file.value == nullptr) {
+    throw pas::SemanticProblemException(
+        "parameter 1 of " + proc_name +
+        " must be a file, write_int and write_str print to the output");
+  }
+  const TypeSP &item_type = file.type->item_type;
+  if (is_writeln && item_type != nullptr) {
+    throw pas::SemanticProblemException("writeln requires a text file");
+  }
+  llvm::Type *file_pointer_type = get_llvm_file_type()->getPointerTo();
+
+  for (size_t i = 1; i < proc_call.params_.size(); ++i) {
+    pas::ast::Expr &param = proc_call.params_[i];
+
+    // Values are written from memory, variables right from their place.
+    if (item_type != nullptr) {
+      llvm::Value *address = nullptr;
+      TypeSP type;
+      if (pas::ast::Designator *designator = as_plain_designator(param)) {
+        Variable source = resolve_designator(*designator);
+        address = source.allocation;
+        type = source.type;
+      } else {
+        TypedValue value = eval(param);
+        llvm::BasicBlock &entry = current_func_->getEntryBlock();
+        llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+        address = entry_builder.CreateAlloca(
+            get_llvm_type_by_lang_type(value.type), nullptr, "file.item");
+        builder.CreateStore(value.value, address);
+        type = value.type;
+      }
+      if (type != item_type) {
+        throw pas::SemanticProblemException(
+            "incompatible types, parameter " + std::to_string(i + 1) + " of " +
+            proc_name + " must be of the type of the file items");
+      }
+      builder.CreateCall(
+          get_runtime_function("pas_file_write", builder.getVoidTy(),
+                               {file_pointer_type,
+                                builder.getInt8Ty()->getPointerTo(),
+                                builder.getInt64Ty()}),
+          {file.value,
+           builder.CreatePointerCast(address,
+                                     builder.getInt8Ty()->getPointerTo()),
+           builder.getInt64(get_type_size(item_type))});
+      continue;
+    }
+
+    TypedValue value = eval(param);
+    std::string function_name;
+    switch (value.type->kind) {
+    case TypeKind::Integer:
+      function_name = "pas_file_write_int";
+      break;
+    case TypeKind::Real:
+      function_name = "pas_file_write_real";
+      break;
+    case TypeKind::Char:
+      function_name = "pas_file_write_char";
+      break;
+    case TypeKind::String:
+      function_name = "pas_file_write_str";
+      break;
+    default:
+      throw pas::SemanticProblemException(
+          "parameters of " + proc_name +
+          " must be of type Integer, Real, Char or String");
+    }
+    builder.CreateCall(
+        get_runtime_function(function_name, builder.getVoidTy(),
+                             {file_pointer_type, value.value->getType()}),
+        {file.value, value.value});
+  }
+  if (is_writeln) {
+    builder.CreateCall(get_runtime_function("pas_file_write_line",
+                                            builder.getVoidTy(),
+                                            {file_pointer_type}),
+                       {file.value});
+  }
+  release_string_temporaries();
+}
+
+void Lowerer::visit_file_procedure(pas::ast::ProcCall &proc_call) {
+  const std::string &proc_name = proc_call.proc_ident_;
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  size_t num_params = proc_name == "assign" ? 2 : 1;
+  if (proc_call.params_.size() != num_params) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + proc_name +
+        ": expected " + std::to_string(num_params) + ", got " +
+        std::to_string(proc_call.params_.size()));
+  }
+  TypedValue file = eval_file_param(proc_call.params_);
+  if (file.value == nullptr) {
+    throw pas::SemanticProblemException("parameter 1 of " + proc_name +
+                                        " must be a file");
+  }
+  llvm::Type *file_pointer_type = get_llvm_file_type()->getPointerTo();
+
+  if (proc_name == "assign") {
+    TypedValue name = eval(proc_call.params_[1]);
+    if (name.type->kind != TypeKind::String) {
+      throw pas::SemanticProblemException(
+          "parameter 2 of assign must be of type String");
+    }
+    builder.CreateCall(
+        get_runtime_function(
+            "pas_file_assign", builder.getVoidTy(),
+            {file_pointer_type, get_llvm_string_type()->getPointerTo()}),
+        {file.value, name.value});
+    release_string_temporaries();
+  } else if (proc_name == "get") {
+    if (file.type->item_type == nullptr) {
+      throw pas::SemanticProblemException("get requires a typed file");
+    }
+    codegen_file_advance(file.value, codegen_file_value(file.value, file.type),
+                         file.type);
+  } else {
+    builder.CreateCall(get_runtime_function("pas_file_" + proc_name,
+                                            builder.getVoidTy(),
+                                            {file_pointer_type}),
+                       {file.value});
+  }
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,186 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+#include "stdlib/alloc.hpp"
+
+namespace pas {
+namespace visitor {
+
+static llvm::Type *get_llvm_alloc_cache_type(llvm::LLVMContext &context) {
+  return llvm::ArrayType::get(llvm::Type::getInt8Ty(context)->getPointerTo(),
+                              kAllocNumSizeClasses);
+}
+
+// The cache is thread-local, it is looked up once in the entry block, and
+//   the free lists are accessed through a plain pointer.
+llvm::Value *Lowerer::get_alloc_cache() {
+  if (alloc_cache_ == nullptr) {
+    llvm::BasicBlock &entry = current_func_->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+    llvm::Type *cache_pointer_type =
+        get_llvm_alloc_cache_type(context_)->getPointerTo();
+    alloc_cache_ = entry_builder.CreateCall(
+        get_runtime_function("pas_alloc_thread_cache", cache_pointer_type, {}),
+        {}, "alloc_cache");
+  }
+  return alloc_cache_;
+}
+
+llvm::Value *Lowerer::codegen_new(const TypeSP &type) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  uint64_t size = get_type_size(type);
+
+  if (size > kAllocMaxSmallSize) {
+    return builder.CreateCall(
+        get_runtime_function("pas_alloc_large", pointer_type,
+                             {builder.getInt64Ty()}),
+        {builder.getInt64(size)});
+  }
+
+  // Pop the head of the free list, refill it, if it's empty.
+  uint64_t size_class = get_alloc_size_class(size);
+  llvm::Value *cache = get_alloc_cache();
+  llvm::Value *head_address = builder.CreateInBoundsGEP(
+      get_llvm_alloc_cache_type(context_), cache,
+      {builder.getInt64(0), builder.getInt64(size_class)});
+  llvm::Value *head = builder.CreateLoad(pointer_type, head_address);
+
+  llvm::BasicBlock *pop_block =
+      llvm::BasicBlock::Create(context_, "new_pop", current_func_);
+  llvm::BasicBlock *refill_block =
+      llvm::BasicBlock::Create(context_, "new_refill", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "new_end", current_func_);
+  builder.CreateCondBr(
+      builder.CreateIsNotNull(head), pop_block, refill_block,
+      llvm::MDBuilder(context_).createBranchWeights(kFastPathWeight,
+                                                    kSlowPathWeight));
+
+  builder.SetInsertPoint(pop_block);
+  llvm::Value *next = builder.CreateLoad(
+      pointer_type,
+      builder.CreatePointerCast(head, pointer_type->getPointerTo()));
+  builder.CreateStore(next, head_address);
+  builder.CreateBr(exit_block);
+
+  builder.SetInsertPoint(refill_block);
+  llvm::Value *refilled = builder.CreateCall(
+      get_runtime_function("pas_alloc_refill", pointer_type,
+                           {cache->getType(), builder.getInt64Ty()}),
+      {cache, builder.getInt64(size_class)});
+  builder.CreateBr(exit_block);
+
+  builder.SetInsertPoint(exit_block);
+  llvm::PHINode *object = builder.CreatePHI(pointer_type, 2);
+  object->addIncoming(head, pop_block);
+  object->addIncoming(refilled, refill_block);
+  return object;
+}
+
+void Lowerer::codegen_dispose(llvm::Value *object, const TypeSP &type,
+                              bool on_stack) {
+  // Stack objects are freed on return, only strings inside are released.
+  if (on_stack && !contains_string(type)) {
+    return;
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  uint64_t size = get_type_size(type);
+
+  // Dispose(nil) does nothing.
+  llvm::BasicBlock *free_block =
+      llvm::BasicBlock::Create(context_, "dispose", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "dispose_end", current_func_);
+  builder.CreateCondBr(builder.CreateIsNotNull(object), free_block,
+                       exit_block);
+  builder.SetInsertPoint(free_block);
+
+  if (contains_string(type)) {
+    codegen_for_each_string(
+        builder.CreatePointerCast(
+            object, get_llvm_type_by_lang_type(type)->getPointerTo()),
+        type, "pas_string_release");
+  }
+
+  if (on_stack) {
+    // Nothing to free.
+  } else if (size > kAllocMaxSmallSize) {
+    builder.CreateCall(
+        get_runtime_function("pas_free_large", builder.getVoidTy(),
+                             {pointer_type}),
+        {object});
+  } else {
+    // Push the object to the head of the free list.
+    llvm::Value *head_address = builder.CreateInBoundsGEP(
+        get_llvm_alloc_cache_type(context_), get_alloc_cache(),
+        {builder.getInt64(0), builder.getInt64(get_alloc_size_class(size))});
+    llvm::Value *head = builder.CreateLoad(pointer_type, head_address);
+    builder.CreateStore(
+        head, builder.CreatePointerCast(object, pointer_type->getPointerTo()));
+    builder.CreateStore(object, head_address);
+  }
+  builder.CreateBr(exit_block);
+  builder.SetInsertPoint(exit_block);
+}
+
+void Lowerer::visit(pas::ast::MemoryStmt &memory_stmt) {
+  Decl *decl = lookup_decl(memory_stmt.ident_);
+  if (decl == nullptr || decl->index() != 1) {
+    throw SemanticProblemException("variable not found: " +
+                                   memory_stmt.ident_);
+  }
+  Variable &variable = std::get<Variable>(*decl);
+  if (variable.type->kind != TypeKind::Pointer) {
+    throw SemanticProblemException(
+        "New and Dispose require a variable of a pointer type: " +
+        memory_stmt.ident_);
+  }
+  const TypeSP &type = variable.type->item_type;
+  if (type->kind == TypeKind::File) {
+    throw NotImplementedException("dynamic files are not supported");
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = get_llvm_type_by_lang_type(variable.type);
+  auto stack_object_it = stack_objects_.find(memory_stmt.ident_);
+
+  switch (memory_stmt.kind_) {
+  case pas::ast::MemoryStmt::Kind::New: {
+    // The object doesn't outlive the procedure, its slot is reused by all
+    //   of the New's: the previous object is unreachable by then.
+    llvm::Value *object = stack_object_it != stack_objects_.end()
+                              ? stack_object_it->second
+                              : codegen_new(type);
+    codegen_init_strings(Variable(
+        builder.CreatePointerCast(
+            object, get_llvm_type_by_lang_type(type)->getPointerTo()),
+        type));
+    builder.CreateStore(builder.CreatePointerCast(object, pointer_type),
+                        variable.allocation);
+    break;
+  }
+  case pas::ast::MemoryStmt::Kind::Dispose: {
+    codegen_dispose(builder.CreateLoad(pointer_type, variable.allocation),
+                    type, stack_object_it != stack_objects_.end());
+    // The pointer is dangling now, nil makes its use visible.
+    builder.CreateStore(llvm::ConstantPointerNull::get(
+                            llvm::cast<llvm::PointerType>(pointer_type)),
+                        variable.allocation);
+    break;
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
+
+} // namespace visitor
+} // namespace pas
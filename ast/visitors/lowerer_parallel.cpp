@@ -0,0 +1,234 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <utility>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+// The body function is
+//   void f.parallel(i8 **context, i64 begin, i64 end)
+//   context holds the addresses of the captured variables and of the
+//   first value of the control variable, the iteration k has the control
+//   value start + k (start - k for downto). Globals are not captured, the
+//   body references them directly.
+void Lowerer::visit_parallel_for(pas::ast::ForStmt &for_stmt,
+                                 Variable control, llvm::Value *start,
+                                 llvm::Value *finish) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *i64_type = builder.getInt64Ty();
+  llvm::Type *char_pointer_type = builder.getInt8Ty()->getPointerTo();
+  bool is_signed = control.type->kind == TypeKind::Integer;
+  bool is_down = for_stmt.dir_ == pas::ast::WhichWay::DownTo;
+
+  for (const std::string &ident : for_stmt.reductions_) {
+    Decl *decl = lookup_decl(ident);
+    if (decl == nullptr || decl->index() != 1) {
+      throw SemanticProblemException("reduction variable not found: " +
+                                     ident);
+    }
+    if (!is_number(std::get<Variable>(*decl).type->kind)) {
+      throw SemanticProblemException(
+          "reduction variable must be of type Integer or Real: " + ident);
+    }
+    if (ident == for_stmt.ident_) {
+      throw SemanticProblemException(
+          "for loop control variable can't be a reduction variable: " +
+          ident);
+    }
+  }
+
+  // Variables of the procedure, the inner scopes hide the outer ones.
+  std::vector<std::pair<PascalIdent, Variable>> captures;
+  std::unordered_map<PascalIdent, size_t> capture_indices;
+  for (size_t i = 2; i < pascal_scopes_.size(); ++i) {
+    for (auto &[ident, decl] : pascal_scopes_[i]) {
+      if (decl.index() != 1) {
+        continue;
+      }
+      auto [it, inserted] = capture_indices.emplace(ident, captures.size());
+      if (inserted) {
+        captures.emplace_back(ident, std::get<Variable>(decl));
+      } else {
+        captures[it->second].second = std::get<Variable>(decl);
+      }
+    }
+  }
+
+  llvm::Value *start_value =
+      is_signed ? builder.CreateSExt(start, i64_type)
+                : builder.CreateZExt(start, i64_type);
+  llvm::Value *finish_value =
+      is_signed ? builder.CreateSExt(finish, i64_type)
+                : builder.CreateZExt(finish, i64_type);
+  // Not positive, if the loop is not entered, the runtime checks that.
+  llvm::Value *count = builder.CreateAdd(
+      is_down ? builder.CreateSub(start_value, finish_value)
+              : builder.CreateSub(finish_value, start_value),
+      builder.getInt64(1));
+
+  llvm::ArrayType *context_type =
+      llvm::ArrayType::get(char_pointer_type, captures.size() + 1);
+  llvm::BasicBlock &entry = current_func_->getEntryBlock();
+  llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+  llvm::AllocaInst *context =
+      entry_builder.CreateAlloca(context_type, nullptr, "parallel.context");
+  llvm::AllocaInst *start_allocation =
+      entry_builder.CreateAlloca(i64_type, nullptr, "parallel.start");
+  builder.CreateStore(start_value, start_allocation);
+  for (size_t i = 0; i < captures.size(); ++i) {
+    builder.CreateStore(
+        builder.CreatePointerCast(captures[i].second.allocation,
+                                  char_pointer_type),
+        builder.CreateConstInBoundsGEP2_64(context_type, context, 0, i));
+  }
+  builder.CreateStore(
+      builder.CreatePointerCast(start_allocation, char_pointer_type),
+      builder.CreateConstInBoundsGEP2_64(context_type, context, 0,
+                                         captures.size()));
+
+  llvm::Function *function = llvm::Function::Create(
+      llvm::FunctionType::get(
+          builder.getVoidTy(),
+          {char_pointer_type->getPointerTo(), i64_type, i64_type}, false),
+      llvm::Function::InternalLinkage, current_func_->getName() + ".parallel",
+      module_uptr_.get());
+  function->addFnAttr(llvm::Attribute::NoUnwind);
+  llvm::Argument *context_arg = function->getArg(0);
+  llvm::Argument *begin_arg = function->getArg(1);
+  llvm::Argument *end_arg = function->getArg(2);
+  context_arg->setName("context");
+  begin_arg->setName("begin");
+  end_arg->setName("end");
+
+  // The body is lowered as a function of its own, the state of the
+  //   current one is kept aside until it is done.
+  llvm::Function *parent_func = current_func_;
+  llvm::IRBuilder<> *parent_builder = current_func_builder_;
+  llvm::Value *parent_alloc_cache = alloc_cache_;
+  std::unordered_map<PascalIdent, llvm::AllocaInst *> parent_stack_objects;
+  parent_stack_objects.swap(stack_objects_);
+  std::vector<llvm::Value *> parent_string_temporaries;
+  parent_string_temporaries.swap(string_temporaries_);
+  const std::vector<pas::profile::Site> *parent_profile_sites =
+      profile_sites_;
+  size_t parent_profile_site_index = profile_site_index_;
+  bool parent_is_parallel_body = is_parallel_body_;
+
+  llvm::IRBuilder<> func_builder(context_);
+  func_builder.SetInsertPoint(
+      llvm::BasicBlock::Create(context_, "entrypoint", function));
+  current_func_ = function;
+  current_func_builder_ = &func_builder;
+  alloc_cache_ = nullptr;
+  is_parallel_body_ = true;
+  set_fast_math(function, func_builder);
+  create_debug_subprogram(function, function->getName().str(), for_stmt.loc_);
+  begin_profile_function(for_stmt.loc_);
+
+  auto load_context_item = [&](size_t index, llvm::Type *type) {
+    return func_builder.CreatePointerCast(
+        func_builder.CreateLoad(
+            char_pointer_type,
+            func_builder.CreateConstInBoundsGEP1_64(char_pointer_type,
+                                                    context_arg, index)),
+        type->getPointerTo());
+  };
+  pascal_scopes_.emplace_back();
+  for (size_t i = 0; i < captures.size(); ++i) {
+    const auto &[ident, variable] = captures[i];
+    pascal_scopes_.back()[ident] = Variable(
+        load_context_item(i, get_llvm_type_by_lang_type(variable.type)),
+        variable.type);
+  }
+  start_value = func_builder.CreateLoad(
+      i64_type, load_context_item(captures.size(), i64_type), "start");
+  Variable private_control(codegen_alloc_value_of_type(control.type),
+                           control.type);
+  pascal_scopes_.back()[for_stmt.ident_] = private_control;
+  // Shared variables are looked up before they are hidden by the private
+  //   accumulators.
+  std::vector<std::pair<Variable, Variable>> reductions;
+  for (const std::string &ident : for_stmt.reductions_) {
+    Variable shared = std::get<Variable>(*lookup_decl(ident));
+    Variable accumulator(codegen_alloc_value_of_type(shared.type),
+                         shared.type);
+    func_builder.CreateStore(
+        llvm::Constant::getNullValue(get_llvm_type_by_lang_type(shared.type)),
+        accumulator.allocation);
+    reductions.emplace_back(shared, accumulator);
+    pascal_scopes_.back()[ident] = accumulator;
+  }
+
+  llvm::BasicBlock *preheader_block = func_builder.GetInsertBlock();
+  llvm::BasicBlock *body_block =
+      llvm::BasicBlock::Create(context_, "for_body", function);
+  llvm::BasicBlock *latch_block =
+      llvm::BasicBlock::Create(context_, "for_latch", function);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "for_end", function);
+  func_builder.CreateCondBr(func_builder.CreateICmpSLT(begin_arg, end_arg),
+                            body_block, exit_block);
+
+  func_builder.SetInsertPoint(body_block);
+  llvm::PHINode *iteration = func_builder.CreatePHI(i64_type, 2, "k");
+  iteration->addIncoming(begin_arg, preheader_block);
+  llvm::Value *control_value =
+      is_down ? func_builder.CreateSub(start_value, iteration)
+              : func_builder.CreateAdd(start_value, iteration);
+  func_builder.CreateStore(
+      func_builder.CreateTrunc(control_value, start->getType()),
+      private_control.allocation);
+  lower_stmt(for_stmt.inner_stmt_);
+  codegen_budget_tick();
+  func_builder.CreateBr(latch_block);
+
+  func_builder.SetInsertPoint(latch_block);
+  llvm::Value *next = func_builder.CreateAdd(
+      iteration, func_builder.getInt64(1), "", true, true);
+  iteration->addIncoming(next, latch_block);
+  llvm::BranchInst *latch_branch = func_builder.CreateCondBr(
+      func_builder.CreateICmpEQ(next, end_arg), exit_block, body_block);
+  add_loop_metadata(latch_branch, true);
+
+  func_builder.SetInsertPoint(exit_block);
+  // Chunks are independent, the atomic additions don't order anything.
+  for (auto &[shared, accumulator] : reductions) {
+    llvm::Value *sum = func_builder.CreateLoad(
+        get_llvm_type_by_lang_type(shared.type), accumulator.allocation);
+    func_builder.CreateAtomicRMW(
+        shared.type->kind == TypeKind::Real ? llvm::AtomicRMWInst::FAdd
+                                            : llvm::AtomicRMWInst::Add,
+        shared.allocation, sum,
+        llvm::MaybeAlign(get_type_alignment(shared.type)),
+        llvm::AtomicOrdering::Monotonic);
+  }
+  func_builder.CreateRetVoid();
+  finalize_debug_subprogram();
+  close_scope();
+
+  current_func_ = parent_func;
+  current_func_builder_ = parent_builder;
+  alloc_cache_ = parent_alloc_cache;
+  stack_objects_.swap(parent_stack_objects);
+  string_temporaries_.swap(parent_string_temporaries);
+  profile_sites_ = parent_profile_sites;
+  profile_site_index_ = parent_profile_site_index;
+  is_parallel_body_ = parent_is_parallel_body;
+
+  builder.CreateCall(
+      get_runtime_function("pas_parallel_for", builder.getVoidTy(),
+                           {function->getType(), char_pointer_type, i64_type}),
+      {function, builder.CreatePointerCast(context, char_pointer_type),
+       count});
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,201 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/ProfileSummary.h"
+
+#include "ast/ast.hpp"
+
+namespace pas {
+namespace visitor {
+
+// Cutoffs of the detailed summary in millionths of the total count, the
+//   same as LLVM's, so that hot and cold thresholds are computed the usual
+//   way.
+static constexpr uint32_t kProfileSummaryCutoffs[] = {
+    10000,  100000, 200000, 300000, 400000, 500000, 600000, 700000,
+    800000, 900000, 950000, 990000, 999000, 999900, 999990, 999999};
+
+void Lowerer::begin_profile_function(const pas::ast::SourceLoc &loc) {
+  profile_sites_ = nullptr;
+  profile_site_index_ = 0;
+  if (options_.profile != nullptr) {
+    auto it = options_.profile->find(current_func_->getName().str());
+    if (it != options_.profile->end()) {
+      profile_sites_ = &it->second;
+    }
+  }
+
+  ProfileSite site = add_profile_site("entry", loc, 1);
+  codegen_profile_increment(site, 0);
+  if (!site.counts.empty()) {
+    current_func_->setEntryCount(site.counts[0]);
+  }
+}
+
+Lowerer::ProfileSite Lowerer::add_profile_site(const std::string &kind,
+                                               const pas::ast::SourceLoc &loc,
+                                               size_t num_counters) {
+  ProfileSite site = {num_profile_counters_, {}};
+  if (options_.profile_generate_path.has_value()) {
+    profile_layout_ += current_func_->getName().str() + " " + kind + " " +
+                       std::to_string(loc.line) + " " +
+                       std::to_string(num_counters) + "\n";
+    num_profile_counters_ += num_counters;
+  }
+
+  // The rest of the function is not trusted after the first mismatch, the
+  //   sites are matched by their positions.
+  if (profile_sites_ != nullptr) {
+    if (profile_site_index_ < profile_sites_->size()) {
+      const pas::profile::Site &profile_site =
+          (*profile_sites_)[profile_site_index_++];
+      if (profile_site.kind == kind && profile_site.line == loc.line &&
+          profile_site.counts.size() == num_counters) {
+        site.counts = profile_site.counts;
+        return site;
+      }
+    }
+    profile_sites_ = nullptr;
+  }
+  return site;
+}
+
+void Lowerer::codegen_profile_increment(const ProfileSite &site,
+                                        size_t counter, llvm::Value *step) {
+  if (!options_.profile_generate_path.has_value()) {
+    return;
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  if (profile_counters_ == nullptr) {
+    profile_counters_ = new llvm::GlobalVariable(
+        *module_uptr_, builder.getInt64Ty(), false,
+        llvm::GlobalValue::InternalLinkage, nullptr, "profile.placeholder");
+  }
+  // Plain increments, except for the bodies of parallel loops. Counts
+  //   don't order anything, so relaxed (monotonic) atomics are enough.
+  llvm::Value *address = builder.CreateConstInBoundsGEP1_64(
+      builder.getInt64Ty(), profile_counters_, site.first_counter + counter);
+  if (is_parallel_body_) {
+    builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, address,
+                            step != nullptr ? step : builder.getInt64(1),
+                            llvm::MaybeAlign(8),
+                            llvm::AtomicOrdering::Monotonic);
+    return;
+  }
+  llvm::Value *count = builder.CreateLoad(builder.getInt64Ty(), address);
+  builder.CreateStore(
+      builder.CreateAdd(count, step != nullptr ? step : builder.getInt64(1)),
+      address);
+}
+
+llvm::MDNode *Lowerer::make_branch_weights(llvm::ArrayRef<uint64_t> counts) {
+  if (counts.empty()) {
+    return nullptr;
+  }
+  // Weights are 32-bit, the counts are scaled down. Zero weight means
+  //   "never" to some passes, it is avoided.
+  uint64_t max_count = *std::max_element(counts.begin(), counts.end());
+  uint64_t scale = max_count / UINT32_MAX + 1;
+  std::vector<uint32_t> weights;
+  for (uint64_t count : counts) {
+    weights.push_back(static_cast<uint32_t>(count / scale + 1));
+  }
+  return llvm::MDBuilder(context_).createBranchWeights(weights);
+}
+
+void Lowerer::set_branch_weights(llvm::Instruction *branch,
+                                 llvm::ArrayRef<uint64_t> counts) {
+  if (llvm::MDNode *weights = make_branch_weights(counts)) {
+    branch->setMetadata(llvm::LLVMContext::MD_prof, weights);
+  }
+}
+
+void Lowerer::codegen_profile_write() {
+  if (profile_counters_ == nullptr) {
+    return;
+  }
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::ArrayType *counters_type =
+      llvm::ArrayType::get(builder.getInt64Ty(), num_profile_counters_);
+  auto *counters = new llvm::GlobalVariable(
+      *module_uptr_, counters_type, false, llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantAggregateZero::get(counters_type), "profile.counters");
+  profile_counters_->replaceAllUsesWith(llvm::ConstantExpr::getPointerCast(
+      counters, profile_counters_->getType()));
+  profile_counters_->eraseFromParent();
+  profile_counters_ = nullptr;
+
+  llvm::Type *char_pointer_type = builder.getInt8Ty()->getPointerTo();
+  llvm::Type *counter_pointer_type = builder.getInt64Ty()->getPointerTo();
+  builder.CreateCall(
+      get_runtime_function("pas_profile_write", builder.getVoidTy(),
+                           {char_pointer_type, char_pointer_type,
+                            counter_pointer_type, builder.getInt64Ty()}),
+      {builder.CreateGlobalStringPtr(*options_.profile_generate_path,
+                                     "profile.path"),
+       builder.CreateGlobalStringPtr(profile_layout_, "profile.layout"),
+       builder.CreatePointerCast(counters, counter_pointer_type),
+       builder.getInt64(num_profile_counters_)});
+}
+
+// Hot and cold code is told apart by the summary of all counts, LLVM
+//   ignores entry counts without it.
+void Lowerer::add_profile_summary() {
+  if (options_.profile == nullptr) {
+    return;
+  }
+  std::vector<uint64_t> counts;
+  uint64_t max_function_count = 0;
+  uint64_t max_internal_count = 0;
+  for (const auto &[function, sites] : *options_.profile) {
+    for (const pas::profile::Site &site : sites) {
+      if (site.kind == "entry") {
+        max_function_count = std::max(max_function_count, site.counts[0]);
+      } else {
+        max_internal_count = std::max(
+            max_internal_count,
+            *std::max_element(site.counts.begin(), site.counts.end()));
+      }
+      counts.insert(counts.end(), site.counts.begin(), site.counts.end());
+    }
+  }
+  std::sort(counts.begin(), counts.end(), std::greater<uint64_t>());
+  uint64_t total_count = 0;
+  for (uint64_t count : counts) {
+    total_count += count;
+  }
+
+  // For each cutoff, the smallest count among the largest counts, that
+  //   together make up the cutoff of the total.
+  llvm::SummaryEntryVector detailed_summary;
+  size_t num_counts = 0;
+  uint64_t accumulated = 0;
+  for (uint32_t cutoff : kProfileSummaryCutoffs) {
+    auto desired = static_cast<uint64_t>(static_cast<double>(total_count) *
+                                         cutoff / 1000000);
+    while (num_counts < counts.size() &&
+           (accumulated < desired || num_counts == 0)) {
+      accumulated += counts[num_counts++];
+    }
+    detailed_summary.emplace_back(cutoff,
+                                  num_counts == 0 ? 0 : counts[num_counts - 1],
+                                  num_counts);
+  }
+
+  llvm::ProfileSummary summary(
+      llvm::ProfileSummary::PSK_Instr, detailed_summary, total_count,
+      std::max(max_function_count, max_internal_count), max_internal_count,
+      max_function_count, counts.size(), options_.profile->size());
+  module_uptr_->setProfileSummary(summary.getMD(context_),
+                                  llvm::ProfileSummary::PSK_Instr);
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,89 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+bool Lowerer::is_number(TypeKind kind) {
+  return kind == TypeKind::Integer || kind == TypeKind::Real;
+}
+
+llvm::Value *Lowerer::codegen_int_to_real(llvm::Value *value) {
+  return current_func_builder_->CreateSIToFP(
+      value, current_func_builder_->getDoubleTy());
+}
+
+bool Lowerer::unify_reals(TypedValue &lhs, TypedValue &rhs) {
+  TypeKind lhs_kind = lhs.type->kind;
+  TypeKind rhs_kind = rhs.type->kind;
+  if ((lhs_kind != TypeKind::Real && rhs_kind != TypeKind::Real) ||
+      !is_number(lhs_kind) || !is_number(rhs_kind)) {
+    return false;
+  }
+  if (lhs_kind == TypeKind::Integer) {
+    lhs = TypedValue(codegen_int_to_real(lhs.value), real_type_);
+  }
+  if (rhs_kind == TypeKind::Integer) {
+    rhs = TypedValue(codegen_int_to_real(rhs.value), real_type_);
+  }
+  return true;
+}
+
+// Comparisons with NaN are false, except for <>.
+Lowerer::TypedValue Lowerer::codegen_real_compare(pas::ast::RelOp rel,
+                                                  TypedValue lhs,
+                                                  TypedValue rhs) {
+  llvm::CmpInst::Predicate predicate;
+  switch (rel) {
+  case pas::ast::RelOp::Equal:
+    predicate = llvm::CmpInst::FCMP_OEQ;
+    break;
+  case pas::ast::RelOp::NotEqual:
+    predicate = llvm::CmpInst::FCMP_UNE;
+    break;
+  case pas::ast::RelOp::Less:
+    predicate = llvm::CmpInst::FCMP_OLT;
+    break;
+  case pas::ast::RelOp::LessEqual:
+    predicate = llvm::CmpInst::FCMP_OLE;
+    break;
+  case pas::ast::RelOp::Greater:
+    predicate = llvm::CmpInst::FCMP_OGT;
+    break;
+  case pas::ast::RelOp::GreaterEqual:
+    predicate = llvm::CmpInst::FCMP_OGE;
+    break;
+  default:
+    throw SemanticProblemException("invalid operand types for comparison");
+  }
+  return TypedValue(
+      current_func_builder_->CreateFCmp(predicate, lhs.value, rhs.value),
+      boolean_type_);
+}
+
+// The flags of the builder go to every floating point instruction, that it
+//   creates. The attributes tell the same to the code generator, as clang
+//   does for -ffast-math.
+void Lowerer::set_fast_math(llvm::Function *function,
+                            llvm::IRBuilder<> &builder) {
+  if (!options_.fast_math) {
+    return;
+  }
+  llvm::FastMathFlags flags;
+  flags.setFast();
+  builder.setFastMathFlags(flags);
+  function->addFnAttr("unsafe-fp-math", "true");
+  function->addFnAttr("no-nans-fp-math", "true");
+  function->addFnAttr("no-infs-fp-math", "true");
+  function->addFnAttr("no-signed-zeros-fp-math", "true");
+  function->addFnAttr("approx-func-fp-math", "true");
+}
+
+} // namespace visitor
+} // namespace pas
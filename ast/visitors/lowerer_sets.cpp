@@ -0,0 +1,303 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+#include "ast/utils/get_idx.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+// Сет хранится как битсет: бит i означает, что элемент low + i лежит в
+//   множестве. Биты за пределами подотрезка (выравнивание до ширины
+//   регистра) всегда нулевые, поэтому сравнение множеств это просто
+//   сравнение регистров.
+// Большие множества это векторы 64-битных слов. При преобразованиях между
+//   типами множеств вектор рассматривается как одно большое целое число,
+//   тут мы полагаемся на little-endian (X86 и AArch64 такие).
+
+static int64_t get_num_elements(int64_t low, int64_t high) {
+  return high - low + 1;
+}
+
+static unsigned get_num_bits(llvm::Type *set_type) {
+  if (auto *vector_type = llvm::dyn_cast<llvm::FixedVectorType>(set_type)) {
+    return vector_type->getNumElements() * 64;
+  }
+  return set_type->getIntegerBitWidth();
+}
+
+// Reinterprets a set value as one (possibly wide) integer.
+static llvm::Value *as_integer(llvm::IRBuilder<> &builder, llvm::Value *set) {
+  if (set->getType()->isVectorTy()) {
+    return builder.CreateBitCast(
+        set, builder.getIntNTy(get_num_bits(set->getType())));
+  }
+  return set;
+}
+
+static llvm::Value *from_integer(llvm::IRBuilder<> &builder,
+                                 llvm::Value *value, llvm::Type *set_type) {
+  if (set_type->isVectorTy()) {
+    return builder.CreateBitCast(value, set_type);
+  }
+  return value;
+}
+
+llvm::Type *Lowerer::get_llvm_set_type(const Bounds &bounds) {
+  int64_t num_elements = get_num_elements(bounds.low, bounds.high);
+  if (num_elements <= 64) {
+    unsigned width =
+        std::max<uint64_t>(8, llvm::PowerOf2Ceil(static_cast<uint64_t>(
+                                  num_elements)));
+    return llvm::Type::getIntNTy(context_, width);
+  }
+  unsigned num_words = (num_elements + 63) / 64;
+  return llvm::FixedVectorType::get(llvm::Type::getInt64Ty(context_),
+                                    num_words);
+}
+
+Lowerer::TypedValue Lowerer::eval(pas::ast::SetValue &set_value) {
+  std::vector<int> elements;
+  for (pas::ast::Element &element : set_value.elements_) {
+    switch (element.index()) {
+    case get_idx(pas::ast::ElementKind::ConstExpr): {
+      elements.push_back(
+          eval_const_expr(std::get<pas::ast::ConstExpr>(element)));
+      break;
+    }
+    case get_idx(pas::ast::ElementKind::ConstExprRange): {
+      auto &range =
+          std::get<std::pair<pas::ast::ConstExpr, pas::ast::ConstExpr>>(
+              element);
+      int first = eval_const_expr(range.first);
+      int last = eval_const_expr(range.second);
+      if (static_cast<int64_t>(last) - first + 1 > kMaxSetElements) {
+        throw SemanticProblemException("set constructor range is too large");
+      }
+      // An empty range (first > last) adds nothing.
+      for (int64_t item = first; item <= last; ++item) {
+        elements.push_back(static_cast<int>(item));
+      }
+      break;
+    }
+    default:
+      assert(false);
+      __builtin_unreachable();
+    }
+  }
+
+  // The set constructor gets a type of its own, just wide enough to hold
+  //   the elements. It is converted, when combined with other sets.
+  Bounds bounds = {0, 0};
+  if (!elements.empty()) {
+    auto [min_it, max_it] =
+        std::minmax_element(elements.begin(), elements.end());
+    bounds = {*min_it, *max_it};
+  }
+  if (get_num_elements(bounds.low, bounds.high) > kMaxSetElements) {
+    throw SemanticProblemException(
+        "set constructor elements span too large a subrange");
+  }
+  TypeSP type = std::make_shared<Type>(Type{TypeKind::Set, bounds});
+
+  llvm::Type *llvm_type = get_llvm_set_type(bounds);
+  std::vector<uint64_t> words((get_num_bits(llvm_type) + 63) / 64, 0);
+  for (int element : elements) {
+    uint64_t bit = static_cast<int64_t>(element) - bounds.low;
+    words[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+
+  llvm::Constant *value = nullptr;
+  if (llvm_type->isVectorTy()) {
+    value = llvm::ConstantDataVector::get(context_, words);
+  } else {
+    value = llvm::ConstantInt::get(
+        llvm_type, llvm::APInt(llvm_type->getIntegerBitWidth(), words[0]));
+  }
+  return TypedValue(value, type);
+}
+
+llvm::Value *Lowerer::codegen_set_convert(llvm::Value *value,
+                                          const TypeSP &from,
+                                          const TypeSP &to) {
+  if (from->bounds.low == to->bounds.low &&
+      from->bounds.high == to->bounds.high) {
+    return value;
+  }
+
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *to_llvm_type = get_llvm_set_type(to->bounds);
+  unsigned from_bits = get_num_bits(value->getType());
+  unsigned to_bits = get_num_bits(to_llvm_type);
+
+  // Element low + i of "from" is bit i + shift of "to".
+  int64_t shift = static_cast<int64_t>(from->bounds.low) - to->bounds.low;
+  unsigned work_bits =
+      std::max<int64_t>(from_bits + std::max<int64_t>(shift, 0), to_bits);
+
+  llvm::Value *bits = as_integer(builder, value);
+  if (-shift >= static_cast<int64_t>(from_bits)) {
+    bits = llvm::ConstantInt::get(bits->getType(), 0);
+  } else if (shift < 0) {
+    bits = builder.CreateLShr(bits, -shift);
+  }
+  bits = builder.CreateZExtOrTrunc(bits, builder.getIntNTy(work_bits));
+  if (shift > 0) {
+    bits = builder.CreateShl(bits, shift);
+  }
+  bits = builder.CreateZExtOrTrunc(bits, builder.getIntNTy(to_bits));
+
+  // Elements, that don't fit into the subrange, are dropped, padding bits
+  //   must stay zero.
+  uint64_t num_elements = get_num_elements(to->bounds.low, to->bounds.high);
+  if (num_elements < to_bits) {
+    bits = builder.CreateAnd(
+        bits, llvm::APInt::getLowBitsSet(to_bits, num_elements));
+  }
+  return from_integer(builder, bits, to_llvm_type);
+}
+
+Lowerer::TypeSP Lowerer::unify_sets(TypedValue &lhs, TypedValue &rhs) {
+  if (lhs.type == rhs.type ||
+      (lhs.type->bounds.low == rhs.type->bounds.low &&
+       lhs.type->bounds.high == rhs.type->bounds.high)) {
+    return lhs.type;
+  }
+
+  Bounds bounds = {std::min(lhs.type->bounds.low, rhs.type->bounds.low),
+                   std::max(lhs.type->bounds.high, rhs.type->bounds.high)};
+  if (get_num_elements(bounds.low, bounds.high) > kMaxSetElements) {
+    throw SemanticProblemException(
+        "sets are too far apart to be combined, at most " +
+        std::to_string(kMaxSetElements) + " elements are allowed");
+  }
+  TypeSP type = std::make_shared<Type>(Type{TypeKind::Set, bounds});
+  lhs = TypedValue(codegen_set_convert(lhs.value, lhs.type, type), type);
+  rhs = TypedValue(codegen_set_convert(rhs.value, rhs.type, type), type);
+  return type;
+}
+
+Lowerer::TypedValue Lowerer::codegen_set_union(TypedValue lhs,
+                                               TypedValue rhs) {
+  TypeSP type = unify_sets(lhs, rhs);
+  return TypedValue(current_func_builder_->CreateOr(lhs.value, rhs.value),
+                    type);
+}
+
+Lowerer::TypedValue Lowerer::codegen_set_intersection(TypedValue lhs,
+                                                      TypedValue rhs) {
+  TypeSP type = unify_sets(lhs, rhs);
+  return TypedValue(current_func_builder_->CreateAnd(lhs.value, rhs.value),
+                    type);
+}
+
+Lowerer::TypedValue Lowerer::codegen_set_difference(TypedValue lhs,
+                                                    TypedValue rhs) {
+  TypeSP type = unify_sets(lhs, rhs);
+  llvm::Value *value = current_func_builder_->CreateAnd(
+      lhs.value, current_func_builder_->CreateNot(rhs.value));
+  return TypedValue(value, type);
+}
+
+Lowerer::TypedValue Lowerer::codegen_set_compare(pas::ast::RelOp rel,
+                                                 TypedValue lhs,
+                                                 TypedValue rhs) {
+  if (lhs.type->kind != TypeKind::Set || rhs.type->kind != TypeKind::Set) {
+    throw SemanticProblemException("a set can only be compared with a set");
+  }
+  unify_sets(lhs, rhs);
+
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  // Wide integer comparisons are lowered to word-wise (or SIMD) compares
+  //   by the backend.
+  llvm::Value *value = nullptr;
+  switch (rel) {
+  case pas::ast::RelOp::Equal: {
+    value = builder.CreateICmpEQ(as_integer(builder, lhs.value),
+                                 as_integer(builder, rhs.value));
+    break;
+  }
+  case pas::ast::RelOp::NotEqual: {
+    value = builder.CreateICmpNE(as_integer(builder, lhs.value),
+                                 as_integer(builder, rhs.value));
+    break;
+  }
+  case pas::ast::RelOp::LessEqual:
+  case pas::ast::RelOp::GreaterEqual: {
+    // a <= b is "a is a subset of b", i.e. a - b is empty.
+    if (rel == pas::ast::RelOp::GreaterEqual) {
+      std::swap(lhs, rhs);
+    }
+    llvm::Value *extra =
+        builder.CreateAnd(lhs.value, builder.CreateNot(rhs.value));
+    extra = as_integer(builder, extra);
+    value = builder.CreateICmpEQ(
+        extra, llvm::ConstantInt::get(extra->getType(), 0));
+    break;
+  }
+  case pas::ast::RelOp::Less:
+  case pas::ast::RelOp::Greater: {
+    throw SemanticProblemException(
+        "sets can only be compared with =, <>, <= and >=");
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+  return TypedValue(value, boolean_type_);
+}
+
+Lowerer::TypedValue Lowerer::codegen_set_contains(TypedValue set,
+                                                  TypedValue element) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+
+  llvm::Value *ordinal = nullptr;
+  switch (element.type->kind) {
+  case TypeKind::Integer: {
+    ordinal = builder.CreateSExt(element.value, builder.getInt64Ty());
+    break;
+  }
+  case TypeKind::Char:
+  case TypeKind::Boolean: {
+    ordinal = builder.CreateZExt(element.value, builder.getInt64Ty());
+    break;
+  }
+  default:
+    throw SemanticProblemException(
+        "left hand side of \"in\" must be of an ordinal type");
+  }
+
+  // Elements outside of the base subrange are never in the set. Out of range
+  //   index is replaced with zero, so that the shift below is well-defined.
+  const Bounds &bounds = set.type->bounds;
+  llvm::Value *index =
+      builder.CreateSub(ordinal, builder.getInt64(bounds.low));
+  llvm::Value *in_range = builder.CreateICmpULT(
+      index, builder.getInt64(get_num_elements(bounds.low, bounds.high)));
+  index = builder.CreateSelect(in_range, index, builder.getInt64(0));
+
+  llvm::Value *word = set.value;
+  llvm::Value *bit_index = index;
+  if (set.value->getType()->isVectorTy()) {
+    word = builder.CreateExtractElement(set.value,
+                                        builder.CreateLShr(index, 6));
+    bit_index = builder.CreateAnd(index, 63);
+  }
+  bit_index = builder.CreateZExtOrTrunc(bit_index, word->getType());
+  llvm::Value *bit =
+      builder.CreateTrunc(builder.CreateLShr(word, bit_index),
+                          builder.getInt1Ty());
+  return TypedValue(builder.CreateAnd(in_range, bit), boolean_type_);
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,342 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+#include "ast/utils/get_idx.hpp"
+
+#include "exceptions.hpp"
+#include "stdlib/string.hpp"
+
+namespace pas {
+namespace visitor {
+
+llvm::StructType *Lowerer::get_llvm_string_type() {
+  if (llvm_string_type_ == nullptr) {
+    llvm::Type *int32_type = llvm::Type::getInt32Ty(context_);
+    llvm::Type *storage_type = llvm::ArrayType::get(
+        llvm::Type::getInt64Ty(context_), kStringInlineCapacity / 8);
+    llvm_string_type_ = llvm::StructType::create(
+        context_, {int32_type, int32_type, storage_type}, "pas_string");
+  }
+  return llvm_string_type_;
+}
+
+// Literals are constant globals. Short ones have the characters inline,
+//   long ones point to a buffer with zero refcount: it is shared by all of
+//   the copies and is never freed or modified.
+Lowerer::TypedValue Lowerer::eval_string_literal(const std::string &text) {
+  auto literal_it = string_literals_.find(text);
+  if (literal_it != string_literals_.end()) {
+    return TypedValue(literal_it->second, string_type_);
+  }
+  if (text.size() > std::numeric_limits<uint32_t>::max()) {
+    throw SemanticProblemException("string constant is too long");
+  }
+
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Constant *length = builder.getInt32(text.size());
+  llvm::Constant *init = nullptr;
+  if (text.size() <= kStringInlineCapacity) {
+    std::string storage = text;
+    storage.resize(kStringInlineCapacity, '\0');
+    init = llvm::ConstantStruct::getAnon(
+        {length, builder.getInt32(0),
+         llvm::ConstantDataArray::getString(context_, storage, false)});
+  } else {
+    llvm::Constant *buffer_init = llvm::ConstantStruct::getAnon(
+        {builder.getInt64(0),
+         llvm::ConstantDataArray::getString(context_, text, false)});
+    auto *buffer = new llvm::GlobalVariable(
+        *module_uptr_, buffer_init->getType(), true,
+        llvm::GlobalValue::PrivateLinkage, buffer_init, "str.buffer");
+    buffer->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    buffer->setAlignment(llvm::Align(8));
+    init = llvm::ConstantStruct::getAnon(
+        {length, length,
+         llvm::ConstantExpr::getPointerCast(
+             buffer, builder.getInt8Ty()->getPointerTo()),
+         builder.getInt64(0)});
+  }
+
+  auto *global =
+      new llvm::GlobalVariable(*module_uptr_, init->getType(), true,
+                               llvm::GlobalValue::PrivateLinkage, init, "str");
+  global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  global->setAlignment(llvm::Align(8));
+  llvm::Constant *address = llvm::ConstantExpr::getPointerCast(
+      global, get_llvm_string_type()->getPointerTo());
+  string_literals_[text] = address;
+  return TypedValue(address, string_type_);
+}
+
+// Temporaries are allocated once per function in the entry block, so that
+//   loops don't grow the stack. After release a temporary is an empty string
+//   again and is reused by the next iteration.
+llvm::Value *Lowerer::codegen_string_temporary() {
+  llvm::BasicBlock &entry = current_func_->getEntryBlock();
+  llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+  llvm::AllocaInst *temporary =
+      entry_builder.CreateAlloca(get_llvm_string_type(), nullptr, "str.tmp");
+  entry_builder.CreateStore(
+      llvm::Constant::getNullValue(get_llvm_string_type()), temporary);
+  string_temporaries_.push_back(temporary);
+  return temporary;
+}
+
+bool Lowerer::is_string_temporary(llvm::Value *value) {
+  return std::find(string_temporaries_.begin(), string_temporaries_.end(),
+                   value) != string_temporaries_.end();
+}
+
+void Lowerer::release_string_temporaries() {
+  for (llvm::Value *temporary : string_temporaries_) {
+    codegen_for_each_string(temporary, string_type_, "pas_string_release");
+  }
+  string_temporaries_.clear();
+}
+
+Lowerer::TypedValue Lowerer::codegen_string_concat(TypedValue lhs,
+                                                   TypedValue rhs) {
+  llvm::Type *pointer_type = get_llvm_string_type()->getPointerTo();
+  llvm::Type *void_type = current_func_builder_->getVoidTy();
+
+  // a + b + c appends c to the temporary a + b, which is not shared, so
+  //   the buffer is extended in place.
+  if (is_string_temporary(lhs.value)) {
+    current_func_builder_->CreateCall(
+        get_runtime_function("pas_string_append", void_type,
+                             {pointer_type, pointer_type}),
+        {lhs.value, rhs.value});
+    return lhs;
+  }
+
+  llvm::Value *result = codegen_string_temporary();
+  current_func_builder_->CreateCall(
+      get_runtime_function("pas_string_concat", void_type,
+                           {pointer_type, pointer_type, pointer_type}),
+      {result, lhs.value, rhs.value});
+  return TypedValue(result, string_type_);
+}
+
+Lowerer::TypedValue Lowerer::codegen_string_compare(TypedValue lhs,
+                                                    TypedValue rhs) {
+  llvm::Type *pointer_type = get_llvm_string_type()->getPointerTo();
+  llvm::Value *result = current_func_builder_->CreateCall(
+      get_runtime_function("pas_string_compare",
+                           current_func_builder_->getInt32Ty(),
+                           {pointer_type, pointer_type}),
+      {lhs.value, rhs.value});
+  return TypedValue(result, integer_type_);
+}
+
+Lowerer::TypedValue Lowerer::codegen_string_equal(TypedValue lhs,
+                                                  TypedValue rhs) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = get_llvm_string_type()->getPointerTo();
+  llvm::Value *lhs_length = builder.CreateLoad(
+      builder.getInt32Ty(),
+      builder.CreateStructGEP(get_llvm_string_type(), lhs.value, 0));
+  llvm::Value *rhs_length = builder.CreateLoad(
+      builder.getInt32Ty(),
+      builder.CreateStructGEP(get_llvm_string_type(), rhs.value, 0));
+
+  llvm::BasicBlock *length_block = builder.GetInsertBlock();
+  llvm::BasicBlock *data_block =
+      llvm::BasicBlock::Create(context_, "str_eq_data", current_func_);
+  llvm::BasicBlock *exit_block =
+      llvm::BasicBlock::Create(context_, "str_eq_end", current_func_);
+  builder.CreateCondBr(builder.CreateICmpEQ(lhs_length, rhs_length),
+                       data_block, exit_block);
+
+  builder.SetInsertPoint(data_block);
+  llvm::Value *is_data_equal = builder.CreateCall(
+      get_runtime_function("pas_string_equal", builder.getInt8Ty(),
+                           {pointer_type, pointer_type}),
+      {lhs.value, rhs.value});
+  is_data_equal = builder.CreateICmpNE(is_data_equal, builder.getInt8(0));
+  builder.CreateBr(exit_block);
+
+  builder.SetInsertPoint(exit_block);
+  llvm::PHINode *is_equal = builder.CreatePHI(builder.getInt1Ty(), 2, "str.eq");
+  is_equal->addIncoming(builder.getFalse(), length_block);
+  is_equal->addIncoming(is_data_equal, data_block);
+  return TypedValue(is_equal, boolean_type_);
+}
+
+// Checks, that the term is just the variable itself.
+static bool is_variable(pas::ast::Term &term, const std::string &ident) {
+  if (!term.ops_.empty() ||
+      term.start_factor_.index() !=
+          get_idx(pas::ast::FactorKind::Designator)) {
+    return false;
+  }
+  auto &designator = std::get<pas::ast::Designator>(term.start_factor_);
+  return designator.items_.empty() && designator.ident_ == ident;
+}
+
+void Lowerer::codegen_string_assign(Variable target,
+                                    pas::ast::Designator &designator,
+                                    pas::ast::Expr &expr) {
+  llvm::Type *pointer_type = get_llvm_string_type()->getPointerTo();
+  llvm::Type *void_type = current_func_builder_->getVoidTy();
+
+  // s := s + a + b is appended to s in place, unchanged characters of s are
+  //   not copied, unless the buffer is shared or full.
+  pas::ast::SimpleExpr &simple_expr = expr.start_expr_;
+  bool is_append = designator.items_.empty() && !expr.op_.has_value() &&
+                   !simple_expr.unary_op_.has_value() &&
+                   !simple_expr.ops_.empty() &&
+                   is_variable(simple_expr.start_term_, designator.ident_);
+  for (pas::ast::SimpleExpr::Op &op : simple_expr.ops_) {
+    is_append = is_append && op.op == pas::ast::AddOp::Plus;
+  }
+  if (is_append) {
+    std::vector<TypedValue> parts;
+    bool refers_to_target = false;
+    for (pas::ast::SimpleExpr::Op &op : simple_expr.ops_) {
+      parts.push_back(eval(op.term));
+      if (parts.back().type->kind != TypeKind::String) {
+        throw SemanticProblemException("invalid operand types for +");
+      }
+      refers_to_target =
+          refers_to_target || parts.back().value == target.allocation;
+    }
+    // s := s + a + s must use the old value of s in the end.
+    if (!refers_to_target || parts.size() == 1) {
+      for (TypedValue &part : parts) {
+        current_func_builder_->CreateCall(
+            get_runtime_function("pas_string_append", void_type,
+                                 {pointer_type, pointer_type}),
+            {target.allocation, part.value});
+      }
+      release_string_temporaries();
+      return;
+    }
+    TypedValue value(target.allocation, string_type_);
+    for (TypedValue &part : parts) {
+      value = codegen_string_concat(value, part);
+    }
+    current_func_builder_->CreateCall(
+        get_runtime_function("pas_string_move", void_type,
+                             {pointer_type, pointer_type}),
+        {target.allocation, value.value});
+    release_string_temporaries();
+    return;
+  }
+
+  TypedValue value = eval(expr);
+  if (value.type->kind != TypeKind::String) {
+    throw SemanticProblemException(
+        "incompatible types, must be of the same type for assignment");
+  }
+  // The result of an expression is moved, not copied.
+  if (is_string_temporary(value.value)) {
+    current_func_builder_->CreateCall(
+        get_runtime_function("pas_string_move", void_type,
+                             {pointer_type, pointer_type}),
+        {target.allocation, value.value});
+    string_temporaries_.erase(std::find(
+        string_temporaries_.begin(), string_temporaries_.end(), value.value));
+  } else {
+    current_func_builder_->CreateCall(
+        get_runtime_function("pas_string_assign", void_type,
+                             {pointer_type, pointer_type}),
+        {target.allocation, value.value});
+  }
+  release_string_temporaries();
+}
+
+bool Lowerer::contains_string(const TypeSP &type) {
+  switch (type->kind) {
+  case TypeKind::String:
+    return true;
+  case TypeKind::Array:
+    return contains_string(type->item_type);
+  case TypeKind::Record:
+    return std::any_of(
+        type->fields.begin(), type->fields.end(),
+        [](const Field &field) { return contains_string(field.type); });
+  default:
+    return false;
+  }
+}
+
+void Lowerer::codegen_for_each_string(llvm::Value *address,
+                                      const TypeSP &type,
+                                      const std::string &function_name) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  switch (type->kind) {
+  case TypeKind::String: {
+    builder.CreateCall(
+        get_runtime_function(function_name, builder.getVoidTy(),
+                             {get_llvm_string_type()->getPointerTo()}),
+        {address});
+    break;
+  }
+  case TypeKind::Record: {
+    for (const Field &field : type->fields) {
+      if (contains_string(field.type)) {
+        codegen_for_each_string(
+            builder.CreateStructGEP(get_llvm_type_by_lang_type(type), address,
+                                    field.index),
+            field.type, function_name);
+      }
+    }
+    break;
+  }
+  case TypeKind::Array: {
+    if (!contains_string(type->item_type)) {
+      break;
+    }
+    llvm::BasicBlock *preheader_block = builder.GetInsertBlock();
+    llvm::BasicBlock *body_block =
+        llvm::BasicBlock::Create(context_, "strings_body", current_func_);
+    llvm::BasicBlock *exit_block =
+        llvm::BasicBlock::Create(context_, "strings_end", current_func_);
+    builder.CreateBr(body_block);
+
+    builder.SetInsertPoint(body_block);
+    llvm::PHINode *index = builder.CreatePHI(builder.getInt64Ty(), 2);
+    index->addIncoming(builder.getInt64(0), preheader_block);
+    llvm::Value *item =
+        builder.CreateInBoundsGEP(get_llvm_type_by_lang_type(type), address,
+                                  {builder.getInt64(0), index});
+    codegen_for_each_string(item, type->item_type, function_name);
+    llvm::Value *next_index = builder.CreateNUWAdd(index, builder.getInt64(1));
+    // Nested arrays add blocks, the back edge comes from the last one.
+    index->addIncoming(next_index, builder.GetInsertBlock());
+    uint64_t num_items =
+        static_cast<int64_t>(type->bounds.high) - type->bounds.low + 1;
+    builder.CreateCondBr(
+        builder.CreateICmpULT(next_index, builder.getInt64(num_items)),
+        body_block, exit_block);
+
+    builder.SetInsertPoint(exit_block);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+// Zero filled memory is an empty string.
+void Lowerer::codegen_init_strings(Variable variable) {
+  if (!contains_string(variable.type)) {
+    return;
+  }
+  current_func_builder_->CreateMemSet(
+      variable.allocation, current_func_builder_->getInt8(0),
+      llvm::ConstantExpr::getSizeOf(get_llvm_type_by_lang_type(variable.type)),
+      llvm::MaybeAlign());
+}
+
+} // namespace visitor
+} // namespace pas
@@ -0,0 +1,271 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <unordered_set>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+#include "ast/visitors/escape_analysis.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+static pas::ast::ProcDecl &get_proc_decl(pas::ast::SubprogDecl &subprog_decl) {
+  if (subprog_decl.index() == get_idx(pas::ast::SubprogKind::Func)) {
+    return std::get<pas::ast::FuncDecl>(subprog_decl).proc_decl_;
+  }
+  return std::get<pas::ast::ProcDecl>(subprog_decl);
+}
+
+void Lowerer::declare_subprogram(pas::ast::SubprogDecl &subprog_decl) {
+  pas::ast::ProcHeading &heading = get_proc_decl(subprog_decl).proc_heading_;
+  if (pascal_scopes_.back().contains(heading.proc_name_)) {
+    throw pas::SemanticProblemException("identifier is already in use: " +
+                                        heading.proc_name_);
+  }
+
+  auto lookup_type = [&](const std::string &type_ident) {
+    Decl *decl = lookup_decl(type_ident);
+    if (decl == nullptr || decl->index() != 0) {
+      throw pas::SemanticProblemException(
+          "parameter or result type must be a type: " + type_ident);
+    }
+    return std::get<TypeSP>(*decl);
+  };
+
+  Subprogram subprogram = {nullptr, {}, nullptr};
+  std::vector<llvm::Type *> llvm_param_types;
+  llvm::Type *llvm_result_type = llvm::Type::getVoidTy(context_);
+  if (subprog_decl.index() == get_idx(pas::ast::SubprogKind::Func)) {
+    subprogram.result_type =
+        lookup_type(std::get<pas::ast::FuncDecl>(subprog_decl).ret_type_ident_);
+    TypeKind kind = subprogram.result_type->kind;
+    if (kind == TypeKind::Array || kind == TypeKind::Record) {
+      throw pas::NotImplementedException(
+          "functions returning arrays and records are not implemented yet");
+    }
+    if (kind == TypeKind::File) {
+      throw pas::SemanticProblemException("functions can't return files");
+    }
+    if (kind == TypeKind::String) {
+      llvm_param_types.push_back(get_llvm_string_type()->getPointerTo());
+    } else {
+      llvm_result_type = get_llvm_type_by_lang_type(subprogram.result_type);
+    }
+  }
+  for (pas::ast::FormalParam &param : heading.params_) {
+    TypeSP type = lookup_type(param.type_ident_);
+    for (size_t i = 0; i < param.proc_name_.size(); ++i) {
+      subprogram.param_types.push_back(type);
+      llvm_param_types.push_back(
+          get_llvm_type_by_lang_type(type)->getPointerTo());
+    }
+  }
+
+  subprogram.function = llvm::Function::Create(
+      llvm::FunctionType::get(llvm_result_type, llvm_param_types, false),
+      llvm::Function::InternalLinkage, heading.proc_name_, module_uptr_.get());
+  subprogram.function->addFnAttr(llvm::Attribute::NoUnwind);
+
+  auto arg_it = subprogram.function->arg_begin();
+  if (llvm_param_types.size() > subprogram.param_types.size()) {
+    (arg_it++)->setName("result");
+  }
+  for (pas::ast::FormalParam &param : heading.params_) {
+    for (const std::string &ident : param.proc_name_) {
+      (arg_it++)->setName(ident);
+    }
+  }
+
+  pascal_scopes_.back()[heading.proc_name_] = subprogram;
+}
+
+void Lowerer::lower_subprogram(pas::ast::SubprogDecl &subprog_decl) {
+  pas::ast::ProcDecl &proc_decl = get_proc_decl(subprog_decl);
+  const std::string &name = proc_decl.proc_heading_.proc_name_;
+  pas::ast::Block &block = proc_decl.block_;
+  assert(block.decls_.get() != nullptr);
+  // Copied, scopes change while the body is lowered.
+  Subprogram subprogram = *lookup_subprogram(name);
+
+  llvm::IRBuilder<> func_builder(context_);
+  func_builder.SetInsertPoint(llvm::BasicBlock::Create(
+      context_, "entrypoint", subprogram.function));
+  current_func_ = subprogram.function;
+  current_func_builder_ = &func_builder;
+  set_fast_math(subprogram.function, func_builder);
+  alloc_cache_ = nullptr;
+  create_debug_subprogram(subprogram.function, name,
+                          proc_decl.proc_heading_.loc_);
+  begin_profile_function(proc_decl.proc_heading_.loc_);
+  codegen_budget_tick();
+
+  // Parameters, the result and the local variables share the scope.
+  pascal_scopes_.emplace_back();
+  auto add_variable = [&](const std::string &ident, Variable variable) {
+    if (pascal_scopes_.back().contains(ident)) {
+      throw pas::SemanticProblemException("identifier is already in use: " +
+                                          ident);
+    }
+    pascal_scopes_.back()[ident] = variable;
+  };
+
+  auto arg_it = subprogram.function->arg_begin();
+  const TypeSP &result_type = subprogram.result_type;
+  bool has_result_value =
+      result_type != nullptr && result_type->kind != TypeKind::String;
+  llvm::Value *result_allocation = nullptr;
+  if (result_type != nullptr) {
+    if (has_result_value) {
+      result_allocation = codegen_alloc_value_of_type(result_type);
+      func_builder.CreateStore(
+          llvm::Constant::getNullValue(get_llvm_type_by_lang_type(result_type)),
+          result_allocation);
+    } else {
+      result_allocation = &*arg_it++;
+    }
+    // Assignment to the name of the function sets the result.
+    add_variable(name, Variable(result_allocation, result_type));
+  }
+  for (const TypeSP &param_type : subprogram.param_types) {
+    llvm::Argument &arg = *arg_it++;
+    add_variable(arg.getName().str(), Variable(&arg, param_type));
+  }
+
+  process_decls(*block.decls_);
+  promote_objects_to_stack(block);
+
+  visit(block.stmt_seq_);
+
+  release_variables(block.decls_->var_decls_);
+  if (has_result_value) {
+    func_builder.CreateRet(func_builder.CreateLoad(
+        get_llvm_type_by_lang_type(result_type), result_allocation));
+  } else {
+    func_builder.CreateRetVoid();
+  }
+  finalize_debug_subprogram();
+
+  close_scope();
+  stack_objects_.clear();
+  current_func_ = nullptr;
+  current_func_builder_ = nullptr;
+}
+
+void Lowerer::promote_objects_to_stack(pas::ast::Block &block) {
+  std::unordered_set<std::string> candidates;
+  for (pas::ast::VarDecl &var_decl : block.decls_->var_decls_) {
+    for (const std::string &ident : var_decl.ident_list_) {
+      if (std::get<Variable>(pascal_scopes_.back()[ident]).type->kind ==
+          TypeKind::Pointer) {
+        candidates.insert(ident);
+      }
+    }
+  }
+  std::unordered_set<std::string> non_escaping =
+      EscapeAnalysis(std::move(candidates)).run(block.stmt_seq_);
+
+  // Slots are made in the order of declaration, so that IR is stable.
+  stack_objects_.clear();
+  for (pas::ast::VarDecl &var_decl : block.decls_->var_decls_) {
+    for (const std::string &ident : var_decl.ident_list_) {
+      if (!non_escaping.contains(ident)) {
+        continue;
+      }
+      const TypeSP &type =
+          std::get<Variable>(pascal_scopes_.back()[ident]).type->item_type;
+      if (get_type_size(type) > kMaxStackObjectSize) {
+        continue;
+      }
+      stack_objects_[ident] = current_func_builder_->CreateAlloca(
+          get_llvm_type_by_lang_type(type), nullptr, ident + ".object");
+    }
+  }
+}
+
+Lowerer::Subprogram *
+Lowerer::lookup_subprogram(const std::string &identifier) {
+  for (auto it = pascal_scopes_.rbegin(); it != pascal_scopes_.rend(); ++it) {
+    auto item_it = it->find(identifier);
+    if (item_it != it->end() && item_it->second.index() == 2) {
+      return &std::get<Subprogram>(item_it->second);
+    }
+  }
+  return nullptr;
+}
+
+Lowerer::TypedValue
+Lowerer::codegen_call(const std::string &name,
+                      std::vector<pas::ast::Expr> &params) {
+  Subprogram *subprogram = lookup_subprogram(name);
+  assert(subprogram != nullptr);
+  if (params.size() != subprogram->param_types.size()) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + name + ": expected " +
+        std::to_string(subprogram->param_types.size()) + ", got " +
+        std::to_string(params.size()));
+  }
+
+  std::vector<llvm::Value *> args;
+  llvm::Value *result_temporary = nullptr;
+  const TypeSP &result_type = subprogram->result_type;
+  if (result_type != nullptr && result_type->kind == TypeKind::String) {
+    result_temporary = codegen_string_temporary();
+    args.push_back(result_temporary);
+  }
+  for (size_t i = 0; i < params.size(); ++i) {
+    pas::ast::Designator *designator = as_plain_designator(params[i]);
+    if (designator == nullptr) {
+      throw pas::SemanticProblemException(
+          "var parameter " + std::to_string(i + 1) + " of " + name +
+          " must be a variable");
+    }
+    Variable arg = resolve_designator(*designator);
+    if (arg.type != subprogram->param_types[i]) {
+      throw pas::SemanticProblemException(
+          "incompatible types, var parameter " + std::to_string(i + 1) +
+          " of " + name + " must be of the same type");
+    }
+    args.push_back(arg.allocation);
+  }
+
+  llvm::Value *result =
+      current_func_builder_->CreateCall(subprogram->function, args);
+  if (result_temporary != nullptr) {
+    return TypedValue(result_temporary, result_type);
+  }
+  if (result_type == nullptr) {
+    return TypedValue(nullptr, nullptr);
+  }
+  return TypedValue(result, result_type);
+}
+
+Lowerer::TypedValue Lowerer::eval(pas::ast::FuncCall &func_call) {
+  // Functions of the program hide the builtin ones.
+  Subprogram *subprogram = lookup_subprogram(func_call.func_ident_);
+  const Builtin *builtin = lookup_builtin(func_call.func_ident_);
+  if (subprogram == nullptr && builtin != nullptr) {
+    return eval_builtin(func_call.func_ident_, *builtin, func_call.params_);
+  }
+  if (subprogram == nullptr && (func_call.func_ident_ == "await" ||
+                                func_call.func_ident_ == "receive")) {
+    return eval_task_function(func_call);
+  }
+  if (subprogram == nullptr) {
+    throw pas::SemanticProblemException("function not found: " +
+                                        func_call.func_ident_);
+  }
+  if (subprogram->result_type == nullptr) {
+    throw pas::SemanticProblemException(
+        "procedure doesn't return a value: " + func_call.func_ident_);
+  }
+  return codegen_call(func_call.func_ident_, func_call.params_);
+}
+
+} // namespace visitor
+} // namespace pas
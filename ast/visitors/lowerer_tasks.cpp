@@ -0,0 +1,399 @@
+#include "ast/visitors/lowerer.hpp"
+
+#include <algorithm>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include "ast/ast.hpp"
+
+#include "exceptions.hpp"
+
+namespace pas {
+namespace visitor {
+
+bool Lowerer::is_transferable(const TypeSP &type) {
+  switch (type->kind) {
+  case TypeKind::Integer:
+  case TypeKind::Char:
+  case TypeKind::Boolean:
+  case TypeKind::Real:
+  case TypeKind::Set:
+  case TypeKind::Pointer:
+  case TypeKind::Channel:
+    return true;
+  case TypeKind::Array:
+    return is_transferable(type->item_type);
+  case TypeKind::Record:
+    return std::all_of(type->fields.begin(), type->fields.end(),
+                       [](const Field &field) {
+                         return is_transferable(field.type);
+                       });
+  default:
+    return false;
+  }
+}
+
+Lowerer::TypeSP Lowerer::make_task_type(pas::ast::TaskType &task_type) {
+  auto type = std::make_shared<Type>(Type{TypeKind::Task});
+  if (task_type.result_type_.has_value()) {
+    type->item_type = make_type_from_ast_type(*task_type.result_type_);
+    if (!is_transferable(type->item_type)) {
+      throw pas::SemanticProblemException(
+          "results of tasks can't be or contain strings, files or tasks");
+    }
+  }
+  return type;
+}
+
+Lowerer::TypeSP
+Lowerer::make_channel_type(pas::ast::ChannelType &channel_type) {
+  TypeSP item_type = make_type_from_ast_type(channel_type.item_type_);
+  if (!is_transferable(item_type)) {
+    throw pas::SemanticProblemException(
+        "items of a channel can't be or contain strings, files or tasks");
+  }
+  return std::make_shared<Type>(
+      Type{TypeKind::Channel, {0, 0}, std::move(item_type)});
+}
+
+llvm::StructType *
+Lowerer::get_task_frame_type(const Subprogram &subprogram) {
+  std::vector<llvm::Type *> fields;
+  if (subprogram.result_type != nullptr) {
+    fields.push_back(get_llvm_type_by_lang_type(subprogram.result_type));
+  }
+  for (const TypeSP &param_type : subprogram.param_types) {
+    fields.push_back(get_llvm_type_by_lang_type(param_type));
+  }
+  return llvm::StructType::get(context_, fields);
+}
+
+// void p.task(i8 *frame) calls p with the addresses of the arguments in
+//   the frame and stores the result to it. One for every spawned
+//   procedure.
+llvm::Function *Lowerer::get_task_body(const Subprogram &subprogram) {
+  std::string name = subprogram.function->getName().str() + ".task";
+  if (llvm::Function *body = module_uptr_->getFunction(name)) {
+    return body;
+  }
+  llvm::Type *pointer_type = llvm::Type::getInt8Ty(context_)->getPointerTo();
+  llvm::Function *body = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context_), {pointer_type},
+                              false),
+      llvm::Function::InternalLinkage, name, module_uptr_.get());
+  body->addFnAttr(llvm::Attribute::NoUnwind);
+  body->getArg(0)->setName("frame");
+
+  llvm::IRBuilder<> builder(
+      llvm::BasicBlock::Create(context_, "entrypoint", body));
+  llvm::StructType *frame_type = get_task_frame_type(subprogram);
+  llvm::Value *frame =
+      builder.CreatePointerCast(body->getArg(0), frame_type->getPointerTo());
+  unsigned first_param = subprogram.result_type != nullptr ? 1 : 0;
+  std::vector<llvm::Value *> args;
+  for (unsigned i = 0; i < subprogram.param_types.size(); ++i) {
+    args.push_back(builder.CreateStructGEP(frame_type, frame, first_param + i));
+  }
+  llvm::Value *result = builder.CreateCall(subprogram.function, args);
+  if (subprogram.result_type != nullptr) {
+    builder.CreateStore(result, builder.CreateStructGEP(frame_type, frame, 0));
+  }
+  builder.CreateRetVoid();
+  return body;
+}
+
+llvm::Value *Lowerer::codegen_await(Variable task) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  llvm::Value *handle = builder.CreateLoad(pointer_type, task.allocation);
+  builder.CreateCall(get_runtime_function("pas_task_await",
+                                          builder.getVoidTy(), {pointer_type}),
+                     {handle});
+  return handle;
+}
+
+void Lowerer::codegen_task_release(Variable task, llvm::Value *handle) {
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  builder.CreateCall(get_runtime_function("pas_task_release",
+                                          builder.getVoidTy(), {pointer_type}),
+                     {handle});
+  // The task is gone, await of it again aborts.
+  builder.CreateStore(
+      llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(pointer_type)),
+      task.allocation);
+}
+
+// Returns the factor, if expression consists of it only.
+static pas::ast::Factor *as_single_factor(pas::ast::Expr &expr) {
+  if (expr.op_.has_value() || expr.start_expr_.unary_op_.has_value() ||
+      !expr.start_expr_.ops_.empty() ||
+      !expr.start_expr_.start_term_.ops_.empty()) {
+    return nullptr;
+  }
+  pas::ast::Factor &factor = expr.start_expr_.start_term_.start_factor_;
+  if (factor.index() == get_idx(pas::ast::FactorKind::Expr)) {
+    return as_single_factor(*std::get<pas::ast::ExprUP>(factor));
+  }
+  return &factor;
+}
+
+void Lowerer::visit_task_procedure(pas::ast::ProcCall &proc_call) {
+  const std::string &name = proc_call.proc_ident_;
+  std::vector<pas::ast::Expr> &params = proc_call.params_;
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+  llvm::Type *void_type = builder.getVoidTy();
+
+  size_t num_params = name == "spawn" || name == "new_channel" ||
+                              name == "send"
+                          ? 2
+                          : 1;
+  if (params.size() != num_params) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + name + ": expected " +
+        std::to_string(num_params) + ", got " + std::to_string(params.size()));
+  }
+  // The first parameter is the task or the channel.
+  TypeKind kind = name == "spawn" || name == "await" ? TypeKind::Task
+                                                     : TypeKind::Channel;
+  pas::ast::Designator *designator = as_plain_designator(params[0]);
+  if (designator == nullptr) {
+    throw pas::SemanticProblemException("parameter 1 of " + name +
+                                        " must be a variable");
+  }
+  Variable handle = resolve_designator(*designator);
+  if (handle.type->kind != kind) {
+    throw pas::SemanticProblemException(
+        "parameter 1 of " + name + " must be " +
+        (kind == TypeKind::Task ? "a task" : "a channel"));
+  }
+
+  if (name == "await") {
+    codegen_task_release(handle, codegen_await(handle));
+    return;
+  }
+  if (name == "new_channel") {
+    TypedValue capacity = eval(params[1]);
+    if (capacity.type->kind != TypeKind::Integer) {
+      throw pas::SemanticProblemException(
+          "capacity of a channel must be of type Integer");
+    }
+    llvm::Value *channel = builder.CreateCall(
+        get_runtime_function("pas_channel_new", pointer_type,
+                             {builder.getInt64Ty(), builder.getInt32Ty()}),
+        {llvm::ConstantExpr::getSizeOf(
+             get_llvm_type_by_lang_type(handle.type->item_type)),
+         capacity.value});
+    builder.CreateStore(channel, handle.allocation);
+    return;
+  }
+  if (name == "send") {
+    const TypeSP &item_type = handle.type->item_type;
+    llvm::Value *channel = builder.CreateLoad(pointer_type, handle.allocation);
+    llvm::Value *item = nullptr;
+    if (item_type->kind == TypeKind::Array ||
+        item_type->kind == TypeKind::Record) {
+      pas::ast::Designator *item_designator = as_plain_designator(params[1]);
+      if (item_designator == nullptr) {
+        throw pas::SemanticProblemException(
+            "only a variable can be sent to a channel of arrays or records");
+      }
+      Variable source = resolve_designator(*item_designator);
+      if (source.type != item_type) {
+        throw pas::SemanticProblemException(
+            "incompatible types, item must be of the item type of the "
+            "channel");
+      }
+      item = source.allocation;
+    } else {
+      llvm::Value *value = codegen_convert(eval(params[1]), item_type);
+      llvm::BasicBlock &entry = current_func_->getEntryBlock();
+      llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+      item = entry_builder.CreateAlloca(get_llvm_type_by_lang_type(item_type),
+                                        nullptr, "send.item");
+      builder.CreateStore(value, item);
+    }
+    builder.CreateCall(get_runtime_function("pas_channel_send", void_type,
+                                            {pointer_type, pointer_type}),
+                       {channel, builder.CreatePointerCast(item, pointer_type)});
+    release_string_temporaries();
+    return;
+  }
+  if (name == "close_channel" || name == "dispose_channel") {
+    bool is_close = name == "close_channel";
+    builder.CreateCall(
+        get_runtime_function(is_close ? "pas_channel_close"
+                                       : "pas_channel_free",
+                             void_type, {pointer_type}),
+        {builder.CreateLoad(pointer_type, handle.allocation)});
+    if (!is_close) {
+      builder.CreateStore(llvm::ConstantPointerNull::get(
+                              llvm::cast<llvm::PointerType>(pointer_type)),
+                          handle.allocation);
+    }
+    return;
+  }
+
+  assert(name == "spawn");
+  // spawn(t, p) or spawn(t, p(a, b)), the call is not evaluated here.
+  pas::ast::Factor *call = as_single_factor(params[1]);
+  std::string subprogram_name;
+  std::vector<pas::ast::Expr> no_args;
+  std::vector<pas::ast::Expr> *args = &no_args;
+  if (call != nullptr &&
+      call->index() == get_idx(pas::ast::FactorKind::FuncCall)) {
+    auto &func_call = *std::get<pas::ast::FuncCallUP>(*call);
+    subprogram_name = func_call.func_ident_;
+    args = &func_call.params_;
+  } else if (call != nullptr &&
+             call->index() == get_idx(pas::ast::FactorKind::Designator) &&
+             std::get<pas::ast::Designator>(*call).items_.empty()) {
+    subprogram_name = std::get<pas::ast::Designator>(*call).ident_;
+  } else {
+    throw pas::SemanticProblemException(
+        "parameter 2 of spawn must be a call of a procedure or a function");
+  }
+  Subprogram *subprogram = lookup_subprogram(subprogram_name);
+  if (subprogram == nullptr) {
+    throw pas::SemanticProblemException(
+        "procedure or function not found: " + subprogram_name);
+  }
+  const TypeSP &result_type = subprogram->result_type;
+  if (handle.type->item_type != nullptr &&
+      handle.type->item_type != result_type) {
+    throw pas::SemanticProblemException(
+        "incompatible types, result of " + subprogram_name +
+        " must be of the result type of the task");
+  }
+  if (result_type != nullptr && !is_transferable(result_type)) {
+    throw pas::SemanticProblemException(
+        "results of tasks can't be or contain strings, files or tasks: " +
+        subprogram_name);
+  }
+  if (args->size() != subprogram->param_types.size()) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + subprogram_name +
+        ": expected " + std::to_string(subprogram->param_types.size()) +
+        ", got " + std::to_string(args->size()));
+  }
+
+  llvm::StructType *frame_type = get_task_frame_type(*subprogram);
+  llvm::Function *body = get_task_body(*subprogram);
+  llvm::Value *task = builder.CreateCall(
+      get_runtime_function(
+          "pas_task_new", pointer_type,
+          {body->getType(), builder.getInt64Ty(), builder.getInt64Ty()}),
+      {body, llvm::ConstantExpr::getSizeOf(frame_type),
+       llvm::ConstantExpr::getAlignOf(frame_type)});
+  llvm::Value *frame =
+      builder.CreatePointerCast(task, frame_type->getPointerTo());
+  unsigned first_param = result_type != nullptr ? 1 : 0;
+  for (unsigned i = 0; i < args->size(); ++i) {
+    const TypeSP &param_type = subprogram->param_types[i];
+    if (!is_transferable(param_type)) {
+      throw pas::SemanticProblemException(
+          "parameters of spawned procedures can't be or contain strings, "
+          "files or tasks: " +
+          subprogram_name);
+    }
+    llvm::Value *field =
+        builder.CreateStructGEP(frame_type, frame, first_param + i);
+    if (param_type->kind == TypeKind::Array ||
+        param_type->kind == TypeKind::Record) {
+      pas::ast::Designator *arg_designator = as_plain_designator((*args)[i]);
+      if (arg_designator == nullptr) {
+        throw pas::SemanticProblemException(
+            "parameter " + std::to_string(i + 1) + " of " + subprogram_name +
+            " must be a variable");
+      }
+      Variable arg = resolve_designator(*arg_designator);
+      if (arg.type != param_type) {
+        throw pas::SemanticProblemException(
+            "incompatible types, parameter " + std::to_string(i + 1) +
+            " of " + subprogram_name + " must be of the same type");
+      }
+      builder.CreateMemCpy(
+          field, llvm::MaybeAlign(), arg.allocation, llvm::MaybeAlign(),
+          llvm::ConstantExpr::getSizeOf(get_llvm_type_by_lang_type(param_type)));
+      continue;
+    }
+    builder.CreateStore(codegen_convert(eval((*args)[i]), param_type), field);
+  }
+  release_string_temporaries();
+
+  builder.CreateCall(
+      get_runtime_function("pas_task_spawn", void_type, {pointer_type}),
+      {task});
+  builder.CreateStore(task, handle.allocation);
+}
+
+Lowerer::TypedValue
+Lowerer::eval_task_function(pas::ast::FuncCall &func_call) {
+  const std::string &name = func_call.func_ident_;
+  std::vector<pas::ast::Expr> &params = func_call.params_;
+  llvm::IRBuilder<> &builder = *current_func_builder_;
+  llvm::Type *pointer_type = builder.getInt8Ty()->getPointerTo();
+
+  size_t num_params = name == "receive" ? 2 : 1;
+  if (params.size() != num_params) {
+    throw pas::SemanticProblemException(
+        "wrong number of parameters in the call of " + name + ": expected " +
+        std::to_string(num_params) + ", got " + std::to_string(params.size()));
+  }
+  std::vector<Variable> variables;
+  for (size_t i = 0; i < params.size(); ++i) {
+    pas::ast::Designator *designator = as_plain_designator(params[i]);
+    if (designator == nullptr) {
+      throw pas::SemanticProblemException("parameter " + std::to_string(i + 1) +
+                                          " of " + name +
+                                          " must be a variable");
+    }
+    variables.push_back(resolve_designator(*designator));
+  }
+
+  if (name == "await") {
+    Variable task = variables[0];
+    if (task.type->kind != TypeKind::Task) {
+      throw pas::SemanticProblemException("parameter 1 of await must be a task");
+    }
+    const TypeSP &result_type = task.type->item_type;
+    if (result_type == nullptr) {
+      throw pas::SemanticProblemException(
+          "task of a procedure doesn't return a value");
+    }
+    llvm::Value *handle = codegen_await(task);
+    llvm::Type *llvm_result_type = get_llvm_type_by_lang_type(result_type);
+    llvm::Value *result = builder.CreateLoad(
+        llvm_result_type,
+        builder.CreatePointerCast(handle, llvm_result_type->getPointerTo()),
+        "await");
+    codegen_task_release(task, handle);
+    return TypedValue(result, result_type);
+  }
+
+  assert(name == "receive");
+  Variable channel = variables[0];
+  Variable item = variables[1];
+  if (channel.type->kind != TypeKind::Channel) {
+    throw pas::SemanticProblemException(
+        "parameter 1 of receive must be a channel");
+  }
+  if (item.type != channel.type->item_type) {
+    throw pas::SemanticProblemException(
+        "incompatible types, parameter 2 of receive must be of the item "
+        "type of the channel");
+  }
+  llvm::Value *received = builder.CreateCall(
+      get_runtime_function("pas_channel_receive", builder.getInt8Ty(),
+                           {pointer_type, pointer_type}),
+      {builder.CreateLoad(pointer_type, channel.allocation),
+       builder.CreatePointerCast(item.allocation, pointer_type)});
+  return TypedValue(builder.CreateICmpNE(received, builder.getInt8(0)),
+                    boolean_type_);
+}
+
+} // namespace visitor
+} // namespace pas
@@ -6,59 +6,56 @@
 namespace pas {
 namespace visitor {
 
-#define DESCEND(...)                                                           \
-  {                                                                            \
-    depth_ += 1;                                                               \
-    __VA_ARGS__;                                                               \
-    depth_ -= 1;                                                               \
-  }
-
 std::string Printer::get_indent() { return std::string(depth_, ' '); }
 
+void Printer::run(const char *line) {
+  stream_ << get_indent() << line << '\n';
+}
+
 void Printer::visit(pas::ast::ProgramModule &pm) {
   stream_ << get_indent() << "ProgramModule name=" << pm.program_name_ << '\n';
-  DESCEND(visit(pm.block_));
+  descend(pm.block_);
 }
 
 void Printer::visit(pas::ast::Block &block) {
   stream_ << get_indent() << "Block" << '\n';
 
   assert(block.decls_.get() != nullptr);
-  DESCEND(visit(*block.decls_.get()));
+  descend(*block.decls_.get());
 
-  DESCEND(visit(block.stmt_seq_));
+  descend(block.stmt_seq_);
 }
 
 void Printer::visit(pas::ast::Declarations &decls) {
   stream_ << get_indent() << "Declarations" << '\n';
 
   for (auto &const_def : decls.const_defs_) {
-    DESCEND(visit(const_def));
+    descend(const_def);
   }
 
   for (auto &type_def : decls.type_defs_) {
-    DESCEND(visit(type_def));
+    descend(type_def);
   }
 
   for (auto &var_decl : decls.var_decls_) {
-    DESCEND(visit(var_decl));
+    descend(var_decl);
   }
 
   for (auto &subprog_decl : decls.subprog_decls_) {
-    DESCEND(visit(subprog_decl));
+    descend(subprog_decl);
   }
 }
 
 void Printer::visit(pas::ast::ConstDef &const_def) {
   stream_ << get_indent() << "ConstDef name=" << const_def.ident_ << '\n';
 
-  DESCEND(visit(const_def.const_expr_));
+  descend(const_def.const_expr_);
 }
 
 void Printer::visit(pas::ast::TypeDef &type_def) {
   stream_ << get_indent() << "TypeDef name=" << type_def.ident_ << '\n';
 
-  DESCEND(visit(type_def.type_));
+  descend(type_def.type_);
 }
 
 void Printer::visit(pas::ast::VarDecl &var_decl) {
@@ -73,7 +70,7 @@ void Printer::visit(pas::ast::VarDecl &var_decl) {
   }
   stream_ << '\n';
 
-  DESCEND(visit(var_decl.type_));
+  descend(var_decl.type_);
 }
 
 void Printer::visit(pas::ast::ConstExpr &const_expr) {
@@ -93,8 +90,9 @@ void Printer::visit(pas::ast::ConstExpr &const_expr) {
       __builtin_unreachable();
     }
   }
+  stream_ << '\n';
 
-  DESCEND(visit(const_expr.factor_));
+  descend(const_expr.factor_);
 }
 
 void Printer::visit(pas::ast::ConstFactor &const_factor) {
@@ -129,20 +127,23 @@ void Printer::visit(pas::ast::Subrange &node) {}
 void Printer::visit(pas::ast::RecordType &node) {}
 void Printer::visit(pas::ast::SetType &node) {}
 void Printer::visit(pas::ast::PointerType &node) {}
+void Printer::visit(pas::ast::FileType &node) {}
+void Printer::visit(pas::ast::TaskType &node) {}
+void Printer::visit(pas::ast::ChannelType &node) {}
 void Printer::visit(pas::ast::FieldList &node) {}
 
 void Printer::visit(pas::ast::Assignment &assignment) {
   stream_ << get_indent() << "Assignment" << '\n';
 
-  DESCEND(visit(assignment.designator_));
-  DESCEND(visit(assignment.expr_));
+  descend(assignment.designator_);
+  descend(assignment.expr_);
 }
 
 void Printer::visit(pas::ast::ProcCall &proc_call) {
   stream_ << get_indent() << "ProcCall name=" << proc_call.proc_ident_ << '\n';
 
   for (pas::ast::Expr &expr : proc_call.params_) {
-    DESCEND(visit(expr));
+    descend(expr);
   }
 }
 
@@ -150,28 +151,43 @@ void Printer::visit(pas::ast::StmtSeq &stmt_seq) {
   stream_ << get_indent() << "StmtSeq" << '\n';
 
   for (auto &stmt : stmt_seq.stmts_) {
-    DESCEND(visit_stmt(*this, stmt));
+    descend(stmt);
   }
 }
 
 void Printer::visit(pas::ast::IfStmt &if_stmt) {
   stream_ << get_indent() << "IfStmt" << '\n';
 
-  DESCEND(visit(if_stmt.cond_expr_));
-  DESCEND(visit_stmt(*this, if_stmt.then_stmt_));
+  descend(if_stmt.cond_expr_);
+  descend(if_stmt.then_stmt_);
   if (if_stmt.else_stmt_.has_value()) {
-    DESCEND(visit_stmt(*this, if_stmt.else_stmt_.value()));
+    descend(if_stmt.else_stmt_.value());
+  }
+}
+
+void Printer::visit(pas::ast::CaseStmt &node) {
+  stream_ << get_indent() << "CaseStmt" << '\n';
+
+  descend(node.cond_expr_);
+  for (pas::ast::Case &case_item : node.cases_) {
+    descend(case_item);
   }
 }
 
-void Printer::visit(pas::ast::CaseStmt &node) {}
-void Printer::visit(pas::ast::Case &node) {}
+void Printer::visit(pas::ast::Case &node) {
+  stream_ << get_indent() << "Case" << '\n';
+
+  for (pas::ast::Element &label : node.labels_) {
+    descend(label);
+  }
+  descend(node.then_stmt_);
+}
 
 void Printer::visit(pas::ast::WhileStmt &while_stmt) {
   stream_ << get_indent() << "WhileStmt" << '\n';
 
-  DESCEND(visit(while_stmt.cond_expr_));
-  DESCEND(visit_stmt(*this, while_stmt.inner_stmt_));
+  descend(while_stmt.cond_expr_);
+  descend(while_stmt.inner_stmt_);
 }
 
 void Printer::visit(pas::ast::RepeatStmt &node) {}
@@ -191,18 +207,24 @@ void Printer::visit(pas::ast::ForStmt &for_stmt) {
     assert(false);
     __builtin_unreachable();
   }
+  if (for_stmt.is_parallel_) {
+    stream_ << " parallel";
+    for (const std::string &reduction : for_stmt.reductions_) {
+      stream_ << " reduce=" << reduction;
+    }
+  }
   stream_ << '\n';
 
-  DESCEND(visit(for_stmt.start_val_expr_));
-  DESCEND(visit(for_stmt.finish_val_expr_));
-  DESCEND(visit_stmt(*this, for_stmt.inner_stmt_));
+  descend(for_stmt.start_val_expr_);
+  descend(for_stmt.finish_val_expr_);
+  descend(for_stmt.inner_stmt_);
 }
 
 void Printer::visit(pas::ast::Designator &designator) {
   stream_ << get_indent() << "Designator ident=" << designator.ident_ << '\n';
 
   for (pas::ast::DesignatorItem &item : designator.items_) {
-    DESCEND(visit(item));
+    descend(item);
   }
 }
 
@@ -226,7 +248,7 @@ void Printer::visit(pas::ast::DesignatorArrayAccess &array_access) {
   stream_ << get_indent() << "DesignatorArrayAccess" << '\n';
 
   for (std::unique_ptr<pas::ast::Expr> &expr_ptr : array_access.expr_list_) {
-    DESCEND(visit(*expr_ptr));
+    descend(*expr_ptr);
   }
 }
 
@@ -237,7 +259,7 @@ void Printer::visit(pas::ast::EmptyStmt &empty_stmt) {}
 
 void Printer::visit(pas::ast::Expr &expr) {
   if (!expr.op_.has_value()) {
-    visit(expr.start_expr_);
+    visit_later(expr.start_expr_);
   } else {
     stream_ << get_indent() << "Expr op=";
     switch (expr.op_.value().rel) {
@@ -275,14 +297,14 @@ void Printer::visit(pas::ast::Expr &expr) {
     }
     stream_ << '\n';
 
-    DESCEND(visit(expr.start_expr_));
-    DESCEND(visit(expr.op_.value().expr));
+    descend(expr.start_expr_);
+    descend(expr.op_.value().expr);
   }
 }
 
 void Printer::visit(pas::ast::SimpleExpr &simple_expr) {
   if (simple_expr.ops_.empty() && !simple_expr.unary_op_.has_value()) {
-    visit(simple_expr.start_term_);
+    visit_later(simple_expr.start_term_);
   } else {
     stream_ << get_indent() << "SimpleExpr";
     if (simple_expr.unary_op_.has_value()) {
@@ -303,20 +325,20 @@ void Printer::visit(pas::ast::SimpleExpr &simple_expr) {
     }
     stream_ << '\n';
 
-    DESCEND(visit(simple_expr.start_term_));
+    descend(simple_expr.start_term_);
 
     for (pas::ast::SimpleExpr::Op &op : simple_expr.ops_) {
       switch (op.op) {
       case pas::ast::AddOp::Minus: {
-        DESCEND(stream_ << get_indent() << "Minus" << '\n');
+        descend("Minus");
         break;
       }
       case pas::ast::AddOp::Plus: {
-        DESCEND(stream_ << get_indent() << "Plus" << '\n');
+        descend("Plus");
         break;
       }
       case pas::ast::AddOp::Or: {
-        DESCEND(stream_ << get_indent() << "Or" << '\n');
+        descend("Or");
         break;
       }
       default:
@@ -324,39 +346,39 @@ void Printer::visit(pas::ast::SimpleExpr &simple_expr) {
         __builtin_unreachable();
       }
 
-      DESCEND(visit(op.term));
+      descend(op.term);
     }
   }
 }
 
 void Printer::visit(pas::ast::Term &term) {
   if (term.ops_.empty()) {
-    visit(term.start_factor_);
+    visit_later(term.start_factor_);
   } else {
     stream_ << get_indent() << "Term" << '\n';
 
-    DESCEND(visit(term.start_factor_));
+    descend(term.start_factor_);
 
     for (pas::ast::Term::Op &op : term.ops_) {
       switch (op.op) {
       case pas::ast::MultOp::And: {
-        DESCEND(stream_ << get_indent() << "And" << '\n');
+        descend("And");
         break;
       }
       case pas::ast::MultOp::IntDiv: {
-        DESCEND(stream_ << get_indent() << "IntDiv" << '\n');
+        descend("IntDiv");
         break;
       }
       case pas::ast::MultOp::Modulo: {
-        DESCEND(stream_ << get_indent() << "Modulo" << '\n');
+        descend("Modulo");
         break;
       }
       case pas::ast::MultOp::Multiply: {
-        DESCEND(stream_ << get_indent() << "Multiply" << '\n');
+        descend("Multiply");
         break;
       }
       case pas::ast::MultOp::RealDiv: {
-        DESCEND(stream_ << get_indent() << "RealDiv" << '\n');
+        descend("RealDiv");
         break;
       }
       default:
@@ -364,7 +386,7 @@ void Printer::visit(pas::ast::Term &term) {
         __builtin_unreachable();
       }
 
-      DESCEND(visit(op.factor));
+      descend(op.factor);
     }
   }
 }
@@ -377,17 +399,17 @@ void Printer::visit(pas::ast::Factor &factor) {
     break;
   }
   case get_idx(pas::ast::FactorKind::Designator): {
-    visit(std::get<pas::ast::Designator>(factor));
+    visit_later(std::get<pas::ast::Designator>(factor));
     break;
   }
   case get_idx(pas::ast::FactorKind::Expr): {
-    visit(*std::get<pas::ast::ExprUP>(factor));
+    visit_later(*std::get<pas::ast::ExprUP>(factor));
     break;
   }
   case get_idx(pas::ast::FactorKind::Negation): {
     stream_ << get_indent() << "Factor Not" << '\n';
 
-    DESCEND(visit(std::get<pas::ast::NegationUP>(factor)->factor_));
+    descend(std::get<pas::ast::NegationUP>(factor)->factor_);
     break;
   }
   case get_idx(pas::ast::FactorKind::Nil): {
@@ -399,6 +421,11 @@ void Printer::visit(pas::ast::Factor &factor) {
             << '\n';
     break;
   }
+  case get_idx(pas::ast::FactorKind::Real): {
+    stream_ << get_indent() << "Factor real=" << std::get<double>(factor)
+            << '\n';
+    break;
+  }
   case get_idx(pas::ast::FactorKind::String): {
     stream_ << get_indent() << "Factor string=\""
             << std::get<std::string>(factor) << "\"" << '\n';
@@ -408,6 +435,15 @@ void Printer::visit(pas::ast::Factor &factor) {
     visit(*std::get<pas::ast::FuncCallUP>(factor));
     break;
   }
+  case get_idx(pas::ast::FactorKind::SetValue): {
+    stream_ << get_indent() << "Factor SetValue" << '\n';
+
+    for (pas::ast::Element &element :
+         std::get<pas::ast::SetValueUP>(factor)->elements_) {
+      descend(element);
+    }
+    break;
+  }
   default:
     assert(false);
     __builtin_unreachable();
@@ -417,20 +453,50 @@ void Printer::visit(pas::ast::Factor &factor) {
 void Printer::visit(pas::ast::FuncCall &func_call) {
   stream_ << get_indent() << "FuncCall ident=" << func_call.func_ident_ << '\n';
   for (pas::ast::Expr &expr : func_call.params_) {
-    DESCEND(visit(expr));
+    descend(expr);
   }
 }
 
-void Printer::visit(pas::ast::Element &node) {}
+void Printer::visit(pas::ast::Element &node) {
+  switch (node.index()) {
+  case get_idx(pas::ast::ElementKind::ConstExpr): {
+    stream_ << get_indent() << "Element" << '\n';
+
+    descend(std::get<pas::ast::ConstExpr>(node));
+    break;
+  }
+  case get_idx(pas::ast::ElementKind::ConstExprRange): {
+    stream_ << get_indent() << "Element range" << '\n';
+
+    auto &range = std::get<std::pair<pas::ast::ConstExpr, pas::ast::ConstExpr>>(
+        node);
+    descend(range.first);
+    descend(range.second);
+    break;
+  }
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
 void Printer::visit(pas::ast::SubprogDecl &node) {}
 void Printer::visit(pas::ast::ProcDecl &node) {}
 void Printer::visit(pas::ast::FuncDecl &node) {}
 void Printer::visit(pas::ast::ProcHeading &node) {}
 void Printer::visit(pas::ast::FormalParam &node) {}
 
-void Printer::visit(pas::ast::CompilationUnit &cu) { visit(cu.pm_); }
-
-#undef DESCEND
+void Printer::visit(pas::ast::CompilationUnit &cu) {
+  stack_.push_back(ScheduledTask{&cu.pm_, 0});
+  while (!stack_.empty()) {
+    ScheduledTask scheduled = stack_.back();
+    stack_.pop_back();
+    depth_ = scheduled.depth;
+    std::visit([this](auto node) { run(node); }, scheduled.task);
+    // The first child is on top.
+    stack_.insert(stack_.end(), children_.rbegin(), children_.rend());
+    children_.clear();
+  }
+}
 
 } // namespace visitor
 } // namespace pas
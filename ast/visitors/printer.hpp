@@ -8,10 +8,17 @@
 #include <limits>
 #include <string>
 #include <unordered_map>
+#include <variant>
+#include <vector>
 
 namespace pas {
 namespace visitor {
 
+// Nodes are printed from an explicit stack, not recursively, so that the
+//   depth of the AST is limited by memory. A visit prints the line of the
+//   node and schedules its children, visits of nodes, that have no line of
+//   their own (e.g. an Expr without an operator), schedule the children at
+//   the same depth.
 class Printer {
 public:
   Printer(std::ostream &stream) : stream_(stream) {}
@@ -19,6 +26,37 @@ public:
 private:
   MAKE_VISIT_STMT_FRIEND();
 
+  // Nodes to visit, a line is printed as is (e.g. operators of a Term).
+  using Task =
+      std::variant<pas::ast::ProgramModule *, pas::ast::Block *,
+                   pas::ast::Declarations *, pas::ast::ConstDef *,
+                   pas::ast::TypeDef *, pas::ast::VarDecl *,
+                   pas::ast::SubprogDecl *, pas::ast::ConstExpr *,
+                   pas::ast::ConstFactor *, pas::ast::Type *,
+                   pas::ast::Stmt *, pas::ast::StmtSeq *, pas::ast::Case *,
+                   pas::ast::Expr *, pas::ast::SimpleExpr *,
+                   pas::ast::Term *, pas::ast::Factor *,
+                   pas::ast::Designator *, pas::ast::DesignatorItem *,
+                   pas::ast::Element *, const char *>;
+  struct ScheduledTask {
+    Task task;
+    size_t depth;
+  };
+
+  template <typename Node> void descend(Node &node) {
+    children_.push_back(ScheduledTask{&node, depth_ + 1});
+  }
+  void descend(const char *line) {
+    children_.push_back(ScheduledTask{line, depth_ + 1});
+  }
+  template <typename Node> void visit_later(Node &node) {
+    children_.push_back(ScheduledTask{&node, depth_});
+  }
+
+  template <typename Node> void run(Node *node) { visit(*node); }
+  void run(pas::ast::Stmt *stmt) { visit_stmt(*this, *stmt); }
+  void run(const char *line);
+
   std::string get_indent();
 
   void visit(pas::ast::ProgramModule &pm);
@@ -35,6 +73,9 @@ private:
   void visit(pas::ast::RecordType &node);
   void visit(pas::ast::SetType &node);
   void visit(pas::ast::PointerType &node);
+  void visit(pas::ast::FileType &node);
+  void visit(pas::ast::TaskType &node);
+  void visit(pas::ast::ChannelType &node);
   void visit(pas::ast::FieldList &node);
   void visit(pas::ast::Assignment &assignment);
   void visit(pas::ast::ProcCall &proc_call);
@@ -70,6 +111,9 @@ public:
 private:
   std::ostream &stream_;
   size_t depth_ = 0;
+  std::vector<ScheduledTask> stack_;
+  // Of the node, that is being visited, in order.
+  std::vector<ScheduledTask> children_;
 };
 
 // https://stackoverflow.com/a/25066044
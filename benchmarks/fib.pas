@@ -0,0 +1,23 @@
+program FibBench;
+var
+  n, value: Integer;
+
+function Fib(var n: Integer): Integer;
+var
+  a, b: Integer;
+begin
+  if n < 2 then
+    Fib := n
+  else
+  begin
+    a := n - 1;
+    b := n - 2;
+    Fib := Fib(a) + Fib(b)
+  end
+end;
+
+begin
+  n := 32;
+  value := Fib(n);
+  write_int(value)
+end.
@@ -0,0 +1,29 @@
+program MatMul;
+var
+  a, b, c: array [1..200, 1..200] of Real;
+  n, i, j, k, round: Integer;
+  sum, trace: Real;
+begin
+  n := 200;
+  for i := 1 to n do
+    for j := 1 to n do
+    begin
+      a[i, j] := (i + j) mod 7 / 7.0;
+      b[i, j] := (i * j) mod 11 / 11.0
+    end;
+  trace := 0.0;
+  for round := 1 to 5 do
+  begin
+    for i := 1 to n do
+      for j := 1 to n do
+      begin
+        sum := 0.0;
+        for k := 1 to n do
+          sum := sum + a[i, k] * b[k, j];
+        c[i, j] := sum
+      end;
+    for i := 1 to n do
+      trace := trace + c[i, i]
+  end;
+  write_real(trace)
+end.
@@ -0,0 +1,125 @@
+program NBody;
+type
+  Body = record
+    x, y, z, vx, vy, vz, mass: Real
+  end;
+var
+  bodies: array [1..5] of Body;
+  pi, solarMass, daysPerYear, dt, px, py, pz, before: Real;
+  i, step: Integer;
+
+procedure Advance;
+var
+  i, j: Integer;
+  dx, dy, dz, d2, mag: Real;
+begin
+  for i := 1 to 5 do
+    for j := i + 1 to 5 do
+    begin
+      dx := bodies[i].x - bodies[j].x;
+      dy := bodies[i].y - bodies[j].y;
+      dz := bodies[i].z - bodies[j].z;
+      d2 := dx * dx + dy * dy + dz * dz;
+      mag := dt / (d2 * sqrt(d2));
+      bodies[i].vx := bodies[i].vx - dx * bodies[j].mass * mag;
+      bodies[i].vy := bodies[i].vy - dy * bodies[j].mass * mag;
+      bodies[i].vz := bodies[i].vz - dz * bodies[j].mass * mag;
+      bodies[j].vx := bodies[j].vx + dx * bodies[i].mass * mag;
+      bodies[j].vy := bodies[j].vy + dy * bodies[i].mass * mag;
+      bodies[j].vz := bodies[j].vz + dz * bodies[i].mass * mag
+    end;
+  for i := 1 to 5 do
+  begin
+    bodies[i].x := bodies[i].x + dt * bodies[i].vx;
+    bodies[i].y := bodies[i].y + dt * bodies[i].vy;
+    bodies[i].z := bodies[i].z + dt * bodies[i].vz
+  end
+end;
+
+function Energy: Real;
+var
+  i, j: Integer;
+  e, dx, dy, dz: Real;
+begin
+  e := 0.0;
+  for i := 1 to 5 do
+  begin
+    e := e + 0.5 * bodies[i].mass * (bodies[i].vx * bodies[i].vx +
+      bodies[i].vy * bodies[i].vy + bodies[i].vz * bodies[i].vz);
+    for j := i + 1 to 5 do
+    begin
+      dx := bodies[i].x - bodies[j].x;
+      dy := bodies[i].y - bodies[j].y;
+      dz := bodies[i].z - bodies[j].z;
+      e := e - bodies[i].mass * bodies[j].mass / sqrt(dx * dx + dy * dy + dz * dz)
+    end
+  end;
+  Energy := e
+end;
+
+begin
+  pi := 3.141592653589793;
+  solarMass := 4.0 * pi * pi;
+  daysPerYear := 365.24;
+  dt := 0.01;
+
+  bodies[1].x := 0.0;
+  bodies[1].y := 0.0;
+  bodies[1].z := 0.0;
+  bodies[1].vx := 0.0;
+  bodies[1].vy := 0.0;
+  bodies[1].vz := 0.0;
+  bodies[1].mass := solarMass;
+
+  bodies[2].x := 4.84143144246472090e+00;
+  bodies[2].y := -1.16032004402742839e+00;
+  bodies[2].z := -1.03622044471123109e-01;
+  bodies[2].vx := 1.66007664274403694e-03 * daysPerYear;
+  bodies[2].vy := 7.69901118419740425e-03 * daysPerYear;
+  bodies[2].vz := -6.90460016972063023e-05 * daysPerYear;
+  bodies[2].mass := 9.54791938424326609e-04 * solarMass;
+
+  bodies[3].x := 8.34336671824457987e+00;
+  bodies[3].y := 4.12479856412430479e+00;
+  bodies[3].z := -4.03523417114321381e-01;
+  bodies[3].vx := -2.76742510726862411e-03 * daysPerYear;
+  bodies[3].vy := 4.99852801234917238e-03 * daysPerYear;
+  bodies[3].vz := 2.30417297573763929e-05 * daysPerYear;
+  bodies[3].mass := 2.85885980666130812e-04 * solarMass;
+
+  bodies[4].x := 1.28943695621391310e+01;
+  bodies[4].y := -1.51111514016986312e+01;
+  bodies[4].z := -2.23307578892655734e-01;
+  bodies[4].vx := 2.96460137564761618e-03 * daysPerYear;
+  bodies[4].vy := 2.37847173959480950e-03 * daysPerYear;
+  bodies[4].vz := -2.96589568540237556e-05 * daysPerYear;
+  bodies[4].mass := 4.36624404335156298e-05 * solarMass;
+
+  bodies[5].x := 1.53796971148509165e+01;
+  bodies[5].y := -2.59193146099879641e+01;
+  bodies[5].z := 1.79258772950371181e-01;
+  bodies[5].vx := 2.68067772490389322e-03 * daysPerYear;
+  bodies[5].vy := 1.62824170038242295e-03 * daysPerYear;
+  bodies[5].vz := -9.51592254519715870e-05 * daysPerYear;
+  bodies[5].mass := 5.15138902046611451e-05 * solarMass;
+
+  px := 0.0;
+  py := 0.0;
+  pz := 0.0;
+  for i := 1 to 5 do
+  begin
+    px := px + bodies[i].vx * bodies[i].mass;
+    py := py + bodies[i].vy * bodies[i].mass;
+    pz := pz + bodies[i].vz * bodies[i].mass
+  end;
+  bodies[1].vx := -px / solarMass;
+  bodies[1].vy := -py / solarMass;
+  bodies[1].vz := -pz / solarMass;
+
+  before := Energy();
+  for step := 1 to 1000000 do
+    Advance;
+  write_real(before);
+  write_str(" ");
+  write_real(Energy())
+end.
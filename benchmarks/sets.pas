@@ -0,0 +1,27 @@
+program Sets;
+var
+  a, b, c, d: set of 0..255;
+  i, k, count: Integer;
+begin
+  count := 0;
+  a := [0..127];
+  b := [64..255];
+  for i := 1 to 200000 do
+  begin
+    c := a * b;
+    d := (a + b) - c;
+    if i mod 2 = 0 then
+      a := a + [3, 5, 7, 200..210] - [100..120]
+    else
+      a := a - [3, 5, 7, 200..210] + [100..120];
+    for k := 0 to 255 do
+    begin
+      if k in c then
+        count := count + 1;
+      if k in d then
+        count := count + 2
+    end;
+    count := count mod 1000003
+  end;
+  write_int(count)
+end.
@@ -0,0 +1,26 @@
+program Sieve;
+var
+  flags: array [0..1000000] of Boolean;
+  i, j, count, round, checksum: Integer;
+begin
+  checksum := 0;
+  for round := 1 to 20 do
+  begin
+    for i := 0 to 1000000 do
+      flags[i] := True;
+    count := 0;
+    for i := 2 to 1000000 do
+      if flags[i] then
+      begin
+        count := count + 1;
+        j := i + i;
+        while j <= 1000000 do
+        begin
+          flags[j] := False;
+          j := j + i
+        end
+      end;
+    checksum := checksum + count
+  end;
+  write_int(checksum)
+end.
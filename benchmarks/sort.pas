@@ -0,0 +1,60 @@
+program Sort;
+var
+  a: array [1..200000] of Integer;
+  n, i, seed, round, first, last, checksum: Integer;
+  sorted: Boolean;
+
+procedure QuickSort(var lo, hi: Integer);
+var
+  i, j, pivot, t: Integer;
+begin
+  i := lo;
+  j := hi;
+  pivot := a[(lo + hi) div 2];
+  while i <= j do
+  begin
+    while a[i] < pivot do
+      i := i + 1;
+    while a[j] > pivot do
+      j := j - 1;
+    if i <= j then
+    begin
+      t := a[i];
+      a[i] := a[j];
+      a[j] := t;
+      i := i + 1;
+      j := j - 1
+    end
+  end;
+  if lo < j then
+    QuickSort(lo, j);
+  if i < hi then
+    QuickSort(i, hi)
+end;
+
+begin
+  n := 200000;
+  seed := 42;
+  checksum := 0;
+  sorted := True;
+  for round := 1 to 10 do
+  begin
+    for i := 1 to n do
+    begin
+      seed := (seed * 75 + 74) mod 65537;
+      a[i] := seed
+    end;
+    first := 1;
+    last := n;
+    QuickSort(first, last);
+    for i := 2 to n do
+      if a[i - 1] > a[i] then
+        sorted := False;
+    for i := 1 to n do
+      checksum := (checksum * 31 + a[i]) mod 1000003
+  end;
+  if sorted then
+    write_int(checksum)
+  else
+    write_str("not sorted")
+end.
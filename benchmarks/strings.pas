@@ -0,0 +1,25 @@
+program Strings;
+var
+  s, piece, pair: String;
+  i, round, total: Integer;
+begin
+  total := 0;
+  for round := 1 to 20 do
+  begin
+    s := "";
+    piece := "abc";
+    for i := 1 to 100000 do
+    begin
+      s := s + piece;
+      if i mod 1000 = 0 then
+      begin
+        pair := piece + "-" + piece;
+        piece := pair + "x";
+        if length(piece) > 40 then
+          piece := "abc"
+      end
+    end;
+    total := (total + length(s) + pos("abc-abcx", s)) mod 1000003
+  end;
+  write_int(total)
+end.
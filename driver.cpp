@@ -3,33 +3,44 @@
 #include "parser.hh"
 // #include "sema.hpp"
 #include "ast/visitors/printer.hpp"
+#include "parsing/recursive_descent.hpp"
 
 Driver::Driver()
-    : trace_parsing(false), trace_scanning(false), location_debug(false),
-      scanner(*this), parser(scanner, *this) {
+    : trace_parsing(false), trace_scanning(false), print_ast(false),
+      recursive_descent(false), location_debug(false), scanner(*this),
+      parser(scanner, *this) {
   variables["one"] = 1;
   variables["two"] = 2;
 }
 
 void Driver::set_ast(pas::AST &&ast) { ast_.emplace(std::move(ast)); }
 
-std::optional<pas::AST> Driver::parse(const std::string &f) {
+std::optional<pas::AST> Driver::parse(std::istream &in, const std::string &f) {
   file = f;
 
   // initialize location positions
   location.initialize(&file);
-  scan_begin();
-  parser.set_debug_level(trace_parsing);
-  if (parser() != 0) {
-    std::cerr << "Parsing error!" << std::endl;
-    return {};
+  errors.clear();
+  scan_begin(in);
+  if (recursive_descent) {
+    pas::parsing::RecursiveDescentParser descent_parser(scanner, *this);
+    ast_ = descent_parser.parse();
+    if (!ast_.has_value()) {
+      return {};
+    }
+  } else {
+    parser.set_debug_level(trace_parsing);
+    if (parser() != 0) {
+      return {};
+    }
   }
-  scan_end();
 
   assert(ast_.has_value());
 
-  pas::visitor::Printer printer(std::cerr);
-  printer.visit(ast_.value());
+  if (print_ast) {
+    pas::visitor::Printer printer(std::cerr);
+    printer.visit(ast_.value());
+  }
 
   return std::move(ast_);
 }
@@ -39,16 +50,8 @@ std::optional<pas::AST> Driver::parse(const std::string &f) {
 //   return pas::sema::typecheck(ast_.value());
 // }
 
-void Driver::scan_begin() {
+void Driver::scan_begin(std::istream &in) {
   scanner.set_debug(trace_scanning);
-  if (file.empty() || file == "-") {
-  } else {
-    stream.open(file);
-    std::cerr << "File name is " << file << std::endl;
-
-    // Restart scanner resetting buffer!
-    scanner.yyrestart(&stream);
-  }
+  // Restart scanner resetting buffer!
+  scanner.yyrestart(&in);
 }
-
-void Driver::scan_end() { stream.close(); }
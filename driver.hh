@@ -4,24 +4,33 @@
 #include "parser.hh"
 #include "parsing/scanner.h"
 
-#include <fstream>
+#include <istream>
 #include <map>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 class Driver {
 public:
   Driver();
   std::map<std::string, int> variables;
   int result;
-  std::optional<pas::AST> parse(const std::string &f);
+  // Source text is read from the stream, file name is for the locations.
+  std::optional<pas::AST> parse(std::istream &in, const std::string &f);
   std::string file;
+  // Syntax errors of the last parse.
+  std::vector<std::pair<yy::location, std::string>> errors;
 
-  void scan_begin();
-  void scan_end();
+  void scan_begin(std::istream &in);
 
   bool trace_parsing;
   bool trace_scanning;
+  // The parsed tree is printed to stderr.
+  bool print_ast;
+  // The hand-written parser (parsing/recursive_descent.hpp) instead of the
+  //   Bison one, the trees are the same.
+  bool recursive_descent;
   yy::location location;
 
   friend class Scanner;
@@ -35,5 +44,4 @@ private:
 
 private:
   std::optional<pas::AST> ast_;
-  std::ifstream stream;
 };
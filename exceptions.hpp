@@ -18,8 +18,19 @@ public:
 
   virtual const char *what() const noexcept override { return msg_.c_str(); }
 
+  // Where in the source the problem is, line 0 if it's not known. The
+  //   lowerer sets it to the innermost statement.
+  int line() const { return line_; }
+  int column() const { return column_; }
+  void set_location(int line, int column) {
+    line_ = line;
+    column_ = column;
+  }
+
 private:
   std::string msg_;
+  int line_ = 0;
+  int column_ = 0;
 };
 
 class NotImplementedException : public DescribedException {
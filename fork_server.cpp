@@ -0,0 +1,131 @@
+#include "fork_server.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <stdio_ext.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace pas {
+namespace fork_server {
+
+namespace {
+
+double to_ms(const timeval &time) {
+  return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+}
+
+std::string quote(const std::string &message) {
+  std::string result = "\"";
+  for (char c : message) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + '"';
+}
+
+std::string make_error(const std::string &message) {
+  return "status=error message=" + quote(message);
+}
+
+std::string make_errno_error(const std::string &message) {
+  return make_error(message + ": " + strerror(errno));
+}
+
+// Runs main in a child with the files as stdin and stdout.
+std::string run(MainFunction main_function, const std::string &input_path,
+                const std::string &output_path) {
+  int input_fd = open(input_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (input_fd < 0) {
+    return make_errno_error("can't open " + input_path);
+  }
+  int output_fd = open(output_path.c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (output_fd < 0) {
+    close(input_fd);
+    return make_errno_error("can't create " + output_path);
+  }
+
+  // Buffered output of the server must not be written by the child too.
+  fflush(stdout);
+  fflush(stderr);
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (dup2(input_fd, STDIN_FILENO) < 0 ||
+        dup2(output_fd, STDOUT_FILENO) < 0) {
+      _exit(127);
+    }
+    // Requests, that the server has buffered, are not the input.
+    __fpurge(stdin);
+    int code = main_function();
+    fflush(stdout);
+    _exit(code);
+  }
+  close(input_fd);
+  close(output_fd);
+  if (pid < 0) {
+    return make_errno_error("can't fork");
+  }
+
+  int status = 0;
+  rusage usage = {};
+  while (wait4(pid, &status, 0, &usage) < 0) {
+    if (errno != EINTR) {
+      return make_errno_error("can't wait for the run");
+    }
+  }
+  std::chrono::duration<double, std::milli> wall_time =
+      std::chrono::steady_clock::now() - start;
+
+  std::ostringstream response;
+  response << std::fixed << std::setprecision(2);
+  if (WIFSIGNALED(status)) {
+    response << "status=signaled signal=" << WTERMSIG(status);
+  } else {
+    response << "status=exited code=" << WEXITSTATUS(status);
+  }
+  response << " wall_ms=" << wall_time.count()
+           << " user_ms=" << to_ms(usage.ru_utime)
+           << " sys_ms=" << to_ms(usage.ru_stime)
+           << " max_rss_kb=" << usage.ru_maxrss;
+  return response.str();
+}
+
+} // namespace
+
+int serve(MainFunction main_function, std::istream &requests,
+          std::ostream &responses) {
+  std::string line;
+  while (std::getline(requests, line)) {
+    std::istringstream fields(line);
+    std::string input_path;
+    std::string output_path;
+    std::string extra;
+    if (!(fields >> input_path)) {
+      // Blank lines are skipped.
+      continue;
+    }
+    if (!(fields >> output_path) || fields >> extra) {
+      responses << make_error("expected \"<input path> <output path>\"")
+                << std::endl;
+      continue;
+    }
+    // Flushed, the client waits for the response before the next request.
+    responses << run(main_function, input_path, output_path) << std::endl;
+  }
+  return 0;
+}
+
+} // namespace fork_server
+} // namespace pas
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+// Fork server (-fork-server): the program is compiled once, then run for
+//   many inputs, each run in a child forked from the compiler, so that it
+//   pays neither the startup nor the compilation. Requests are lines
+//     <input path> <output path>
+//   the child reads stdin from the input file and writes stdout to the
+//   output file, stderr is shared. For every request there is a line
+//     status=exited code=0 wall_ms=1.25 user_ms=0.80 sys_ms=0.31 max_rss_kb=5120
+//   status=signaled has signal=<number> instead of the code, status=error
+//   has message="..." and no usage, if the run couldn't be started. Max
+//   RSS counts the pages, that the child shares with the server, too.
+
+namespace pas {
+namespace fork_server {
+
+using MainFunction = int (*)();
+
+// Serves the requests until the end of them, returns the exit code of the
+//   server. Nothing must have started threads in this process before.
+int serve(MainFunction main_function, std::istream &requests,
+          std::ostream &responses);
+
+} // namespace fork_server
+} // namespace pas
@@ -0,0 +1,388 @@
+#include "libpascal.hpp"
+
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Config/llvm-config.h"
+#if LLVM_VERSION_MAJOR >= 17
+#include "llvm/TargetParser/Host.h"
+#else
+#include "llvm/Support/Host.h"
+#endif
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "driver.hh"
+#include "exceptions.hpp"
+#include "stdlib.hpp"
+
+namespace pas {
+
+namespace {
+
+// Creates target machine for the host, it provides the cost model
+//   for the optimizations (vector register width and etc.).
+std::unique_ptr<llvm::TargetMachine>
+create_host_target_machine(std::string &error) {
+  std::string triple = llvm::sys::getProcessTriple();
+  const llvm::Target *target =
+      llvm::TargetRegistry::lookupTarget(triple, error);
+  if (target == nullptr) {
+    error = "failed to find target " + triple + ": " + error;
+    return nullptr;
+  }
+
+  std::string features;
+  llvm::StringMap<bool> host_features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    for (auto &feature : host_features) {
+      if (!features.empty()) {
+        features += ',';
+      }
+      features += (feature.second ? "+" : "-") + feature.first().str();
+    }
+  }
+
+  return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+      triple, llvm::sys::getHostCPUName(), features,
+      llvm::TargetOptions(), llvm::Reloc::PIC_));
+}
+
+// Runs the standard optimization pipeline, the same as clang -O<level>.
+void optimize_module(llvm::Module &module,
+                     llvm::TargetMachine *target_machine,
+                     llvm::OptimizationLevel level) {
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+
+  llvm::PassBuilder pass_builder(target_machine);
+  pass_builder.registerModuleAnalyses(mam);
+  pass_builder.registerCGSCCAnalyses(cgam);
+  pass_builder.registerFunctionAnalyses(fam);
+  pass_builder.registerLoopAnalyses(lam);
+  pass_builder.crossRegisterProxies(lam, fam, cgam, mam);
+
+  llvm::ModulePassManager mpm =
+      level == llvm::OptimizationLevel::O0
+          ? pass_builder.buildO0DefaultPipeline(level)
+          : pass_builder.buildPerModuleDefaultPipeline(level);
+  mpm.run(module, mam);
+}
+
+// Target and the runtime symbols are registered once for the process.
+void initialize_jit() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    visitor::Lowerer::initialize_for_native_target();
+    stdlib::register_symbols();
+  });
+}
+
+// Takes the stats of each phase at its end.
+class PhaseRecorder {
+public:
+  PhaseRecorder(CompileStats *stats, const CompileOptions &options)
+      : stats_(stats), count_allocations_(options.count_allocations) {
+    start();
+  }
+
+  void end(const char *name, const llvm::Module *module) {
+    if (stats_ == nullptr) {
+      return;
+    }
+    PhaseStats phase;
+    phase.name = name;
+    phase.wall_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start_time_)
+                        .count();
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    phase.peak_rss_kb = usage.ru_maxrss;
+    if (count_allocations_) {
+      AllocationCounts counts = count_allocations_();
+      phase.allocations = counts.allocations - start_counts_.allocations;
+      phase.allocated_bytes = counts.bytes - start_counts_.bytes;
+      phase.live_bytes = counts.live_bytes;
+      phase.peak_live_bytes = counts.peak_live_bytes;
+    }
+    if (module != nullptr) {
+      for (const llvm::Function &function : *module) {
+        if (function.isDeclaration()) {
+          continue;
+        }
+        phase.functions += 1;
+        phase.basic_blocks += function.size();
+        phase.instructions += function.getInstructionCount();
+      }
+    }
+    stats_->phases.push_back(std::move(phase));
+    start();
+  }
+
+private:
+  void start() {
+    if (stats_ == nullptr) {
+      return;
+    }
+    start_time_ = std::chrono::steady_clock::now();
+    if (count_allocations_) {
+      start_counts_ = count_allocations_();
+    }
+  }
+
+  CompileStats *stats_;
+  const std::function<AllocationCounts()> &count_allocations_;
+  std::chrono::steady_clock::time_point start_time_;
+  AllocationCounts start_counts_;
+};
+
+// The runtime is shared by the process, so is the host of it.
+std::mutex run_mutex;
+
+struct RunState {
+  std::thread::id thread;
+  std::mutex output_mutex;
+  std::string *output = nullptr;
+  int exit_code = 0;
+  std::string message;
+  std::jmp_buf stop_jump;
+};
+
+void write_output(void *context, const char *data, size_t size) {
+  auto *state = static_cast<RunState *>(context);
+  // Parallel loops and tasks write too.
+  std::lock_guard lock(state->output_mutex);
+  state->output->append(data, size);
+}
+
+void stop_run(void *context, int exit_code, const char *message) {
+  auto *state = static_cast<RunState *>(context);
+  if (std::this_thread::get_id() != state->thread) {
+    // Frames of the run are on another stack, there is nowhere to return.
+    fprintf(stderr, "%s\n", message);
+    fflush(stderr);
+    abort();
+  }
+  state->exit_code = exit_code;
+  state->message = message;
+  // Frames of the program are JIT-compiled without unwind tables, so
+  //   there is no exception through them.
+  std::longjmp(state->stop_jump, 1);
+}
+
+} // namespace
+
+Program::~Program() = default;
+
+RunResult Program::run(std::string_view input, std::string &output) const {
+  std::lock_guard lock(run_mutex);
+  // On the heap, it is changed between setjmp and longjmp.
+  auto state = std::make_unique<RunState>();
+  state->thread = std::this_thread::get_id();
+  state->output = &output;
+  pas_host host = {state.get(), write_output, stop_run};
+  pas_file_set_input(input.data(), input.size());
+  pas_host_set(&host);
+
+  RunResult result;
+  if (setjmp(state->stop_jump) == 0) {
+    result.exit_code = main_();
+  } else {
+    result.exit_code = state->exit_code;
+    result.message = std::move(state->message);
+  }
+
+  pas_host_set(nullptr);
+  pas_file_set_input(nullptr, 0);
+  return result;
+}
+
+CompileResult compile(std::string_view source, const std::string &file_name,
+                      const CompileOptions &options) {
+  CompileResult result;
+  CompileStats *stats =
+      options.collect_stats ? &result.stats.emplace() : nullptr;
+  PhaseRecorder recorder(stats, options);
+  auto add_diagnostic = [&](int line, int column, std::string message) {
+    result.diagnostics.push_back(
+        Diagnostic{file_name, line, column, std::move(message)});
+  };
+
+  Driver driver;
+  driver.trace_parsing = options.trace_parsing;
+  driver.trace_scanning = options.trace_scanning;
+  driver.location_debug = options.location_debug;
+  driver.print_ast = options.print_ast;
+  driver.recursive_descent = options.recursive_descent_parser;
+  std::istringstream in{std::string(source)};
+  std::optional<AST> ast = driver.parse(in, file_name);
+  if (stats != nullptr && ast.has_value()) {
+    stats->ast = visitor::count_ast_memory(ast.value());
+  }
+  recorder.end("parse", nullptr);
+  if (!ast.has_value()) {
+    for (const auto &[location, message] : driver.errors) {
+      add_diagnostic(location.begin.line, location.begin.column, message);
+    }
+    if (result.diagnostics.empty()) {
+      add_diagnostic(0, 0, "parsing failed");
+    }
+    return result;
+  }
+  if (options.syntax_only) {
+    return result;
+  }
+
+  std::unique_ptr<Program> program(new Program());
+  program->context_ = std::make_unique<llvm::LLVMContext>();
+  llvm::LLVMContext &context = *program->context_;
+  visitor::LowererOptions lowerer_options = options.lowerer;
+  std::optional<remarks::Collector> remarks;
+  if (options.collect_remarks) {
+    remarks.emplace(context, options.remarks_pass_filter);
+    // Lines of the remarks come from the debug info.
+    lowerer_options.debug_info = true;
+    // Counts of executions from the profile.
+    context.setDiagnosticsHotnessRequested(lowerer_options.profile !=
+                                           nullptr);
+  }
+
+  std::unique_ptr<llvm::Module> llvm_module;
+  try {
+    visitor::Lowerer lowerer(context, file_name, ast.value(),
+                             lowerer_options);
+    llvm_module = lowerer.release_module();
+    if (stats != nullptr) {
+      stats->scopes = lowerer.get_scope_stats();
+    }
+  } catch (const DescribedException &exc) {
+    add_diagnostic(exc.line(), exc.column(), exc.what());
+    return result;
+  }
+  recorder.end("lower", llvm_module.get());
+
+  initialize_jit();
+  if (options.opt_level.has_value()) {
+    std::string error;
+    std::unique_ptr<llvm::TargetMachine> target_machine =
+        create_host_target_machine(error);
+    if (target_machine == nullptr) {
+      add_diagnostic(0, 0, error);
+      return result;
+    }
+    llvm_module->setTargetTriple(target_machine->getTargetTriple().str());
+    llvm_module->setDataLayout(target_machine->createDataLayout());
+    optimize_module(*llvm_module, target_machine.get(),
+                    options.opt_level.value());
+    recorder.end("optimize", llvm_module.get());
+  }
+
+  if (options.keep_ir) {
+    llvm::raw_string_ostream os(program->ir_);
+    llvm_module->print(os, nullptr);
+    os.flush();
+  }
+
+  // JIT-compile to the native code, the runtime library is called
+  //   directly.
+  std::string error;
+  // The engine owns the module, it stays alive.
+  const llvm::Module *jit_module = llvm_module.get();
+  program->engine_.reset(llvm::EngineBuilder(std::move(llvm_module))
+                             .setEngineKind(llvm::EngineKind::JIT)
+                             .setErrorStr(&error)
+                             .create());
+  if (program->engine_ == nullptr) {
+    add_diagnostic(0, 0, "failed to create JIT: " + error);
+    return result;
+  }
+  if (options.register_jit_listeners) {
+    // Perf support is there, only if LLVM is built with it.
+    program->engine_->RegisterJITEventListener(
+        llvm::JITEventListener::createGDBRegistrationListener());
+    if (llvm::JITEventListener *perf_listener =
+            llvm::JITEventListener::createPerfJITEventListener()) {
+      program->engine_->RegisterJITEventListener(perf_listener);
+    }
+  }
+  program->engine_->finalizeObject();
+  recorder.end("jit", jit_module);
+  // Code generation reports too, so remarks are complete only here.
+  if (remarks.has_value()) {
+    program->remarks_ = remarks->remarks();
+  }
+  program->main_ = reinterpret_cast<Program::MainFunction>(
+      program->engine_->getFunctionAddress("main"));
+
+  result.program = std::move(program);
+  return result;
+}
+
+void print_compile_stats(const CompileStats &stats, std::ostream &out) {
+  auto kib = [](uint64_t bytes) { return bytes / 1024.0; };
+  std::ios_base::fmtflags flags = out.flags();
+  out << std::fixed << std::setprecision(1);
+
+  out << std::left << std::setw(10) << "phase" << std::right
+      << std::setw(10) << "time, ms" << std::setw(14) << "peak RSS, KiB"
+      << std::setw(13) << "allocations" << std::setw(16) << "allocated, KiB"
+      << std::setw(11) << "live, KiB" << std::setw(16) << "peak live, KiB"
+      << std::setw(11) << "functions" << std::setw(8) << "blocks"
+      << std::setw(14) << "instructions" << '\n';
+  for (const PhaseStats &phase : stats.phases) {
+    out << std::left << std::setw(10) << phase.name << std::right
+        << std::setw(10) << phase.wall_ms << std::setw(14)
+        << phase.peak_rss_kb << std::setw(13) << phase.allocations
+        << std::setw(16) << kib(phase.allocated_bytes) << std::setw(11)
+        << kib(phase.live_bytes) << std::setw(16)
+        << kib(phase.peak_live_bytes) << std::setw(11) << phase.functions
+        << std::setw(8) << phase.basic_blocks << std::setw(14)
+        << phase.instructions << '\n';
+  }
+
+  out << '\n'
+      << std::left << std::setw(12) << "AST" << std::right << std::setw(10)
+      << "nodes" << std::setw(12) << "KiB" << '\n';
+  visitor::AstCategoryStats total;
+  for (size_t i = 0; i < visitor::kNumAstCategories; ++i) {
+    auto category = static_cast<visitor::AstCategory>(i);
+    const visitor::AstCategoryStats &item = stats.ast[category];
+    out << std::left << std::setw(12)
+        << visitor::get_ast_category_name(category) << std::right
+        << std::setw(10) << item.nodes << std::setw(12) << kib(item.bytes)
+        << '\n';
+    total.nodes += item.nodes;
+    total.bytes += item.bytes;
+  }
+  out << std::left << std::setw(12) << "total" << std::right << std::setw(10)
+      << total.nodes << std::setw(12) << kib(total.bytes) << '\n';
+
+  out << "\nsizeof of the AST types:";
+  for (const auto &[name, size] : visitor::get_ast_type_sizes()) {
+    out << ' ' << name << '=' << size;
+  }
+  out << '\n';
+
+  const visitor::Lowerer::ScopeStats &scopes = stats.scopes;
+  out << "\nsymbol tables: " << scopes.scopes << " scopes, depth "
+      << scopes.max_depth << " at most, " << scopes.symbols << " symbols, "
+      << scopes.max_visible_symbols << " visible at most, "
+      << kib(scopes.max_bytes) << " KiB at most\n";
+  out.flags(flags);
+}
+
+} // namespace pas
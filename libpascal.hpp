@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Passes/OptimizationLevel.h"
+
+#include "ast/visitors/ast_stats.hpp"
+#include "ast/visitors/lowerer.hpp"
+#include "remarks.hpp"
+
+// The compiler as a library (libpascal): source text in memory is compiled
+//   to a program in this process, errors are returned as diagnostics and
+//   the program reads its input from and writes its output to buffers of
+//   the caller. The compiler executable is a client of it too.
+
+namespace pas {
+
+// Of operator new since the start of the process.
+struct AllocationCounts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+  // Allocated and not freed yet, now and at most.
+  uint64_t live_bytes = 0;
+  uint64_t peak_live_bytes = 0;
+};
+
+struct CompileOptions {
+  visitor::LowererOptions lowerer;
+  // Standard pipeline of the level, the IR is JIT-compiled as lowered
+  //   without one.
+  std::optional<llvm::OptimizationLevel> opt_level;
+  // Program::get_ir() is the optimized IR, empty otherwise.
+  bool keep_ir = false;
+  // Program::get_remarks() are the optimization remarks of the passes,
+  //   that match the filter, see remarks.hpp.
+  bool collect_remarks = false;
+  std::optional<std::regex> remarks_pass_filter;
+  // gdb and perf learn about the JIT-compiled code, needs debug info to
+  //   show Pascal lines.
+  bool register_jit_listeners = false;
+  // Memory and time of the phases, sizes of the AST and of the symbol
+  //   tables in CompileResult::stats (-fmem-report).
+  bool collect_stats = false;
+  // Counts of the allocations, if the application keeps them, e.g. the
+  //   compiler executable replaces operator new.
+  std::function<AllocationCounts()> count_allocations;
+  // The hand-written parser (parsing/recursive_descent.hpp) instead of the
+  //   Bison one.
+  bool recursive_descent_parser = false;
+  // Compilation stops after parsing, CompileResult::program is null then.
+  bool syntax_only = false;
+  // Debugging of the frontend, to stderr.
+  bool trace_parsing = false;
+  bool trace_scanning = false;
+  bool location_debug = false;
+  bool print_ast = false;
+};
+
+struct Diagnostic {
+  std::string file;
+  // Zeros, if the place is unknown.
+  int line = 0;
+  int column = 0;
+  std::string message;
+};
+
+struct RunResult {
+  // Of main, kBudgetExitCode (stdlib/budget.hpp) or kFailureExitCode
+  //   (stdlib/host.hpp), if the program was stopped.
+  int exit_code = 0;
+  // Why the program was stopped, empty, if it has finished.
+  std::string message;
+};
+
+struct CompileResult;
+
+struct PhaseStats {
+  // "parse", "lower", "optimize" or "jit".
+  std::string name;
+  double wall_ms = 0;
+  // Of the process at the end of the phase.
+  uint64_t peak_rss_kb = 0;
+  // Made during the phase, zeros, unless counted.
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t live_bytes = 0;
+  uint64_t peak_live_bytes = 0;
+  // Of the module at the end of the phase, zeros before lowering.
+  uint64_t functions = 0;
+  uint64_t basic_blocks = 0;
+  uint64_t instructions = 0;
+};
+
+struct CompileStats {
+  // Phases, that have finished, compilation stops at an error.
+  std::vector<PhaseStats> phases;
+  visitor::AstStats ast;
+  visitor::Lowerer::ScopeStats scopes;
+};
+
+void print_compile_stats(const CompileStats &stats, std::ostream &out);
+
+class Program {
+public:
+  using MainFunction = int (*)();
+
+  ~Program();
+
+  Program(const Program &) = delete;
+  Program &operator=(const Program &) = delete;
+
+  const std::string &get_ir() const { return ir_; }
+  const std::vector<remarks::Remark> &get_remarks() const { return remarks_; }
+
+  // The program itself, it reads stdin and writes stdout of the process.
+  MainFunction get_main() const { return main_; }
+
+  // Runs the program with the input, the output is appended. Runs are
+  //   serialized, the runtime is shared by the process. A stop (runtime
+  //   error, budget) returns here, but only from the thread of the run:
+  //   in threads of parallel loops and tasks it still ends the process.
+  //   Memory and files of a stopped program are not released.
+  RunResult run(std::string_view input, std::string &output) const;
+
+private:
+  Program() = default;
+
+  friend CompileResult compile(std::string_view source,
+                               const std::string &file_name,
+                               const CompileOptions &options);
+
+  // The engine refers to the context, so it is destroyed first.
+  std::unique_ptr<llvm::LLVMContext> context_;
+  std::unique_ptr<llvm::ExecutionEngine> engine_;
+  MainFunction main_ = nullptr;
+  std::string ir_;
+  std::vector<remarks::Remark> remarks_;
+};
+
+struct CompileResult {
+  // Null, if there are errors.
+  std::unique_ptr<Program> program;
+  std::vector<Diagnostic> diagnostics;
+  // With CompileOptions::collect_stats, even if there are errors.
+  std::optional<CompileStats> stats;
+};
+
+// File name is for the diagnostics and the debug info only.
+CompileResult compile(std::string_view source, const std::string &file_name,
+                      const CompileOptions &options = CompileOptions());
+
+} // namespace pas
@@ -1,28 +1,83 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <regex>
+#include <sstream>
 #include <string>
 
-#include "llvm/ExecutionEngine/ExecutionEngine.h"
-#include "llvm/ExecutionEngine/GenericValue.h"
-#include "llvm/IR/LLVMContext.h"
+#include "allocation_counter.hpp"
+#include "fork_server.hpp"
+#include "libpascal.hpp"
+#include "remarks.hpp"
 
-#include "ast/visitors/lowerer.hpp"
-#include "driver.hh"
+// Profile of -fprofile-generate and -fprofile-use without a path.
+static const char *const kDefaultProfilePath = "default.pasprof";
 
-int main(int argc, char **argv) {
-  int result = 0;
-  Driver driver;
+// Remarks are printed to stderr, unless -fopt-remarks=<path> is given. A
+//   ".json" file gets JSON, any other one gets YAML.
+struct RemarksOptions {
+  std::optional<std::string> output_path;
+  std::optional<std::regex> pass_filter;
+};
+
+static bool write_remarks(const std::vector<pas::remarks::Remark> &remarks,
+                          const RemarksOptions &options) {
+  if (!options.output_path.has_value()) {
+    pas::remarks::print_remarks(remarks, std::cerr);
+    return true;
+  }
+  const std::string &path = options.output_path.value();
+  std::ofstream out(path);
+  if (path.ends_with(".json")) {
+    pas::remarks::write_remarks_json(remarks, out);
+  } else {
+    pas::remarks::write_remarks_yaml(remarks, out);
+  }
+  if (!out) {
+    std::cerr << "Failed to write remarks to \"" << path << "\"."
+              << std::endl;
+    return false;
+  }
+  return true;
+}
 
+// "-" is stdin.
+static bool read_source(const std::string &path, std::string &source) {
+  if (path == "-") {
+    source.assign(std::istreambuf_iterator<char>(std::cin),
+                  std::istreambuf_iterator<char>());
+    return true;
+  }
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  source = text.str();
+  return true;
+}
+
+int main(int argc, char **argv) {
   std::string output_path;
+  pas::CompileOptions compile_options;
+  compile_options.print_ast = true;
+  pas::visitor::LowererOptions &lowerer_options = compile_options.lowerer;
+  std::optional<pas::profile::Profile> profile;
+  std::optional<RemarksOptions> remarks_options;
+  bool is_fork_server = false;
 
   try {
     for (int i = 1; i < argc; ++i) {
       if (argv[i] == std::string("-p")) {
-        driver.trace_parsing = true;
+        compile_options.trace_parsing = true;
       } else if (argv[i] == std::string("-s")) {
-        driver.trace_scanning = true;
+        compile_options.trace_scanning = true;
       } else if (argv[i] == std::string("-l")) {
-        driver.location_debug = true;
+        compile_options.location_debug = true;
       } else if (argv[i] == std::string("-o")) {
         i += 1;
         if (i == argc) {
@@ -30,32 +85,139 @@ int main(int argc, char **argv) {
           return 1;
         }
         output_path = std::string(argv[i]);
+      } else if (argv[i] == std::string("-fork-server")) {
+        is_fork_server = true;
+      } else if (argv[i] == std::string("-g")) {
+        lowerer_options.debug_info = true;
+        compile_options.register_jit_listeners = true;
+      } else if (argv[i] == std::string("-fmem-report")) {
+        compile_options.collect_stats = true;
+        compile_options.count_allocations =
+            pas::allocation_counter::get_counts;
+      } else if (argv[i] == std::string("-fopt-remarks")) {
+        remarks_options = remarks_options.value_or(RemarksOptions());
+      } else if (std::string(argv[i]).starts_with("-fopt-remarks-filter=")) {
+        remarks_options = remarks_options.value_or(RemarksOptions());
+        try {
+          remarks_options->pass_filter = std::regex(
+              std::string(argv[i]).substr(strlen("-fopt-remarks-filter=")));
+        } catch (const std::regex_error &error) {
+          std::cerr << "Invalid regular expression in " << argv[i] << ": "
+                    << error.what() << std::endl;
+          return 1;
+        }
+      } else if (std::string(argv[i]).starts_with("-fopt-remarks=")) {
+        remarks_options = remarks_options.value_or(RemarksOptions());
+        remarks_options->output_path =
+            std::string(argv[i]).substr(strlen("-fopt-remarks="));
+      } else if (argv[i] == std::string("-fparser=bison")) {
+        compile_options.recursive_descent_parser = false;
+      } else if (argv[i] == std::string("-fparser=descent")) {
+        compile_options.recursive_descent_parser = true;
+      } else if (std::string(argv[i]).starts_with("-fparser=")) {
+        std::cerr << "Expected bison or descent in " << argv[i] << "."
+                  << std::endl;
+        return 1;
+      } else if (argv[i] == std::string("-fsyntax-only")) {
+        compile_options.syntax_only = true;
+      } else if (argv[i] == std::string("-fno-print-ast")) {
+        compile_options.print_ast = false;
+      } else if (argv[i] == std::string("-ffast-math")) {
+        lowerer_options.fast_math = true;
+      } else if (argv[i] == std::string("-fprofile-generate")) {
+        lowerer_options.profile_generate_path = kDefaultProfilePath;
+      } else if (std::string(argv[i]).starts_with("-fprofile-generate=")) {
+        lowerer_options.profile_generate_path =
+            std::string(argv[i]).substr(strlen("-fprofile-generate="));
+      } else if (argv[i] == std::string("-fprofile-use") ||
+                 std::string(argv[i]).starts_with("-fprofile-use=")) {
+        std::string path = argv[i] == std::string("-fprofile-use")
+                               ? kDefaultProfilePath
+                               : std::string(argv[i]).substr(
+                                     strlen("-fprofile-use="));
+        std::string error;
+        profile = pas::profile::read_profile(path, error);
+        if (!profile.has_value()) {
+          std::cerr << "Failed to read profile \"" << path << "\": " << error
+                    << std::endl;
+          return 1;
+        }
+        lowerer_options.profile = &profile.value();
+      } else if (std::string(argv[i]).starts_with("-fbudget=")) {
+        const char *ticks = argv[i] + strlen("-fbudget=");
+        char *end = nullptr;
+        lowerer_options.budget_ticks = strtoull(ticks, &end, 10);
+        if (*ticks == '\0' || *end != '\0' ||
+            lowerer_options.budget_ticks == 0) {
+          std::cerr << "Expected a positive number of ticks in " << argv[i]
+                    << "." << std::endl;
+          return 1;
+        }
+      } else if (std::string(argv[i]).starts_with("-ftime-limit=")) {
+        const char *seconds = argv[i] + strlen("-ftime-limit=");
+        char *end = nullptr;
+        double limit = strtod(seconds, &end);
+        if (*seconds == '\0' || *end != '\0' || !(limit > 0)) {
+          std::cerr << "Expected a positive number of seconds in " << argv[i]
+                    << "." << std::endl;
+          return 1;
+        }
+        lowerer_options.time_limit_ms = static_cast<uint64_t>(
+            std::clamp(limit * 1000, 1.0, 1e15));
+      } else if (argv[i] == std::string("-O0")) {
+        compile_options.opt_level = llvm::OptimizationLevel::O0;
+      } else if (argv[i] == std::string("-O1")) {
+        compile_options.opt_level = llvm::OptimizationLevel::O1;
+      } else if (argv[i] == std::string("-O2")) {
+        compile_options.opt_level = llvm::OptimizationLevel::O2;
+      } else if (argv[i] == std::string("-O3")) {
+        compile_options.opt_level = llvm::OptimizationLevel::O3;
       } else {
-        std::optional<pas::AST> ast = driver.parse(argv[i]);
-        if (!ast.has_value()) {
-          std::cerr << "Parsing failed for \"" << argv[i] << "\"." << std::endl;
+        std::string source;
+        if (!read_source(argv[i], source)) {
+          std::cerr << "Failed to read \"" << argv[i] << "\"." << std::endl;
           return 2;
         }
+        if (remarks_options.has_value()) {
+          compile_options.collect_remarks = true;
+          compile_options.remarks_pass_filter = remarks_options->pass_filter;
+        }
+        // Dump LLVM IR, stdout is for the responses of the fork server.
+        compile_options.keep_ir = !is_fork_server;
 
-        llvm::LLVMContext context;
-        pas::visitor::Lowerer lowerer(context, argv[i], ast.value());
-        std::unique_ptr<llvm::Module> llvm_module = lowerer.release_module();
-
-        // Dump LLVM IR
-        std::string s;
-        llvm::raw_string_ostream os(s);
-        llvm_module->print(os, nullptr);
-        os.flush();
-        std::cout << s;
+        pas::CompileResult compiled =
+            pas::compile(source, argv[i], compile_options);
+        if (compiled.stats.has_value()) {
+          pas::print_compile_stats(compiled.stats.value(), std::cerr);
+        }
+        for (const pas::Diagnostic &diagnostic : compiled.diagnostics) {
+          std::cerr << diagnostic.file << ":";
+          if (diagnostic.line != 0) {
+            std::cerr << diagnostic.line << ":" << diagnostic.column << ":";
+          }
+          std::cerr << " " << diagnostic.message << std::endl;
+        }
+        if (compile_options.syntax_only) {
+          return compiled.diagnostics.empty() ? 0 : 2;
+        }
+        if (compiled.program == nullptr) {
+          std::cerr << "Compilation failed for \"" << argv[i] << "\"."
+                    << std::endl;
+          return 2;
+        }
+        const pas::Program &program = *compiled.program;
 
-        // Interpreter of LLVM IR
+        if (remarks_options.has_value() &&
+            !write_remarks(program.get_remarks(), remarks_options.value())) {
+          return 1;
+        }
+        if (is_fork_server) {
+          return pas::fork_server::serve(program.get_main(), std::cin,
+                                         std::cout);
+        }
+        std::cout << program.get_ir();
         std::cout << "Running code...\n";
-        llvm::Function *main_func = llvm_module->getFunction("main");
-        llvm::ExecutionEngine *ee =
-            llvm::EngineBuilder(std::move(llvm_module)).create();
-        ee->finalizeObject();
-        std::vector<llvm::GenericValue> noargs;
-        llvm::GenericValue v = ee->runFunction(main_func, noargs);
+        program.get_main()();
         std::cout << "Code was run.\n";
 
         break;
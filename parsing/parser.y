@@ -32,6 +32,12 @@
         return scanner.ScanToken();
     }
 
+    /* AST keeps only the start of the node, as line and column. */
+    static pas::ast::SourceLoc make_source_loc(const yy::location &loc) {
+        return pas::ast::SourceLoc{static_cast<int>(loc.begin.line),
+                                   static_cast<int>(loc.begin.column)};
+    }
+
 		/* iostream output function for std::pair */
     template <typename T, typename U>
     static std::ostream& print_token(std::ostream& stream, const std::pair<T, U>& pair) {
@@ -80,6 +86,8 @@
     LBRACKET  "["
     RBRACKET  "]"
     DOT       "."
+    DOTDOT    ".."
+    CARET     "^"
     COMMA     ","
     COLON     ":"
     SEMICOLON ";"
@@ -87,6 +95,7 @@
     ARRAY     "array"
     BEGIN     "begin"
     CASE      "case"
+    CHANNEL   "channel"
     CONST     "const"
     DO        "do"
     DOWNTO    "downto"
@@ -98,11 +107,14 @@
     NIL       "nil"
     OF        "of"
     PACKED    "packed"
+    PARALLEL  "parallel"
     PROCEDURE "procedure"
     PROGRAM   "program"
     RECORD    "record"
+    REDUCE    "reduce"
     REPEAT    "repeat"
     SET       "set"
+    TASK      "task"
     THEN      "then"
     ELSE      "else"
     TO        "to"
@@ -126,12 +138,14 @@
 // String constant
 %token <std::string>               string "string"
 %token <int>                       number "number"
+%token <double>                    real "real"
 %token <std::pair<char, char>>     CharSubrange   // 'a..z', no multibyte for now (and wide chars).
 %token <char>                      CharacterConst // 'a', no multibyte characters for now.
 
 %nterm <pas::ast::CompilationUnit>              CompilationUnit
 %nterm <pas::ast::ProgramModule>                ProgramModule
 %nterm <std::vector<std::string>>               IdentList
+%nterm <std::vector<std::string>>               ReductionListOpt
 %nterm <pas::ast::Block>                        Block
 %nterm <pas::ast::Declarations>                 Declarations
 %nterm <std::vector<pas::ast::ConstDef>>        ConstantDefBlockOpt
@@ -157,6 +171,9 @@
 %nterm <pas::ast::RecordType>                   RecordType
 %nterm <pas::ast::SetType>                      SetType
 %nterm <pas::ast::PointerType>                  PointerType
+%nterm <pas::ast::FileType>                     FileType
+%nterm <pas::ast::TaskType>                     TaskType
+%nterm <pas::ast::ChannelType>                  ChannelType
 %nterm <std::vector<pas::ast::FieldList>>       FieldListSequence
 %nterm <pas::ast::FieldList>                    FieldList
 %nterm <std::vector<pas::ast::Stmt>>            StatementList
@@ -169,7 +186,7 @@
 %nterm <pas::ast::CaseStmt>                     CaseStatement
 %nterm <std::vector<pas::ast::Case>>            CaseList
 %nterm <pas::ast::Case>                         Case
-%nterm <std::vector<pas::ast::ConstExpr>>       CaseLabelList
+%nterm <std::vector<pas::ast::Element>>         CaseLabelList
 %nterm <pas::ast::WhileStmt>                    WhileStatement
 %nterm <pas::ast::RepeatStmt>                   RepeatStatement
 %nterm <pas::ast::ForStmt>                      ForStatement
@@ -242,6 +259,7 @@ CompilationUnit:      ProgramModule EOF {
                       };
 ProgramModule:        PROGRAM identifier ProgramParametersOpt ";" Block "." {
                           $$ = pas::ast::ProgramModule(std::move($2), std::move($5));
+                          $$.loc_ = make_source_loc(@$);
                       };
 ProgramParametersOpt: ProgramParameters | %empty;
 ProgramParameters:    "(" IdentList ")";
@@ -386,8 +404,21 @@ Type:                 identifier {
 |                     RecordType {
                           $$ = std::make_unique<pas::ast::RecordType>(std::move($1));
                       }
+|                     PACKED RecordType {
+                          $2.packed_ = true;
+                          $$ = std::make_unique<pas::ast::RecordType>(std::move($2));
+                      }
 |                     SetType {
                           $$ = std::make_unique<pas::ast::SetType>(std::move($1));
+                      }
+|                     FileType {
+                          $$ = std::make_unique<pas::ast::FileType>(std::move($1));
+                      }
+|                     TaskType {
+                          $$ = std::make_unique<pas::ast::TaskType>(std::move($1));
+                      }
+|                     ChannelType {
+                          $$ = std::make_unique<pas::ast::ChannelType>(std::move($1));
                       };
 ArrayType:            ARRAY "[" SubrangeList "]" OF Type {
                           $$ = pas::ast::ArrayType(std::move($3), std::move($6));
@@ -417,6 +448,18 @@ SetType:              SET OF Subrange {
 PointerType:          "^" identifier {
                           $$ = pas::ast::PointerType(std::move($2));
                       };
+FileType:             FILE OF Type {
+                          $$ = pas::ast::FileType(std::move($3));
+                      };
+TaskType:             TASK {
+                          $$ = pas::ast::TaskType(std::nullopt);
+                      }
+|                     TASK OF Type {
+                          $$ = pas::ast::TaskType(std::move($3));
+                      };
+ChannelType:          CHANNEL OF Type {
+                          $$ = pas::ast::ChannelType(std::move($3));
+                      };
 FieldListSequence:    FieldList {
                           $$ = std::vector<pas::ast::FieldList>();
                           $$.emplace_back(std::move($1));
@@ -431,6 +474,7 @@ FieldList:            IdentList ":" Type {
 
 StatementSequence:    BEGIN StatementList END {
                           $$ = pas::ast::StmtSeq(std::move($2));
+                          $$.loc_ = make_source_loc(@$);
                       };
 StatementList:        Statement {
                           $$ = std::vector<pas::ast::Stmt>();
@@ -468,13 +512,17 @@ Statement:            Assignment {
                           $$ = std::make_unique<pas::ast::StmtSeq>(std::move($1));
                       }
 |                     %empty {
-                          $$ = std::make_unique<pas::ast::EmptyStmt>();
+                          auto empty_stmt = std::make_unique<pas::ast::EmptyStmt>();
+                          empty_stmt->loc_ = make_source_loc(@$);
+                          $$ = std::move(empty_stmt);
                       };
 Assignment:           Designator ":=" Expression {
                           $$ = pas::ast::Assignment(std::move($1), std::move($3));
+                          $$.loc_ = make_source_loc(@$);
                       };
 ProcedureCall:        identifier ActualParametersOpt {
                           $$ = pas::ast::ProcCall(std::move($1), std::move($2));
+                          $$.loc_ = make_source_loc(@$);
                       };
 ActualParametersOpt:  ActualParameters {
                           $$ = std::move($1);
@@ -484,12 +532,15 @@ ActualParametersOpt:  ActualParameters {
                       };
 IfStatement:          IF Expression THEN Statement {
                           $$ = pas::ast::IfStmt(std::move($2), std::move($4));
+                          $$.loc_ = make_source_loc(@$);
                       }
 |                     IF Expression THEN Statement ELSE Statement {
                           $$ = pas::ast::IfStmt(std::move($2), std::move($4), std::move($6));
+                          $$.loc_ = make_source_loc(@$);
                       };
 CaseStatement:        CASE Expression OF CaseList END {
                           $$ = pas::ast::CaseStmt(std::move($2), std::move($4));
+                          $$.loc_ = make_source_loc(@$);
                       };
 CaseList:             Case {
                           $$ = std::vector<pas::ast::Case>();
@@ -502,22 +553,37 @@ CaseList:             Case {
 Case:                 CaseLabelList ":" Statement {
                           $$ = pas::ast::Case(std::move($1), std::move($3));
                       };
-CaseLabelList:        ConstExpression {
-                          $$ = std::vector<pas::ast::ConstExpr>();
+CaseLabelList:        Element {
+                          $$ = std::vector<pas::ast::Element>();
                           $$.emplace_back(std::move($1));
                       }
-|                     ConstExpression "," CaseLabelList {
+|                     Element "," CaseLabelList {
                           $$ = std::move($3);
                           $$.insert($$.begin(), std::move($1));
                       };
 WhileStatement:       WHILE Expression DO Statement {
                           $$ = pas::ast::WhileStmt(std::move($2), std::move($4));
+                          $$.loc_ = make_source_loc(@$);
                       };
 RepeatStatement:      REPEAT StatementSequence UNTIL Expression {
                           $$ = pas::ast::RepeatStmt(std::move($2), std::move($4));
+                          $$.loc_ = make_source_loc(@$);
                       };
 ForStatement:         FOR identifier ":=" Expression WhichWay Expression DO Statement {
                           $$ = pas::ast::ForStmt(std::move($2), std::move($4), std::move($5), std::move($6), std::move($8));
+                          $$.loc_ = make_source_loc(@$);
+                      }
+|                     PARALLEL FOR identifier ":=" Expression WhichWay Expression ReductionListOpt DO Statement {
+                          $$ = pas::ast::ForStmt(std::move($3), std::move($5), std::move($6), std::move($7), std::move($10));
+                          $$.is_parallel_ = true;
+                          $$.reductions_ = std::move($8);
+                          $$.loc_ = make_source_loc(@$);
+                      };
+ReductionListOpt:     REDUCE IdentList {
+                          $$ = std::move($2);
+                      }
+|                     %empty {
+                          $$ = std::vector<std::string>();
                       };
 WhichWay:             TO {
                           $$ = pas::ast::WhichWay::To;
@@ -581,9 +647,11 @@ ExpList:              Expression {
                       };
 MemoryStatement:      NEW "(" identifier ")" {
                           $$ = pas::ast::MemoryStmt(pas::ast::MemoryStmt::Kind::New, std::move($3));
+                          $$.loc_ = make_source_loc(@$);
                       }
 |                     DISPOSE "(" identifier ")" {
                           $$ = pas::ast::MemoryStmt(pas::ast::MemoryStmt::Kind::Dispose, std::move($3));
+                          $$.loc_ = make_source_loc(@$);
                       };
 
 Expression:           SimpleExpression {
@@ -642,6 +710,9 @@ FactorList:           Factor {
 Factor:               number {
                           $$ = std::move($1);
                       }
+|                     real {
+                          $$ = std::move($1);
+                      }
 |                     string {
                           $$ = std::move($1);
                       }
@@ -664,8 +735,7 @@ Factor:               number {
                           $$ = std::make_unique<pas::ast::Negation>(std::move($2));
                       }
 |                     Setvalue {
-                          throw "Not implemented!";
-                          // $$ = std::variant<FactorKind::SetValue>(std::move($1));
+                          $$ = std::make_unique<pas::ast::SetValue>(std::move($1));
                       }
 |                     FunctionCall {
                           $$ = std::make_unique<pas::ast::FuncCall>(std::move($1));
@@ -721,6 +791,7 @@ FunctionDecl:         FunctionHeading ":" identifier ";" Block {
                       };
 ProcedureHeading:     PROCEDURE identifier FormalParametersOpt {
                           $$ = pas::ast::ProcHeading(std::move($2), std::move($3));
+                          $$.loc_ = make_source_loc(@$);
                       };
 FormalParametersOpt:  FormalParameters {
                           $$ = std::move($1);
@@ -730,6 +801,7 @@ FormalParametersOpt:  FormalParameters {
                       };
 FunctionHeading:      FUNCTION identifier FormalParametersOpt {
                           $$ = pas::ast::ProcHeading(std::move($2), std::move($3));
+                          $$.loc_ = make_source_loc(@$);
                       };
 FormalParameters:     "(" OneFormalParamList ")" {
                           $$ = std::move($2);
@@ -825,5 +897,5 @@ exp:
 void
 yy::parser::error(const location_type& l, const std::string& m)
 {
-  std::cerr << l << ": " << m << '\n';
+  driver.errors.emplace_back(l, m);
 }
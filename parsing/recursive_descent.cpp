@@ -0,0 +1,697 @@
+#include "parsing/recursive_descent.hpp"
+
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <variant>
+
+#include "driver.hh"
+#include "stack_space.hpp"
+
+namespace pas {
+namespace parsing {
+
+namespace {
+
+using Kind = yy::parser::symbol_kind;
+
+pas::ast::RelOp get_rel_op(Kind::symbol_kind_type kind) {
+  switch (kind) {
+  case Kind::S_EQ:
+    return pas::ast::RelOp::Equal;
+  case Kind::S_NEQ:
+    return pas::ast::RelOp::NotEqual;
+  case Kind::S_LT:
+    return pas::ast::RelOp::Less;
+  case Kind::S_GT:
+    return pas::ast::RelOp::Greater;
+  case Kind::S_LEQ:
+    return pas::ast::RelOp::LessEqual;
+  case Kind::S_GEQ:
+    return pas::ast::RelOp::GreaterEqual;
+  case Kind::S_IN:
+    return pas::ast::RelOp::In;
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
+
+pas::ast::AddOp get_add_op(Kind::symbol_kind_type kind) {
+  switch (kind) {
+  case Kind::S_PLUS:
+    return pas::ast::AddOp::Plus;
+  case Kind::S_MINUS:
+    return pas::ast::AddOp::Minus;
+  case Kind::S_OR:
+    return pas::ast::AddOp::Or;
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
+
+pas::ast::MultOp get_mult_op(Kind::symbol_kind_type kind) {
+  switch (kind) {
+  case Kind::S_STAR:
+    return pas::ast::MultOp::Multiply;
+  case Kind::S_SLASH:
+    return pas::ast::MultOp::RealDiv;
+  case Kind::S_DIV:
+    return pas::ast::MultOp::IntDiv;
+  case Kind::S_MOD:
+    return pas::ast::MultOp::Modulo;
+  case Kind::S_AND:
+    return pas::ast::MultOp::And;
+  default:
+    assert(false);
+    __builtin_unreachable();
+  }
+}
+
+} // namespace
+
+RecursiveDescentParser::RecursiveDescentParser(Scanner &scanner,
+                                               Driver &driver)
+    : scanner_(scanner), driver_(driver) {}
+
+std::optional<pas::AST> RecursiveDescentParser::parse() {
+  try {
+    advance();
+    pas::AST ast(parse_program_module());
+    if (!is(Kind::S_YYEOF)) {
+      fail(yy::parser::symbol_name(Kind::S_YYEOF));
+    }
+    return ast;
+  } catch (const yy::parser::syntax_error &error) {
+    // Of the scanner too, e.g. an invalid character.
+    driver_.errors.emplace_back(error.location, error.what());
+    return std::nullopt;
+  }
+}
+
+RecursiveDescentParser::BindingPower
+RecursiveDescentParser::get_binding_power(TokenKind kind) {
+  switch (kind) {
+  case Kind::S_EQ:
+  case Kind::S_NEQ:
+  case Kind::S_LT:
+  case Kind::S_GT:
+  case Kind::S_LEQ:
+  case Kind::S_GEQ:
+  case Kind::S_IN:
+    return BindingPower::Relation;
+  case Kind::S_PLUS:
+  case Kind::S_MINUS:
+  case Kind::S_OR:
+    return BindingPower::Adding;
+  case Kind::S_STAR:
+  case Kind::S_SLASH:
+  case Kind::S_DIV:
+  case Kind::S_MOD:
+  case Kind::S_AND:
+    return BindingPower::Multiplying;
+  default:
+    return BindingPower::None;
+  }
+}
+
+void RecursiveDescentParser::advance() {
+  previous_end_ = token_.location.end;
+  Token next = scanner_.ScanToken();
+  token_.clear();
+  token_.move(next);
+}
+
+bool RecursiveDescentParser::accept(TokenKind kind) {
+  if (!is(kind)) {
+    return false;
+  }
+  advance();
+  return true;
+}
+
+void RecursiveDescentParser::expect(TokenKind kind) {
+  if (!is(kind)) {
+    fail(yy::parser::symbol_name(kind));
+  }
+  advance();
+}
+
+std::string RecursiveDescentParser::expect_identifier() {
+  if (!is(Kind::S_identifier)) {
+    fail(yy::parser::symbol_name(Kind::S_identifier));
+  }
+  std::string ident = std::move(token_.value.as<std::string>());
+  advance();
+  return ident;
+}
+
+// Same format, as of the Bison parser with "parse.error verbose".
+void RecursiveDescentParser::fail(const std::string &expected) {
+  throw yy::parser::syntax_error(token_.location,
+                                 "syntax error, unexpected " +
+                                     yy::parser::symbol_name(kind()) +
+                                     ", expecting " + expected);
+}
+
+pas::ast::SourceLoc RecursiveDescentParser::get_loc() const {
+  return pas::ast::SourceLoc{static_cast<int>(token_.location.begin.line),
+                             static_cast<int>(token_.location.begin.column)};
+}
+
+pas::ast::ProgramModule RecursiveDescentParser::parse_program_module() {
+  pas::ast::ProgramModule pm;
+  pm.loc_ = get_loc();
+  expect(Kind::S_PROGRAM);
+  pm.program_name_ = expect_identifier();
+  // Program parameters are disregarded.
+  if (accept(Kind::S_LPAREN)) {
+    parse_ident_list();
+    expect(Kind::S_RPAREN);
+  }
+  expect(Kind::S_SEMICOLON);
+  pm.block_ = parse_block();
+  expect(Kind::S_DOT);
+  return pm;
+}
+
+std::vector<std::string> RecursiveDescentParser::parse_ident_list() {
+  std::vector<std::string> idents;
+  do {
+    idents.push_back(expect_identifier());
+  } while (accept(Kind::S_COMMA));
+  return idents;
+}
+
+pas::ast::Block RecursiveDescentParser::parse_block() {
+  pas::ast::Block block;
+  block.decls_ = std::make_unique<pas::ast::Declarations>();
+  parse_declarations(*block.decls_);
+  block.stmt_seq_ = parse_stmt_seq();
+  return block;
+}
+
+void RecursiveDescentParser::parse_declarations(
+    pas::ast::Declarations &decls) {
+  if (accept(Kind::S_CONST)) {
+    do {
+      pas::ast::ConstDef &const_def = decls.const_defs_.emplace_back();
+      const_def.ident_ = expect_identifier();
+      expect(Kind::S_EQ);
+      const_def.const_expr_ = parse_const_expr();
+      expect(Kind::S_SEMICOLON);
+    } while (is(Kind::S_identifier));
+  }
+
+  if (accept(Kind::S_TYPE)) {
+    do {
+      pas::ast::TypeDef &type_def = decls.type_defs_.emplace_back();
+      type_def.ident_ = expect_identifier();
+      expect(Kind::S_EQ);
+      type_def.type_ = parse_type();
+      expect(Kind::S_SEMICOLON);
+    } while (is(Kind::S_identifier));
+  }
+
+  if (accept(Kind::S_VAR)) {
+    do {
+      pas::ast::VarDecl &var_decl = decls.var_decls_.emplace_back();
+      var_decl.ident_list_ = parse_ident_list();
+      expect(Kind::S_COLON);
+      var_decl.type_ = parse_type();
+      expect(Kind::S_SEMICOLON);
+    } while (is(Kind::S_identifier));
+  }
+
+  while (is(Kind::S_PROCEDURE) || is(Kind::S_FUNCTION)) {
+    decls.subprog_decls_.push_back(parse_subprog_decl());
+  }
+}
+
+pas::ast::SubprogDecl RecursiveDescentParser::parse_subprog_decl() {
+  bool is_function = is(Kind::S_FUNCTION);
+  pas::ast::ProcDecl proc_decl;
+  proc_decl.proc_heading_ = parse_proc_heading();
+  std::string ret_type_ident;
+  if (is_function) {
+    expect(Kind::S_COLON);
+    ret_type_ident = expect_identifier();
+  }
+  expect(Kind::S_SEMICOLON);
+  proc_decl.block_ = parse_block();
+  expect(Kind::S_SEMICOLON);
+
+  if (!is_function) {
+    return pas::ast::SubprogDecl(std::in_place_type<pas::ast::ProcDecl>,
+                                 std::move(proc_decl));
+  }
+  return pas::ast::SubprogDecl(std::in_place_type<pas::ast::FuncDecl>,
+                               std::move(proc_decl),
+                               std::move(ret_type_ident));
+}
+
+pas::ast::ProcHeading RecursiveDescentParser::parse_proc_heading() {
+  pas::ast::ProcHeading heading;
+  heading.loc_ = get_loc();
+  // "procedure" or "function".
+  advance();
+  heading.proc_name_ = expect_identifier();
+  if (accept(Kind::S_LPAREN)) {
+    do {
+      pas::ast::FormalParam &param = heading.params_.emplace_back();
+      expect(Kind::S_VAR);
+      param.proc_name_ = parse_ident_list();
+      expect(Kind::S_COLON);
+      param.type_ident_ = expect_identifier();
+    } while (accept(Kind::S_SEMICOLON));
+    expect(Kind::S_RPAREN);
+  }
+  return heading;
+}
+
+pas::ast::ConstExpr RecursiveDescentParser::parse_const_expr() {
+  pas::ast::ConstExpr const_expr;
+  if (accept(Kind::S_PLUS)) {
+    const_expr.unary_op_ = pas::ast::UnaryOp::Plus;
+  } else if (accept(Kind::S_MINUS)) {
+    const_expr.unary_op_ = pas::ast::UnaryOp::Minus;
+  }
+  const_expr.factor_ = parse_const_factor();
+  return const_expr;
+}
+
+pas::ast::ConstFactor RecursiveDescentParser::parse_const_factor() {
+  switch (kind()) {
+  case Kind::S_identifier: {
+    return pas::ast::ConstFactor(std::in_place_type<std::string>,
+                                 expect_identifier());
+  }
+  case Kind::S_number: {
+    int number = token_.value.as<int>();
+    advance();
+    return pas::ast::ConstFactor(std::in_place_type<int>, number);
+  }
+  case Kind::S_TRUE:
+  case Kind::S_FALSE: {
+    bool value = is(Kind::S_TRUE);
+    advance();
+    return pas::ast::ConstFactor(std::in_place_type<bool>, value);
+  }
+  case Kind::S_NIL: {
+    advance();
+    return pas::ast::ConstFactor(std::in_place_type<std::monostate>);
+  }
+  default:
+    fail("constant");
+  }
+}
+
+pas::ast::Element RecursiveDescentParser::parse_element() {
+  pas::ast::ConstExpr first = parse_const_expr();
+  if (!accept(Kind::S_DOTDOT)) {
+    return pas::ast::Element(std::in_place_type<pas::ast::ConstExpr>,
+                             std::move(first));
+  }
+  pas::ast::ConstExpr last = parse_const_expr();
+  return pas::ast::Element(
+      std::in_place_type<std::pair<pas::ast::ConstExpr, pas::ast::ConstExpr>>,
+      std::move(first), std::move(last));
+}
+
+pas::ast::Type RecursiveDescentParser::parse_type() {
+  switch (kind()) {
+  case Kind::S_identifier: {
+    return std::make_unique<pas::ast::NamedType>(expect_identifier());
+  }
+  case Kind::S_ARRAY: {
+    advance();
+    auto array_type = std::make_unique<pas::ast::ArrayType>();
+    expect(Kind::S_LBRACKET);
+    do {
+      array_type->subrange_list_.push_back(parse_subrange());
+    } while (accept(Kind::S_COMMA));
+    expect(Kind::S_RBRACKET);
+    expect(Kind::S_OF);
+    array_type->item_type_ = parse_type();
+    return array_type;
+  }
+  case Kind::S_CARET: {
+    advance();
+    return std::make_unique<pas::ast::PointerType>(expect_identifier());
+  }
+  case Kind::S_PACKED:
+  case Kind::S_RECORD: {
+    auto record_type = std::make_unique<pas::ast::RecordType>();
+    record_type->packed_ = accept(Kind::S_PACKED);
+    expect(Kind::S_RECORD);
+    do {
+      pas::ast::FieldList &field_list = record_type->fields_.emplace_back();
+      field_list.idents_ = parse_ident_list();
+      expect(Kind::S_COLON);
+      field_list.type_ = parse_type();
+    } while (accept(Kind::S_SEMICOLON));
+    expect(Kind::S_END);
+    return record_type;
+  }
+  case Kind::S_SET: {
+    advance();
+    expect(Kind::S_OF);
+    return std::make_unique<pas::ast::SetType>(parse_subrange());
+  }
+  case Kind::S_FILE: {
+    advance();
+    expect(Kind::S_OF);
+    return std::make_unique<pas::ast::FileType>(parse_type());
+  }
+  case Kind::S_TASK: {
+    advance();
+    auto task_type = std::make_unique<pas::ast::TaskType>();
+    if (accept(Kind::S_OF)) {
+      task_type->result_type_ = parse_type();
+    }
+    return task_type;
+  }
+  case Kind::S_CHANNEL: {
+    advance();
+    expect(Kind::S_OF);
+    return std::make_unique<pas::ast::ChannelType>(parse_type());
+  }
+  default:
+    fail("type");
+  }
+}
+
+pas::ast::Subrange RecursiveDescentParser::parse_subrange() {
+  pas::ast::Subrange subrange;
+  subrange.start_ = parse_const_factor();
+  expect(Kind::S_DOTDOT);
+  subrange.finish_ = parse_const_factor();
+  return subrange;
+}
+
+pas::ast::StmtSeq RecursiveDescentParser::parse_stmt_seq() {
+  pas::ast::StmtSeq stmt_seq;
+  stmt_seq.loc_ = get_loc();
+  expect(Kind::S_BEGIN);
+  do {
+    stmt_seq.stmts_.push_back(parse_stmt());
+  } while (accept(Kind::S_SEMICOLON));
+  expect(Kind::S_END);
+  return stmt_seq;
+}
+
+// Statements and factors are, where the tree nests, see stack_space.hpp.
+pas::ast::Stmt RecursiveDescentParser::parse_stmt() {
+  return run_with_sufficient_stack([&]() { return parse_stmt_of_kind(); });
+}
+
+pas::ast::Stmt RecursiveDescentParser::parse_stmt_of_kind() {
+  switch (kind()) {
+  case Kind::S_identifier:
+    return parse_ident_stmt();
+  case Kind::S_IF:
+    return parse_if_stmt();
+  case Kind::S_CASE:
+    return parse_case_stmt();
+  case Kind::S_WHILE: {
+    auto while_stmt = std::make_unique<pas::ast::WhileStmt>();
+    while_stmt->loc_ = get_loc();
+    advance();
+    while_stmt->cond_expr_ = parse_expr();
+    expect(Kind::S_DO);
+    while_stmt->inner_stmt_ = parse_stmt();
+    return while_stmt;
+  }
+  case Kind::S_REPEAT: {
+    auto repeat_stmt = std::make_unique<pas::ast::RepeatStmt>();
+    repeat_stmt->loc_ = get_loc();
+    advance();
+    repeat_stmt->stmt_seq_ = parse_stmt_seq();
+    expect(Kind::S_UNTIL);
+    repeat_stmt->cond_expr_ = parse_expr();
+    return repeat_stmt;
+  }
+  case Kind::S_FOR:
+  case Kind::S_PARALLEL:
+    return parse_for_stmt();
+  case Kind::S_NEW:
+  case Kind::S_DISPOSE: {
+    auto memory_stmt = std::make_unique<pas::ast::MemoryStmt>();
+    memory_stmt->loc_ = get_loc();
+    memory_stmt->kind_ = is(Kind::S_NEW) ? pas::ast::MemoryStmt::Kind::New
+                                         : pas::ast::MemoryStmt::Kind::Dispose;
+    advance();
+    expect(Kind::S_LPAREN);
+    memory_stmt->ident_ = expect_identifier();
+    expect(Kind::S_RPAREN);
+    return memory_stmt;
+  }
+  case Kind::S_BEGIN:
+    return std::make_unique<pas::ast::StmtSeq>(parse_stmt_seq());
+  default: {
+    // The token is for the enclosing statement, e.g. "end" or ";".
+    auto empty_stmt = std::make_unique<pas::ast::EmptyStmt>();
+    empty_stmt->loc_ =
+        pas::ast::SourceLoc{static_cast<int>(previous_end_.line),
+                            static_cast<int>(previous_end_.column)};
+    return empty_stmt;
+  }
+  }
+}
+
+// Assignment or procedure call, the token after the identifier tells.
+pas::ast::Stmt RecursiveDescentParser::parse_ident_stmt() {
+  pas::ast::SourceLoc loc = get_loc();
+  std::string ident = expect_identifier();
+  if (is(Kind::S_ASSIGN) || is(Kind::S_DOT) || is(Kind::S_LBRACKET) ||
+      is(Kind::S_CARET)) {
+    auto assignment = std::make_unique<pas::ast::Assignment>();
+    assignment->loc_ = loc;
+    assignment->designator_.ident_ = std::move(ident);
+    parse_designator_items(assignment->designator_.items_);
+    expect(Kind::S_ASSIGN);
+    assignment->expr_ = parse_expr();
+    return assignment;
+  }
+
+  auto proc_call = std::make_unique<pas::ast::ProcCall>();
+  proc_call->loc_ = loc;
+  proc_call->proc_ident_ = std::move(ident);
+  if (is(Kind::S_LPAREN)) {
+    parse_actual_params(proc_call->params_);
+  }
+  return proc_call;
+}
+
+pas::ast::Stmt RecursiveDescentParser::parse_if_stmt() {
+  auto if_stmt = std::make_unique<pas::ast::IfStmt>();
+  if_stmt->loc_ = get_loc();
+  expect(Kind::S_IF);
+  if_stmt->cond_expr_ = parse_expr();
+  expect(Kind::S_THEN);
+  if_stmt->then_stmt_ = parse_stmt();
+  // Dangling else belongs to the nearest if.
+  if (accept(Kind::S_ELSE)) {
+    if_stmt->else_stmt_ = parse_stmt();
+  }
+  return if_stmt;
+}
+
+pas::ast::Stmt RecursiveDescentParser::parse_case_stmt() {
+  auto case_stmt = std::make_unique<pas::ast::CaseStmt>();
+  case_stmt->loc_ = get_loc();
+  expect(Kind::S_CASE);
+  case_stmt->cond_expr_ = parse_expr();
+  expect(Kind::S_OF);
+  do {
+    pas::ast::Case &case_item = case_stmt->cases_.emplace_back();
+    do {
+      case_item.labels_.push_back(parse_element());
+    } while (accept(Kind::S_COMMA));
+    expect(Kind::S_COLON);
+    case_item.then_stmt_ = parse_stmt();
+  } while (accept(Kind::S_SEMICOLON));
+  expect(Kind::S_END);
+  return case_stmt;
+}
+
+pas::ast::Stmt RecursiveDescentParser::parse_for_stmt() {
+  auto for_stmt = std::make_unique<pas::ast::ForStmt>();
+  for_stmt->loc_ = get_loc();
+  for_stmt->is_parallel_ = accept(Kind::S_PARALLEL);
+  expect(Kind::S_FOR);
+  for_stmt->ident_ = expect_identifier();
+  expect(Kind::S_ASSIGN);
+  for_stmt->start_val_expr_ = parse_expr();
+  if (accept(Kind::S_TO)) {
+    for_stmt->dir_ = pas::ast::WhichWay::To;
+  } else if (accept(Kind::S_DOWNTO)) {
+    for_stmt->dir_ = pas::ast::WhichWay::DownTo;
+  } else {
+    fail(yy::parser::symbol_name(Kind::S_DOWNTO) + " or " +
+         yy::parser::symbol_name(Kind::S_TO));
+  }
+  for_stmt->finish_val_expr_ = parse_expr();
+  if (for_stmt->is_parallel_ && accept(Kind::S_REDUCE)) {
+    for_stmt->reductions_ = parse_ident_list();
+  }
+  expect(Kind::S_DO);
+  for_stmt->inner_stmt_ = parse_stmt();
+  return for_stmt;
+}
+
+void RecursiveDescentParser::parse_designator_items(
+    std::vector<pas::ast::DesignatorItem> &items) {
+  while (true) {
+    if (accept(Kind::S_DOT)) {
+      items.emplace_back(std::in_place_type<pas::ast::DesignatorFieldAccess>,
+                         expect_identifier());
+    } else if (accept(Kind::S_LBRACKET)) {
+      auto &array_access = std::get<pas::ast::DesignatorArrayAccess>(
+          items.emplace_back(
+              std::in_place_type<pas::ast::DesignatorArrayAccess>));
+      do {
+        array_access.expr_list_.push_back(
+            std::make_unique<pas::ast::Expr>(parse_expr()));
+      } while (accept(Kind::S_COMMA));
+      expect(Kind::S_RBRACKET);
+    } else if (accept(Kind::S_CARET)) {
+      items.emplace_back(std::in_place_type<pas::ast::DesignatorPointerAccess>);
+    } else {
+      return;
+    }
+  }
+}
+
+// Parentheses may be empty, see ActualParameters of parser.y.
+void RecursiveDescentParser::parse_actual_params(
+    std::vector<pas::ast::Expr> &params) {
+  expect(Kind::S_LPAREN);
+  if (accept(Kind::S_RPAREN)) {
+    return;
+  }
+  do {
+    params.push_back(parse_expr());
+  } while (accept(Kind::S_COMMA));
+  expect(Kind::S_RPAREN);
+}
+
+// Expressions are parsed by a Pratt loop per binding power: the operands
+//   of a level are parsed at the next one, which stops at an operator of a
+//   lower power. Relations don't associate, "a < b < c" is an error.
+pas::ast::Expr RecursiveDescentParser::parse_expr() {
+  pas::ast::Expr expr;
+  expr.start_expr_ = parse_simple_expr();
+  if (get_binding_power(kind()) == BindingPower::Relation) {
+    pas::ast::RelOp rel = get_rel_op(kind());
+    advance();
+    expr.op_.emplace(pas::ast::Expr::Op{rel, parse_simple_expr()});
+  }
+  return expr;
+}
+
+pas::ast::SimpleExpr RecursiveDescentParser::parse_simple_expr() {
+  pas::ast::SimpleExpr simple_expr;
+  // Applies to the first term only: -a + b is (-a) + b.
+  if (accept(Kind::S_PLUS)) {
+    simple_expr.unary_op_ = pas::ast::UnaryOp::Plus;
+  } else if (accept(Kind::S_MINUS)) {
+    simple_expr.unary_op_ = pas::ast::UnaryOp::Minus;
+  }
+  simple_expr.start_term_ = parse_term();
+  while (get_binding_power(kind()) == BindingPower::Adding) {
+    pas::ast::AddOp op = get_add_op(kind());
+    advance();
+    simple_expr.ops_.push_back(pas::ast::SimpleExpr::Op{op, parse_term()});
+  }
+  return simple_expr;
+}
+
+pas::ast::Term RecursiveDescentParser::parse_term() {
+  pas::ast::Term term;
+  term.start_factor_ = parse_factor();
+  while (get_binding_power(kind()) == BindingPower::Multiplying) {
+    pas::ast::MultOp op = get_mult_op(kind());
+    advance();
+    term.ops_.push_back(pas::ast::Term::Op{op, parse_factor()});
+  }
+  return term;
+}
+
+pas::ast::Factor RecursiveDescentParser::parse_factor() {
+  return run_with_sufficient_stack([&]() { return parse_factor_of_kind(); });
+}
+
+pas::ast::Factor RecursiveDescentParser::parse_factor_of_kind() {
+  switch (kind()) {
+  case Kind::S_number: {
+    int number = token_.value.as<int>();
+    advance();
+    return pas::ast::Factor(std::in_place_type<int>, number);
+  }
+  case Kind::S_real: {
+    double real = token_.value.as<double>();
+    advance();
+    return pas::ast::Factor(std::in_place_type<double>, real);
+  }
+  case Kind::S_string: {
+    std::string string = std::move(token_.value.as<std::string>());
+    advance();
+    return pas::ast::Factor(std::in_place_type<std::string>,
+                            std::move(string));
+  }
+  case Kind::S_TRUE:
+  case Kind::S_FALSE: {
+    bool value = is(Kind::S_TRUE);
+    advance();
+    return pas::ast::Factor(std::in_place_type<bool>, value);
+  }
+  case Kind::S_NIL: {
+    advance();
+    return pas::ast::Factor(std::in_place_type<std::monostate>);
+  }
+  case Kind::S_identifier: {
+    std::string ident = expect_identifier();
+    if (is(Kind::S_LPAREN)) {
+      auto func_call = std::make_unique<pas::ast::FuncCall>();
+      func_call->func_ident_ = std::move(ident);
+      parse_actual_params(func_call->params_);
+      return func_call;
+    }
+    pas::ast::Factor factor(std::in_place_type<pas::ast::Designator>);
+    auto &designator = std::get<pas::ast::Designator>(factor);
+    designator.ident_ = std::move(ident);
+    parse_designator_items(designator.items_);
+    return factor;
+  }
+  case Kind::S_LPAREN: {
+    advance();
+    auto expr = std::make_unique<pas::ast::Expr>(parse_expr());
+    expect(Kind::S_RPAREN);
+    return expr;
+  }
+  case Kind::S_NOT: {
+    advance();
+    auto negation = std::make_unique<pas::ast::Negation>();
+    negation->factor_ = parse_factor();
+    return negation;
+  }
+  case Kind::S_LBRACKET: {
+    advance();
+    auto set_value = std::make_unique<pas::ast::SetValue>();
+    if (!is(Kind::S_RBRACKET)) {
+      do {
+        set_value->elements_.push_back(parse_element());
+      } while (accept(Kind::S_COMMA));
+    }
+    expect(Kind::S_RBRACKET);
+    return set_value;
+  }
+  default:
+    fail("expression");
+  }
+}
+
+} // namespace parsing
+} // namespace pas
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ast/ast.hpp"
+#include "parser.hh"
+
+class Driver;
+class Scanner;
+
+// Hand-written alternative to the Bison parser (-fparser=descent). It reads
+//   the tokens of the same scanner and builds the same tree, but builds the
+//   nodes in place: lists are appended to, statements are allocated before
+//   their children are parsed, no values are moved through a semantic
+//   stack. Statements are parsed by recursive descent, expressions by
+//   binding powers of the operators (Pratt).
+
+namespace pas {
+namespace parsing {
+
+class RecursiveDescentParser {
+public:
+  RecursiveDescentParser(Scanner &scanner, Driver &driver);
+
+  // Syntax errors are added to the errors of the driver, the parse stops at
+  //   the first one, as the Bison one does.
+  std::optional<pas::AST> parse();
+
+private:
+  using Token = yy::parser::symbol_type;
+  using TokenKind = yy::parser::symbol_kind::symbol_kind_type;
+
+  // Of the infix operators. The AST has a node for each level: Expr of
+  //   relations, SimpleExpr of adding and Term of multiplying operators.
+  enum class BindingPower { None, Relation, Adding, Multiplying };
+  static BindingPower get_binding_power(TokenKind kind);
+
+  TokenKind kind() const { return token_.kind(); }
+  bool is(TokenKind kind) const { return token_.kind() == kind; }
+  void advance();
+  // Advances, if the token is of the kind.
+  bool accept(TokenKind kind);
+  void expect(TokenKind kind);
+  std::string expect_identifier();
+  [[noreturn]] void fail(const std::string &expected);
+  pas::ast::SourceLoc get_loc() const;
+
+  pas::ast::ProgramModule parse_program_module();
+  std::vector<std::string> parse_ident_list();
+  pas::ast::Block parse_block();
+  void parse_declarations(pas::ast::Declarations &decls);
+  pas::ast::SubprogDecl parse_subprog_decl();
+  pas::ast::ProcHeading parse_proc_heading();
+
+  pas::ast::ConstExpr parse_const_expr();
+  pas::ast::ConstFactor parse_const_factor();
+  pas::ast::Element parse_element();
+  pas::ast::Type parse_type();
+  pas::ast::Subrange parse_subrange();
+
+  pas::ast::StmtSeq parse_stmt_seq();
+  pas::ast::Stmt parse_stmt();
+  pas::ast::Stmt parse_stmt_of_kind();
+  pas::ast::Stmt parse_ident_stmt();
+  pas::ast::Stmt parse_if_stmt();
+  pas::ast::Stmt parse_case_stmt();
+  pas::ast::Stmt parse_for_stmt();
+  void parse_designator_items(std::vector<pas::ast::DesignatorItem> &items);
+  void parse_actual_params(std::vector<pas::ast::Expr> &params);
+
+  pas::ast::Expr parse_expr();
+  pas::ast::SimpleExpr parse_simple_expr();
+  pas::ast::Term parse_term();
+  pas::ast::Factor parse_factor();
+  pas::ast::Factor parse_factor_of_kind();
+
+  Scanner &scanner_;
+  Driver &driver_;
+  Token token_;
+  // End of the previous token, empty statements are there, as in Bison.
+  yy::position previous_end_;
+};
+
+} // namespace parsing
+} // namespace pas
@@ -0,0 +1,181 @@
+#include "remarks.hpp"
+
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_os_ostream.h"
+
+namespace pas {
+namespace remarks {
+
+namespace {
+
+const char *get_kind_name(Kind kind) {
+  switch (kind) {
+  case Kind::Passed:
+    return "passed";
+  case Kind::Missed:
+    return "missed";
+  case Kind::Analysis:
+    return "analysis";
+  }
+  return "";
+}
+
+// Outlined loop bodies are "p.parallel", bodies of tasks are "p.task",
+//   everything after the dot is added by the lowerer.
+std::string get_procedure_name(const llvm::Function &function) {
+  std::string name = function.getSubprogram() != nullptr
+                          ? function.getSubprogram()->getName().str()
+                          : function.getName().str();
+  return name.substr(0, name.find('.'));
+}
+
+class Handler : public llvm::DiagnosticHandler {
+public:
+  Handler(std::vector<Remark> *remarks, std::optional<std::regex> pass_filter)
+      : remarks_(remarks), pass_filter_(std::move(pass_filter)) {}
+
+  bool handleDiagnostics(const llvm::DiagnosticInfo &info) override {
+    auto *remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+    if (remark == nullptr) {
+      // Errors and warnings are printed as usual.
+      return false;
+    }
+    Kind kind = Kind::Analysis;
+    if (remark->isPassed()) {
+      kind = Kind::Passed;
+    } else if (remark->isMissed() ||
+               remark->getKind() == llvm::DK_OptimizationFailure) {
+      kind = Kind::Missed;
+    }
+
+    Remark result;
+    result.kind = kind;
+    result.pass = remark->getPassName().str();
+    result.name = remark->getRemarkName().str();
+    result.procedure = get_procedure_name(remark->getFunction());
+    if (remark->isLocationAvailable()) {
+      result.file = remark->getLocation().getRelativePath().str();
+      result.line = remark->getLocation().getLine();
+      result.column = remark->getLocation().getColumn();
+    }
+    result.message = remark->getMsg();
+    if (remark->getHotness().hasValue()) {
+      result.hotness = remark->getHotness().getValue();
+    }
+    remarks_->push_back(std::move(result));
+    return true;
+  }
+
+  bool isAnalysisRemarkEnabled(llvm::StringRef pass_name) const override {
+    return matches(pass_name);
+  }
+  bool isMissedOptRemarkEnabled(llvm::StringRef pass_name) const override {
+    return matches(pass_name);
+  }
+  bool isPassedOptRemarkEnabled(llvm::StringRef pass_name) const override {
+    return matches(pass_name);
+  }
+  bool isAnyRemarkEnabled() const override { return true; }
+
+private:
+  bool matches(llvm::StringRef pass_name) const {
+    return !pass_filter_.has_value() ||
+           std::regex_search(pass_name.str(), *pass_filter_);
+  }
+
+  std::vector<Remark> *remarks_;
+  std::optional<std::regex> pass_filter_;
+};
+
+// Single quoted scalar, quotes are doubled inside.
+std::string quote_yaml(const std::string &str) {
+  std::string result = "'";
+  for (char c : str) {
+    result += c;
+    if (c == '\'') {
+      result += '\'';
+    }
+  }
+  return result + "'";
+}
+
+} // namespace
+
+Collector::Collector(llvm::LLVMContext &context,
+                     std::optional<std::regex> pass_filter)
+    : context_(context) {
+  context_.setDiagnosticHandler(
+      std::make_unique<Handler>(&remarks_, std::move(pass_filter)));
+}
+
+Collector::~Collector() {
+  context_.setDiagnosticHandler(std::make_unique<llvm::DiagnosticHandler>());
+}
+
+void print_remarks(const std::vector<Remark> &remarks, std::ostream &out) {
+  for (const Remark &remark : remarks) {
+    if (remark.line != 0) {
+      out << remark.file << ':' << remark.line << ':' << remark.column
+          << ": ";
+    }
+    out << get_kind_name(remark.kind) << ": " << remark.message << " ["
+        << remark.pass << ", in " << remark.procedure;
+    if (remark.hotness.has_value()) {
+      out << ", hotness " << *remark.hotness;
+    }
+    out << "]\n";
+  }
+}
+
+void write_remarks_yaml(const std::vector<Remark> &remarks,
+                        std::ostream &out) {
+  static const char *const kTags[] = {"!Passed", "!Missed", "!Analysis"};
+  for (const Remark &remark : remarks) {
+    out << "--- " << kTags[static_cast<int>(remark.kind)] << '\n';
+    out << "Pass:            " << quote_yaml(remark.pass) << '\n';
+    out << "Name:            " << quote_yaml(remark.name) << '\n';
+    if (remark.line != 0) {
+      out << "DebugLoc:        { File: " << quote_yaml(remark.file)
+          << ", Line: " << remark.line << ", Column: " << remark.column
+          << " }\n";
+    }
+    out << "Function:        " << quote_yaml(remark.procedure) << '\n';
+    if (remark.hotness.has_value()) {
+      out << "Hotness:         " << *remark.hotness << '\n';
+    }
+    out << "Args:\n";
+    out << "  - String:          " << quote_yaml(remark.message) << '\n';
+    out << "...\n";
+  }
+}
+
+void write_remarks_json(const std::vector<Remark> &remarks,
+                        std::ostream &out) {
+  llvm::raw_os_ostream os(out);
+  llvm::json::OStream json(os, 2);
+  json.array([&] {
+    for (const Remark &remark : remarks) {
+      json.object([&] {
+        json.attribute("kind", get_kind_name(remark.kind));
+        json.attribute("pass", remark.pass);
+        json.attribute("name", remark.name);
+        json.attribute("procedure", remark.procedure);
+        json.attribute("file", remark.file);
+        json.attribute("line", static_cast<int64_t>(remark.line));
+        json.attribute("column", static_cast<int64_t>(remark.column));
+        json.attribute("message", remark.message);
+        if (remark.hotness.has_value()) {
+          json.attribute("hotness", static_cast<int64_t>(*remark.hotness));
+        }
+      });
+    }
+  });
+  os << '\n';
+}
+
+} // namespace remarks
+} // namespace pas
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+
+// Optimization remarks (-fopt-remarks): what LLVM passes did, failed to do
+//   and found out about the program, e.g. that a loop isn't vectorized,
+//   because of a call in it. Remarks point to Pascal lines through the
+//   debug info, so it is generated along with them.
+
+namespace pas {
+namespace remarks {
+
+enum class Kind { Passed, Missed, Analysis };
+
+struct Remark {
+  Kind kind;
+  // Name of the pass (e.g. "loop-vectorize") and the name of the remark
+  //   in it (e.g. "MissedDetails").
+  std::string pass;
+  std::string name;
+  // Pascal procedure or the program, loop bodies of parallel loops and
+  //   tasks are reported against the procedure, that contains them.
+  std::string procedure;
+  // Empty and zeros, if LLVM doesn't know the line.
+  std::string file;
+  unsigned line = 0;
+  unsigned column = 0;
+  std::string message;
+  // Count of executions of the code, known with -fprofile-use only.
+  std::optional<uint64_t> hotness;
+};
+
+// Collects the remarks, that are emitted into the context, while alive.
+//   Only passes, that match the filter, if there is one, are reported.
+class Collector {
+public:
+  Collector(llvm::LLVMContext &context, std::optional<std::regex> pass_filter);
+  ~Collector();
+
+  Collector(const Collector &) = delete;
+  Collector &operator=(const Collector &) = delete;
+
+  const std::vector<Remark> &remarks() const { return remarks_; }
+
+private:
+  llvm::LLVMContext &context_;
+  std::vector<Remark> remarks_;
+};
+
+// "test.pas:12:3: missed: loop not vectorized [loop-vectorize, in sum]".
+void print_remarks(const std::vector<Remark> &remarks, std::ostream &out);
+
+// Documents in the format of LLVM optimization records, that opt-viewer
+//   and the like read.
+void write_remarks_yaml(const std::vector<Remark> &remarks,
+                        std::ostream &out);
+
+// Array of objects with the fields of Remark.
+void write_remarks_json(const std::vector<Remark> &remarks,
+                        std::ostream &out);
+
+} // namespace remarks
+} // namespace pas
@@ -0,0 +1,114 @@
+#!/bin/bash
+
+# Runs the programs of benchmarks/ (make benchmark) under every optimization
+#   level: the IR as lowered and -O0..-O3. The only backend is MCJIT. Each
+#   program is compiled once per level by the fork server (-fork-server),
+#   then run the given number of times. Prints a JSON object per program
+#   and level:
+#     {"benchmark": "sieve", "backend": "mcjit", "opt_level": "O2",
+#      "repetitions": 5, "status": "ok",
+#      "wall_ms": {"min": .., "median": .., "mean": .., "stddev": ..},
+#      "user_ms_mean": .., "sys_ms_mean": .., "max_rss_kb": ..,
+#      "checksum": "<sha256 of the output>", "matches_baseline": true}
+#   Status is "failed", if a run hasn't exited with 0, and "unstable", if
+#   the runs have different outputs. The baseline is the output of the
+#   first level, levels must not change it. Max RSS counts the pages, that
+#   a run shares with the compiler, too.
+#
+# Usage: benchmark.bash <pascal executable> <benchmarks dir> [repetitions]
+
+set -euo pipefail
+
+pascal=$1
+benchmarks_dir=$2
+repetitions=${3:-5}
+levels=("" -O0 -O1 -O2 -O3)
+
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+for program in "$benchmarks_dir"/*.pas; do
+    name=$(basename "$program" .pas)
+    baseline=""
+    for level in "${levels[@]}"; do
+        level_name=${level#-}
+        level_name=${level_name:-none}
+
+        requests=""
+        for ((i = 0; i < repetitions; ++i)); do
+            requests+="/dev/null $work_dir/$name.$i.out"$'\n'
+        done
+        # shellcheck disable=SC2086 # No level is no argument.
+        if ! responses=$(printf '%s' "$requests" |
+                         "$pascal" -fork-server $level "$program" \
+                             2>"$work_dir/stderr"); then
+            echo "Failed to compile $program $level:" >&2
+            cat "$work_dir/stderr" >&2
+            printf '{"benchmark": "%s", "backend": "mcjit", "opt_level": "%s", "status": "compile_failed"}\n' \
+                "$name" "$level_name"
+            continue
+        fi
+
+        checksums=$(for ((i = 0; i < repetitions; ++i)); do
+                        sha256sum "$work_dir/$name.$i.out" | cut -d' ' -f1
+                    done | sort -u)
+        checksum=$(head -n1 <<< "$checksums")
+        baseline=${baseline:-$checksum}
+        status=ok
+        if [[ $(wc -l <<< "$checksums") -ne 1 ]]; then
+            status=unstable
+        fi
+        if grep -qv '^status=exited code=0 ' <<< "$responses"; then
+            status=failed
+        fi
+        matches_baseline=false
+        if [[ $checksum == "$baseline" ]]; then
+            matches_baseline=true
+        fi
+
+        awk -v name="$name" -v level="$level_name" -v status="$status" \
+            -v checksum="$checksum" -v matches="$matches_baseline" '
+            {
+                for (f = 1; f <= NF; ++f) {
+                    split($f, kv, "=")
+                    value[kv[1]] = kv[2]
+                }
+                wall[NR] = value["wall_ms"] + 0
+                user += value["user_ms"]
+                sys += value["sys_ms"]
+                if (value["max_rss_kb"] + 0 > rss) {
+                    rss = value["max_rss_kb"] + 0
+                }
+            }
+            END {
+                n = NR
+                # Insertion sort, there are a few repetitions.
+                for (i = 2; i <= n; ++i) {
+                    x = wall[i]
+                    for (j = i - 1; j >= 1 && wall[j] > x; --j) {
+                        wall[j + 1] = wall[j]
+                    }
+                    wall[j + 1] = x
+                }
+                for (i = 1; i <= n; ++i) {
+                    sum += wall[i]
+                }
+                mean = sum / n
+                for (i = 1; i <= n; ++i) {
+                    squares += (wall[i] - mean) ^ 2
+                }
+                median = n % 2 ? wall[(n + 1) / 2] \
+                               : (wall[n / 2] + wall[n / 2 + 1]) / 2
+                printf "{\"benchmark\": \"%s\", \"backend\": \"mcjit\", " \
+                       "\"opt_level\": \"%s\", \"repetitions\": %d, " \
+                       "\"status\": \"%s\", \"wall_ms\": {\"min\": %.2f, " \
+                       "\"median\": %.2f, \"mean\": %.2f, " \
+                       "\"stddev\": %.2f}, \"user_ms_mean\": %.2f, " \
+                       "\"sys_ms_mean\": %.2f, \"max_rss_kb\": %d, " \
+                       "\"checksum\": \"%s\", \"matches_baseline\": %s}\n",
+                       name, level, n, status, wall[1], median, mean,
+                       sqrt(squares / n), user / n, sys / n, rss, checksum,
+                       matches
+            }' <<< "$responses"
+    done
+done
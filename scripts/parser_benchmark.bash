@@ -0,0 +1,149 @@
+#!/bin/bash
+
+# Compares the throughput of the Bison parser and of the hand-written one
+#   (-fparser=descent, parsing/recursive_descent.hpp) on large generated
+#   programs (make parser_benchmark):
+#     statements  - a long flat list of assignments, ifs and loops;
+#     expressions - assignments of long expressions;
+#     nesting     - deeply nested parentheses, begin/end blocks and ifs.
+#   Each program is parsed the given number of times by each parser with
+#   -fsyntax-only, the time is of the "parse" phase of -fmem-report, it
+#   includes counting of the AST. Prints a JSON object per program and
+#   parser:
+#     {"input": "statements", "bytes": .., "parser": "descent",
+#      "repetitions": 5, "status": "ok",
+#      "parse_ms": {"min": .., "median": ..}, "mib_per_s": ..,
+#      "same_ast": true}
+#   same_ast is whether the printed AST is the one of the Bison parser.
+#
+# Usage: parser_benchmark.bash <pascal executable> [size] [repetitions]
+
+set -euo pipefail
+
+pascal=$1
+size=${2:-20000}
+repetitions=${3:-5}
+parsers=(bison descent)
+
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+awk -v n="$size" 'BEGIN {
+    print "program Statements;"
+    print "var i, x, y: integer;"
+    print "procedure P(var a: integer);"
+    print "begin"
+    print "  a := a + 1"
+    print "end;"
+    print "begin"
+    for (k = 1; k <= n; ++k) {
+        kind = k % 5
+        if (kind == 0) {
+            printf "  x := x + %d * 2 - y div 3;\n", k
+        } else if (kind == 1) {
+            printf "  if x > %d then y := y - 1 else y := y + 1;\n", k
+        } else if (kind == 2) {
+            printf "  while x < %d do x := x + 1;\n", k
+        } else if (kind == 3) {
+            printf "  for i := 1 to %d do y := y + i;\n", k
+        } else {
+            print "  P(x);"
+        }
+    }
+    print "  x := 0"
+    print "end."
+}' > "$work_dir/statements.pas"
+
+awk -v n="$size" 'BEGIN {
+    print "program Expressions;"
+    print "var x, y: integer; b: boolean;"
+    print "begin"
+    for (k = 1; k <= n / 100; ++k) {
+        printf "  x := (x + %d) * 2", k
+        for (t = 1; t <= 100; ++t) {
+            printf " - y div %d + (x mod 7) * %d", t, t
+        }
+        print ";"
+        printf "  b := not (x < y) and (x + 1 >= y - 1) or b;\n"
+    }
+    print "  x := 0"
+    print "end."
+}' > "$work_dir/expressions.pas"
+
+awk -v n="$size" 'BEGIN {
+    depth = n / 4
+    print "program Nesting;"
+    print "var x: integer;"
+    print "begin"
+    printf "  x := "
+    for (d = 0; d < depth; ++d) {
+        printf "("
+    }
+    printf "1"
+    for (d = 0; d < depth; ++d) {
+        printf " + x)"
+    }
+    print ";"
+    for (d = 0; d < depth; ++d) {
+        printf "begin "
+    }
+    printf "x := 1"
+    for (d = 0; d < depth; ++d) {
+        printf " end"
+    }
+    print ";"
+    for (d = 0; d < depth; ++d) {
+        printf "if x > %d then ", d
+    }
+    print "x := 0"
+    print "end."
+}' > "$work_dir/nesting.pas"
+
+for input in statements expressions nesting; do
+    program=$work_dir/$input.pas
+    bytes=$(wc -c < "$program")
+
+    # The Bison parser is the first, its AST is the reference.
+    for parser in "${parsers[@]}"; do
+        same_ast=false
+        if "$pascal" -fsyntax-only -fparser="$parser" "$program" \
+               2> "$work_dir/$parser.ast" &&
+           cmp -s "$work_dir/bison.ast" "$work_dir/$parser.ast"; then
+            same_ast=true
+        fi
+
+        times=""
+        status=ok
+        for ((i = 0; i < repetitions; ++i)); do
+            if ! report=$("$pascal" -fsyntax-only -fno-print-ast -fmem-report \
+                              -fparser="$parser" "$program" 2>&1); then
+                status=failed
+                break
+            fi
+            times+=$(awk '$1 == "parse" { print $2 }' <<< "$report")$'\n'
+        done
+        if [[ $status != ok ]]; then
+            printf '{"input": "%s", "bytes": %d, "parser": "%s", "status": "%s"}\n' \
+                "$input" "$bytes" "$parser" "$status"
+            continue
+        fi
+
+        sort -g <<< "${times%$'\n'}" |
+        awk -v input="$input" -v bytes="$bytes" -v parser="$parser" \
+            -v status="$status" -v same_ast="$same_ast" '
+            { time[NR] = $1 + 0 }
+            END {
+                n = NR
+                median = n % 2 ? time[(n + 1) / 2] \
+                               : (time[n / 2] + time[n / 2 + 1]) / 2
+                speed = median > 0 ? bytes / 1048576 / (median / 1000) : 0
+                printf "{\"input\": \"%s\", \"bytes\": %d, " \
+                       "\"parser\": \"%s\", \"repetitions\": %d, " \
+                       "\"status\": \"%s\", \"parse_ms\": {\"min\": %.2f, " \
+                       "\"median\": %.2f}, \"mib_per_s\": %.2f, " \
+                       "\"same_ast\": %s}\n",
+                       input, bytes, parser, n, status, time[1], median,
+                       speed, same_ast
+            }'
+    done
+done
@@ -0,0 +1,71 @@
+#include "stack_space.hpp"
+
+#include <exception>
+
+#include <pthread.h>
+
+#include "llvm/Support/thread.h"
+
+namespace pas {
+
+namespace {
+
+struct StackBounds {
+  // Lowest address, the stack grows down to it.
+  const char *low = nullptr;
+  size_t size = 0;
+};
+
+StackBounds get_stack_bounds() {
+  thread_local StackBounds bounds = []() {
+    StackBounds result;
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+      return result;
+    }
+    void *address = nullptr;
+    size_t size = 0;
+    if (pthread_attr_getstack(&attributes, &address, &size) == 0) {
+      result.low = static_cast<const char *>(address);
+      result.size = size;
+    }
+    pthread_attr_destroy(&attributes);
+    return result;
+  }();
+  return bounds;
+}
+
+} // namespace
+
+bool is_stack_nearly_exhausted() {
+  StackBounds bounds = get_stack_bounds();
+  if (bounds.low == nullptr) {
+    return false;
+  }
+  // Of the frame, not of a local: locals may be moved off the stack by
+  //   sanitizers.
+  const char *frame = static_cast<const char *>(__builtin_frame_address(0));
+  if (frame < bounds.low || frame >= bounds.low + bounds.size) {
+    // E.g. a coroutine with a stack of its own.
+    return false;
+  }
+  return static_cast<size_t>(frame - bounds.low) < kStackRedZone;
+}
+
+void run_on_new_stack(llvm::function_ref<void()> function) {
+  std::exception_ptr exception;
+  llvm::Optional<unsigned> stack_size = kStackSegmentSize;
+  llvm::thread thread(stack_size, [&]() {
+    try {
+      function();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+  });
+  thread.join();
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+} // namespace pas
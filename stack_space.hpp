@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+
+// Recursion over the AST, that can't be an explicit stack easily (lowering
+//   of statements builds the IR between its children), is guarded: when
+//   the stack of the thread is nearly exhausted, the recursion continues on
+//   a new thread with a fresh stack, that the current one waits for. The
+//   depth of a program (e.g. of thousands of nested ifs, that a generator
+//   has written) is then limited by memory, not by the stack size.
+
+namespace pas {
+
+// Left at least, when a guarded function is entered. Recursion between
+//   two guards must fit into it.
+constexpr size_t kStackRedZone = 512 * 1024;
+// Of the threads, that continue the recursion.
+constexpr size_t kStackSegmentSize = 64 * 1024 * 1024;
+
+// False, if the bounds of the stack of the thread are unknown.
+bool is_stack_nearly_exhausted();
+
+// Runs the function on a new thread with kStackSegmentSize of stack and
+//   waits for it. Its exceptions are rethrown here.
+void run_on_new_stack(llvm::function_ref<void()> function);
+
+template <typename Function>
+auto run_with_sufficient_stack(Function &&function) {
+  using Result = decltype(function());
+  if (!is_stack_nearly_exhausted()) {
+    return function();
+  }
+  if constexpr (std::is_void_v<Result>) {
+    run_on_new_stack(function);
+  } else {
+    std::optional<Result> result;
+    run_on_new_stack([&]() { result.emplace(function()); });
+    return std::move(*result);
+  }
+}
+
+} // namespace pas
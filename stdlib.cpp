@@ -1,35 +1,94 @@
-#include "llvm/ADT/APInt.h"
-#include "llvm/ADT/ArrayRef.h"
-#include "llvm/ExecutionEngine/GenericValue.h"
-#include "llvm/IR/DerivedTypes.h" // llvm::FunctionType
+#include "stdlib.hpp"
 
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DynamicLibrary.h"
+
+#include <charconv>
 #include <cstdint>
 #include <cstdio>
 
-// Explaination why signatures are like this.
-//   https://github.com/llvm/llvm-project/blob/dbe63e3d4dc9e4a53c95a6f8fd24c071d0a603e2/llvm/lib/ExecutionEngine/Interpreter/ExternalFunctions.cpp#L104
-//   https://github.com/llvm/llvm-project/blob/dbe63e3d4dc9e4a53c95a6f8fd24c071d0a603e2/llvm/lib/ExecutionEngine/Interpreter/ExternalFunctions.cpp#L124
-//   https://github.com/llvm/llvm-project/blob/77116bd7d2682dde2bdfc6c4b96d036ffa7bc3b6/llvm/include/llvm/Support/DynamicLibrary.h#L128-L135
+void pas_write_int(int32_t value) {
+  char digits[16];
+  char *digits_end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  pas_host_write(digits, digits_end - digits);
+}
+
+// The shortest form, that reads back as the same number.
+void pas_write_real(double value) {
+  char digits[32];
+  char *digits_end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  pas_host_write(digits, digits_end - digits);
+}
+
+void pas_write_str(const pas_string *str) {
+  pas_host_write(pas_string_data(str), str->length);
+}
+
+namespace pas {
+namespace stdlib {
 
-// See the link to the interface example.
-//   https://github.com/llvm/llvm-project/blob/dbe63e3d4dc9e4a53c95a6f8fd24c071d0a603e2/llvm/lib/ExecutionEngine/Interpreter/ExternalFunctions.cpp#L440
-extern "C" llvm::GenericValue
-lle_X_write_int(llvm::FunctionType *FT,
-                llvm::ArrayRef<llvm::GenericValue> args) {
-  llvm::GenericValue GV;
+#define PAS_RUNTIME_SYMBOL(name)                                               \
+  llvm::sys::DynamicLibrary::AddSymbol(#name, reinterpret_cast<void *>(&name))
 
-  if (args.size() != 1) {
-    fprintf(stderr, "write_int requires exactly one argument!\n");
-    GV.IntVal = llvm::APInt(32, 0);
-    return GV;
-  }
+void register_symbols() {
+  PAS_RUNTIME_SYMBOL(pas_write_int);
+  PAS_RUNTIME_SYMBOL(pas_write_str);
+  PAS_RUNTIME_SYMBOL(pas_write_real);
 
-  int result = printf("%d", static_cast<int>(args[0].IntVal.getZExtValue()));
-  GV.IntVal = llvm::APInt(32, result);
+  PAS_RUNTIME_SYMBOL(pas_file_input);
+  PAS_RUNTIME_SYMBOL(pas_file_assign);
+  PAS_RUNTIME_SYMBOL(pas_file_reset);
+  PAS_RUNTIME_SYMBOL(pas_file_rewrite);
+  PAS_RUNTIME_SYMBOL(pas_file_close);
+  PAS_RUNTIME_SYMBOL(pas_file_release);
+  PAS_RUNTIME_SYMBOL(pas_file_fill);
+  PAS_RUNTIME_SYMBOL(pas_file_fill_value);
+  PAS_RUNTIME_SYMBOL(pas_file_write);
+  PAS_RUNTIME_SYMBOL(pas_file_read_int);
+  PAS_RUNTIME_SYMBOL(pas_file_read_real);
+  PAS_RUNTIME_SYMBOL(pas_file_read_char);
+  PAS_RUNTIME_SYMBOL(pas_file_read_str);
+  PAS_RUNTIME_SYMBOL(pas_file_read_line);
+  PAS_RUNTIME_SYMBOL(pas_file_write_int);
+  PAS_RUNTIME_SYMBOL(pas_file_write_real);
+  PAS_RUNTIME_SYMBOL(pas_file_write_char);
+  PAS_RUNTIME_SYMBOL(pas_file_write_str);
+  PAS_RUNTIME_SYMBOL(pas_file_write_line);
 
-  if (result < 0) {
-    fprintf(stderr, "write_int failed\n");
-  }
+  PAS_RUNTIME_SYMBOL(pas_string_assign);
+  PAS_RUNTIME_SYMBOL(pas_string_move);
+  PAS_RUNTIME_SYMBOL(pas_string_retain);
+  PAS_RUNTIME_SYMBOL(pas_string_release);
+  PAS_RUNTIME_SYMBOL(pas_string_concat);
+  PAS_RUNTIME_SYMBOL(pas_string_append);
+  PAS_RUNTIME_SYMBOL(pas_string_compare);
+  PAS_RUNTIME_SYMBOL(pas_string_equal);
+  PAS_RUNTIME_SYMBOL(pas_string_pos);
 
-  return GV;
+  PAS_RUNTIME_SYMBOL(pas_alloc_thread_cache);
+  PAS_RUNTIME_SYMBOL(pas_alloc_refill);
+  PAS_RUNTIME_SYMBOL(pas_alloc_large);
+  PAS_RUNTIME_SYMBOL(pas_free_large);
+
+  PAS_RUNTIME_SYMBOL(pas_profile_write);
+
+  PAS_RUNTIME_SYMBOL(pas_budget_start);
+  PAS_RUNTIME_SYMBOL(pas_budget_refill);
+
+  PAS_RUNTIME_SYMBOL(pas_parallel_for);
+
+  PAS_RUNTIME_SYMBOL(pas_task_new);
+  PAS_RUNTIME_SYMBOL(pas_task_spawn);
+  PAS_RUNTIME_SYMBOL(pas_task_await);
+  PAS_RUNTIME_SYMBOL(pas_task_release);
+  PAS_RUNTIME_SYMBOL(pas_channel_new);
+  PAS_RUNTIME_SYMBOL(pas_channel_send);
+  PAS_RUNTIME_SYMBOL(pas_channel_receive);
+  PAS_RUNTIME_SYMBOL(pas_channel_close);
+  PAS_RUNTIME_SYMBOL(pas_channel_free);
 }
+
+#undef PAS_RUNTIME_SYMBOL
+
+} // namespace stdlib
+} // namespace pas
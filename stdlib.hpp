@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stdlib/alloc.hpp"
+#include "stdlib/budget.hpp"
+#include "stdlib/file.hpp"
+#include "stdlib/host.hpp"
+#include "stdlib/parallel.hpp"
+#include "stdlib/profile.hpp"
+#include "stdlib/string.hpp"
+#include "stdlib/task.hpp"
+
+// Runtime library of the compiled programs. Functions are called by the
+//   JIT-compiled code directly, by their C names.
+
+extern "C" {
+void pas_write_int(int32_t value);
+void pas_write_str(const pas_string *str);
+void pas_write_real(double value);
+}
+
+namespace pas {
+namespace stdlib {
+
+// Makes the runtime functions visible to the JIT. Symbols are added
+//   explicitly, so that they are found even if the executable doesn't
+//   export them.
+void register_symbols();
+
+} // namespace stdlib
+} // namespace pas
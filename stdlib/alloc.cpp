@@ -0,0 +1,45 @@
+#include "stdlib/alloc.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "stdlib/host.hpp"
+
+// Free lists are refilled with objects carved from a chunk of this size.
+static constexpr uint64_t kChunkSize = 64 * 1024;
+
+static void *allocate_or_abort(uint64_t size) {
+  void *memory = malloc(size);
+  if (memory == nullptr) {
+    pas_host_fail("out of memory");
+  }
+  return memory;
+}
+
+pas_alloc_cache *pas_alloc_thread_cache() {
+  static thread_local pas_alloc_cache cache = {};
+  return &cache;
+}
+
+void *pas_alloc_refill(pas_alloc_cache *cache, uint64_t size_class) {
+  uint64_t object_size = (size_class + 1) * kAllocSizeClassStep;
+  uint64_t num_objects = kChunkSize / object_size;
+  // malloc returns memory aligned for any type, objects sizes are multiples
+  //   of 16, so all of the objects are aligned too.
+  char *chunk = static_cast<char *>(allocate_or_abort(kChunkSize));
+
+  // The first object is returned, the rest are linked into the free list in
+  //   the order of addresses, so that consecutive New's are close in memory.
+  void *head = cache->free_lists[size_class];
+  for (uint64_t i = num_objects - 1; i > 0; --i) {
+    void *object = chunk + i * object_size;
+    *static_cast<void **>(object) = head;
+    head = object;
+  }
+  cache->free_lists[size_class] = head;
+  return chunk;
+}
+
+void *pas_alloc_large(uint64_t size) { return allocate_or_abort(size); }
+
+void pas_free_large(void *object) { free(object); }
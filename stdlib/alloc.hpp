@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Allocator behind New and Dispose. Objects up to kAllocMaxSmallSize bytes
+//   are served from per-thread free lists, one for each size class of
+//   kAllocSizeClassStep bytes. The lowerer emits the common case inline:
+//   pop from the free list on New, push to it on Dispose. The runtime is
+//   called only to refill an empty list and for large objects.
+// Memory of small objects is never returned to malloc, it is reused by
+//   the objects of the same size class.
+
+constexpr uint64_t kAllocSizeClassStep = 16;
+constexpr uint64_t kAllocMaxSmallSize = 256;
+constexpr uint64_t kAllocNumSizeClasses =
+    kAllocMaxSmallSize / kAllocSizeClassStep;
+
+// Size class of objects of the given size, size must be at most
+//   kAllocMaxSmallSize.
+constexpr uint64_t get_alloc_size_class(uint64_t size) {
+  return size == 0 ? 0 : (size - 1) / kAllocSizeClassStep;
+}
+
+// Free objects store the pointer to the next free object in the first word.
+//   The layout is known to the lowerer: [kAllocNumSizeClasses x i8*].
+struct pas_alloc_cache {
+  void *free_lists[kAllocNumSizeClasses];
+};
+
+extern "C" {
+// Cache of the calling thread. The lowerer calls it once per function.
+pas_alloc_cache *pas_alloc_thread_cache();
+// Slow path of New for a small object: the free list of size_class is empty.
+void *pas_alloc_refill(pas_alloc_cache *cache, uint64_t size_class);
+void *pas_alloc_large(uint64_t size);
+void pas_free_large(void *object);
+}
@@ -0,0 +1,63 @@
+#include "stdlib/budget.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "stdlib/host.hpp"
+
+namespace {
+
+// Ticks between the checks of the clock. A tick is at least a few
+//   instructions, so the clock is read every few dozen microseconds at
+//   most, and the rest of the checks are a decrement.
+constexpr uint64_t kSliceTicks = 1 << 16;
+
+using Clock = std::chrono::steady_clock;
+
+std::mutex mutex;
+bool has_tick_limit = false;
+// Ticks, that are not given to the counter yet.
+uint64_t ticks_left = 0;
+bool has_time_limit = false;
+Clock::time_point deadline;
+
+} // namespace
+
+void pas_budget_start(int64_t *counter, uint64_t ticks,
+                      uint64_t time_limit_ms) {
+  std::lock_guard lock(mutex);
+  has_tick_limit = ticks != 0;
+  ticks_left = ticks;
+  has_time_limit = time_limit_ms != 0;
+  deadline = Clock::now() + std::chrono::milliseconds(time_limit_ms);
+  std::atomic_ref<int64_t>(*counter).store(0, std::memory_order_relaxed);
+}
+
+void pas_budget_refill(int64_t *counter) {
+  // The host may not end the process, the lock is released before a stop.
+  std::unique_lock lock(mutex);
+  auto stop = [&](const char *reason) {
+    lock.unlock();
+    pas_host_exit(kBudgetExitCode, reason);
+  };
+  std::atomic_ref<int64_t> count(*counter);
+  // Another thread has refilled it already.
+  if (count.load(std::memory_order_relaxed) >= 0) {
+    return;
+  }
+  if (has_time_limit && Clock::now() >= deadline) {
+    stop("Time limit exceeded.");
+  }
+  uint64_t slice = kSliceTicks;
+  if (has_tick_limit) {
+    if (ticks_left == 0) {
+      stop("Instruction budget exhausted.");
+    }
+    slice = std::min(slice, ticks_left);
+    ticks_left -= slice;
+  }
+  // This tick is paid from the slice.
+  count.store(static_cast<int64_t>(slice) - 1, std::memory_order_relaxed);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Budget of untrusted programs (-fbudget, -ftime-limit). A tick is an
+//   entry to a procedure or an iteration of a loop. The lowerer decrements
+//   a counter of the program at every tick and calls pas_budget_refill,
+//   when it drops below zero, so the hot path is a decrement and a branch,
+//   that is never taken. The counter is refilled by slices of ticks, the
+//   wall clock is checked once a slice.
+// When the budget or the time is over, the program is stopped with
+//   kBudgetExitCode through the host (stdlib/host.hpp). By default the
+//   output is flushed, a message is printed to stderr and the process
+//   exits.
+// Threads of parallel loops and tasks share the counter without atomic
+//   read-modify-writes, so concurrent ticks may be lost and the budget is
+//   approximate then.
+
+constexpr int kBudgetExitCode = 124;
+
+extern "C" {
+// Ticks and milliseconds of 0 are no limit. The wall clock starts now.
+void pas_budget_start(int64_t *counter, uint64_t ticks,
+                      uint64_t time_limit_ms);
+// Gives the counter the next slice, stops the program, if there is none.
+void pas_budget_refill(int64_t *counter);
+}
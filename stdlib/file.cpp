@@ -0,0 +1,442 @@
+#include "stdlib/file.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stdlib/host.hpp"
+#include "stdlib/simd.hpp"
+
+struct pas_file_state {
+  enum class Mode { Closed, Reading, Writing };
+
+  std::string name;
+  int fd = -1;
+  Mode mode = Mode::Closed;
+  // Mapping of the whole file, if it is read from one.
+  char *map = nullptr;
+  size_t map_size = 0;
+  // Read or written data otherwise. Values are copied to the beginning
+  //   of the buffer, so they are as aligned as in the mapping.
+  char *buffer = nullptr;
+  // Bytes in the buffer, when writing.
+  size_t used = 0;
+  // There is nothing to read from fd anymore.
+  bool is_drained = false;
+};
+
+[[noreturn]] static void fail(const std::string &message) {
+  pas_host_fail(message.c_str());
+}
+
+[[noreturn]] static void fail_errno(const std::string &message) {
+  fail(message + ": " + strerror(errno));
+}
+
+static pas_file_state *get_state(pas_file *file) {
+  if (file->state == nullptr) {
+    fail("file is not assigned to a name");
+  }
+  return file->state;
+}
+
+static void allocate_buffer(pas_file_state *state) {
+  if (state->buffer == nullptr) {
+    state->buffer = static_cast<char *>(aligned_alloc(64, kFileBufferSize));
+    if (state->buffer == nullptr) {
+      fail("out of memory");
+    }
+  }
+}
+
+// A regular file is mapped from the current offset to the end, there is
+//   nothing to copy then. Returns false, if it can't be mapped.
+static bool map_file(pas_file *file, pas_file_state *state) {
+  struct stat st;
+  if (fstat(state->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    return false;
+  }
+  off_t offset = lseek(state->fd, 0, SEEK_CUR);
+  if (offset < 0 || offset > st.st_size) {
+    return false;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, state->fd, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  state->map = static_cast<char *>(data);
+  state->map_size = st.st_size;
+  file->pos = state->map + offset;
+  file->end = state->map + st.st_size;
+  return true;
+}
+
+static void open_for_reading(pas_file *file, pas_file_state *state) {
+  state->mode = pas_file_state::Mode::Reading;
+  state->is_drained = false;
+  if (!map_file(file, state)) {
+    allocate_buffer(state);
+    file->pos = state->buffer;
+    file->end = state->buffer;
+  }
+}
+
+static bool fill(pas_file *file, uint64_t size) {
+  if (static_cast<uint64_t>(file->end - file->pos) >= size) {
+    return true;
+  }
+  pas_file_state *state = get_state(file);
+  if (state->mode != pas_file_state::Mode::Reading) {
+    fail("file is not open for reading: " + state->name);
+  }
+  if (state->map != nullptr || state->is_drained) {
+    return false;
+  }
+  if (size > kFileBufferSize) {
+    fail("value is too large to be read from a file: " + state->name);
+  }
+
+  // The beginning of the value is moved to the beginning of the buffer.
+  size_t left = file->end - file->pos;
+  memmove(state->buffer, file->pos, left);
+  // Prompts must be visible before the program waits for the input.
+  if (state->fd == STDIN_FILENO) {
+    fflush(stdout);
+  }
+  while (left < size) {
+    ssize_t read_size =
+        read(state->fd, state->buffer + left, kFileBufferSize - left);
+    if (read_size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read_size < 0) {
+      fail_errno("can't read " + state->name);
+    }
+    if (read_size == 0) {
+      state->is_drained = true;
+      break;
+    }
+    left += read_size;
+  }
+  file->pos = state->buffer;
+  file->end = state->buffer + left;
+  return left >= size;
+}
+
+static void write_all(pas_file_state *state, const char *data, size_t size) {
+  for (size_t written = 0; written < size;) {
+    ssize_t written_size = write(state->fd, data + written, size - written);
+    if (written_size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written_size < 0) {
+      fail_errno("can't write " + state->name);
+    }
+    written += written_size;
+  }
+}
+
+static void flush(pas_file_state *state) {
+  write_all(state, state->buffer, state->used);
+  state->used = 0;
+}
+
+// Files open for writing, for pas_file_flush_all.
+static std::mutex writing_files_mutex;
+static std::unordered_set<pas_file_state *> writing_files;
+
+static pas_file standard_input = {nullptr, nullptr, nullptr};
+// Data of the standard input, if it is read from memory.
+static const char *memory_input = nullptr;
+static size_t memory_input_size = 0;
+
+pas_file *pas_file_input() {
+  if (standard_input.state == nullptr) {
+    pas_file_state *state = new pas_file_state();
+    state->name = "standard input";
+    standard_input.state = state;
+    if (memory_input != nullptr) {
+      // All of it is in the buffer already, like in a mapping.
+      state->mode = pas_file_state::Mode::Reading;
+      state->is_drained = true;
+      standard_input.pos = memory_input;
+      standard_input.end = memory_input + memory_input_size;
+    } else {
+      state->fd = STDIN_FILENO;
+      open_for_reading(&standard_input, state);
+    }
+  }
+  return &standard_input;
+}
+
+void pas_file_set_input(const char *data, size_t size) {
+  if (standard_input.state != nullptr) {
+    pas_file_state *state = standard_input.state;
+    // Descriptor 0 belongs to the process, it stays open.
+    if (state->map != nullptr) {
+      munmap(state->map, state->map_size);
+    }
+    free(state->buffer);
+    delete state;
+    standard_input = {nullptr, nullptr, nullptr};
+  }
+  memory_input = data;
+  memory_input_size = size;
+}
+
+void pas_file_assign(pas_file *file, const pas_string *name) {
+  if (file->state == nullptr) {
+    file->state = new pas_file_state();
+  }
+  pas_file_close(file);
+  file->state->name.assign(pas_string_data(name), name->length);
+}
+
+void pas_file_reset(pas_file *file) {
+  pas_file_state *state = get_state(file);
+  pas_file_close(file);
+  state->fd = open(state->name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (state->fd < 0) {
+    fail_errno("can't open " + state->name);
+  }
+  open_for_reading(file, state);
+}
+
+void pas_file_rewrite(pas_file *file) {
+  pas_file_state *state = get_state(file);
+  pas_file_close(file);
+  state->fd = open(state->name.c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (state->fd < 0) {
+    fail_errno("can't create " + state->name);
+  }
+  allocate_buffer(state);
+  state->mode = pas_file_state::Mode::Writing;
+  std::lock_guard lock(writing_files_mutex);
+  writing_files.insert(state);
+}
+
+void pas_file_close(pas_file *file) {
+  pas_file_state *state = get_state(file);
+  if (state->mode == pas_file_state::Mode::Writing) {
+    flush(state);
+    std::lock_guard lock(writing_files_mutex);
+    writing_files.erase(state);
+  }
+  if (state->map != nullptr) {
+    munmap(state->map, state->map_size);
+    state->map = nullptr;
+  }
+  if (state->fd >= 0 && close(state->fd) != 0) {
+    fail_errno("can't close " + state->name);
+  }
+  state->fd = -1;
+  state->mode = pas_file_state::Mode::Closed;
+  file->pos = nullptr;
+  file->end = nullptr;
+}
+
+void pas_file_release(pas_file *file) {
+  if (file->state == nullptr) {
+    return;
+  }
+  pas_file_close(file);
+  free(file->state->buffer);
+  delete file->state;
+  file->state = nullptr;
+}
+
+void pas_file_flush_all() {
+  // A failed write stops the program, the lock is not held then.
+  std::vector<pas_file_state *> files;
+  {
+    std::lock_guard lock(writing_files_mutex);
+    files.assign(writing_files.begin(), writing_files.end());
+  }
+  for (pas_file_state *state : files) {
+    flush(state);
+  }
+}
+
+uint8_t pas_file_fill(pas_file *file, uint64_t size) {
+  return fill(file, size) ? 1 : 0;
+}
+
+const char *pas_file_fill_value(pas_file *file, uint64_t size) {
+  if (!fill(file, size)) {
+    fail("read past the end of " + get_state(file)->name);
+  }
+  return file->pos;
+}
+
+void pas_file_write(pas_file *file, const void *data, uint64_t size) {
+  pas_file_state *state = get_state(file);
+  if (state->mode != pas_file_state::Mode::Writing) {
+    fail("file is not open for writing: " + state->name);
+  }
+  if (state->used + size > kFileBufferSize) {
+    flush(state);
+  }
+  if (size > kFileBufferSize) {
+    // Too large to be buffered, written as is.
+    write_all(state, static_cast<const char *>(data), size);
+    return;
+  }
+  memcpy(state->buffer + state->used, data, size);
+  state->used += size;
+}
+
+static int peek(pas_file *file) {
+  return fill(file, 1) ? static_cast<unsigned char>(*file->pos) : EOF;
+}
+
+static bool is_digit(int c) { return static_cast<unsigned>(c - '0') < 10; }
+
+static bool is_blank(int c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+int32_t pas_file_read_int(pas_file *file) {
+  // Blanks are skipped up to the end of the buffer at once.
+  int c = peek(file);
+  while (is_blank(c)) {
+    file->pos = pas_simd_skip_blanks(file->pos, file->end);
+    c = peek(file);
+  }
+  bool is_negative = c == '-';
+  if (c == '-' || c == '+') {
+    ++file->pos;
+    c = peek(file);
+  }
+  if (!is_digit(c)) {
+    fail("integer expected in " + get_state(file)->name);
+  }
+
+  // The magnitude of the minimal Integer is one more than of the maximal.
+  uint64_t limit = is_negative ? uint64_t(INT32_MAX) + 1 : INT32_MAX;
+  uint64_t value = 0;
+  do {
+    value = value * 10 + (c - '0');
+    if (value > limit) {
+      fail("integer is too large in " + get_state(file)->name);
+    }
+    ++file->pos;
+    c = peek(file);
+  } while (is_digit(c));
+  return static_cast<int32_t>(is_negative ? 0 - value : value);
+}
+
+double pas_file_read_real(pas_file *file) {
+  int c = peek(file);
+  while (is_blank(c)) {
+    file->pos = pas_simd_skip_blanks(file->pos, file->end);
+    c = peek(file);
+  }
+  // The number may cross the end of the buffer, it is collected first.
+  std::string number;
+  while (is_digit(c) || c == '+' || c == '-' || c == '.' || c == 'e' ||
+         c == 'E') {
+    number += static_cast<char>(c);
+    ++file->pos;
+    c = peek(file);
+  }
+  // from_chars doesn't accept the plus sign.
+  const char *begin = number.data();
+  if (!number.empty() && number[0] == '+') {
+    ++begin;
+  }
+  double value = 0;
+  std::from_chars_result result =
+      std::from_chars(begin, number.data() + number.size(), value);
+  if (result.ec != std::errc() ||
+      result.ptr != number.data() + number.size()) {
+    fail("real number expected in " + get_state(file)->name);
+  }
+  return value;
+}
+
+uint8_t pas_file_read_char(pas_file *file) {
+  if (!fill(file, 1)) {
+    return 0;
+  }
+  return static_cast<uint8_t>(*file->pos++);
+}
+
+void pas_file_read_str(pas_file *file, pas_string *dst) {
+  if (!fill(file, 1)) {
+    pas_string_set(dst, "", 0);
+    return;
+  }
+  // Usually the whole line is in the buffer already.
+  auto *line_end = static_cast<const char *>(
+      memchr(file->pos, '\n', file->end - file->pos));
+  if (line_end != nullptr) {
+    pas_string_set(dst, file->pos, line_end - file->pos);
+    file->pos = line_end;
+    return;
+  }
+
+  static std::string line;
+  line.clear();
+  while (fill(file, 1)) {
+    line_end = static_cast<const char *>(
+        memchr(file->pos, '\n', file->end - file->pos));
+    const char *chunk_end = line_end != nullptr ? line_end : file->end;
+    line.append(file->pos, chunk_end);
+    file->pos = chunk_end;
+    if (line_end != nullptr) {
+      break;
+    }
+  }
+  if (line.size() > UINT32_MAX) {
+    fail("string is too long");
+  }
+  pas_string_set(dst, line.data(), static_cast<uint32_t>(line.size()));
+}
+
+void pas_file_read_line(pas_file *file) {
+  while (fill(file, 1)) {
+    auto *line_end = static_cast<const char *>(
+        memchr(file->pos, '\n', file->end - file->pos));
+    if (line_end != nullptr) {
+      file->pos = line_end + 1;
+      return;
+    }
+    file->pos = file->end;
+  }
+}
+
+void pas_file_write_int(pas_file *file, int32_t value) {
+  char digits[16];
+  char *digits_end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  pas_file_write(file, digits, digits_end - digits);
+}
+
+void pas_file_write_real(pas_file *file, double value) {
+  char digits[32];
+  char *digits_end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  pas_file_write(file, digits, digits_end - digits);
+}
+
+void pas_file_write_char(pas_file *file, uint8_t value) {
+  pas_file_write(file, &value, 1);
+}
+
+void pas_file_write_str(pas_file *file, const pas_string *str) {
+  pas_file_write(file, pas_string_data(str), str->length);
+}
+
+void pas_file_write_line(pas_file *file) { pas_file_write(file, "\n", 1); }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "stdlib/string.hpp"
+
+// Files: text files and typed files (file of T) of fixed-size values.
+//   Standard input is a text file too, read and readln without a file read
+//   from it.
+// A file is read in large blocks into a buffer, or mapped into memory as a
+//   whole, if it is a regular file. Either way the unread part of it is
+//   [pos, end), so a value of a typed file is accessed right in place: f^
+//   is a pointer into the buffer, the lowerer checks, that the value is
+//   there, and calls the runtime only to refill the buffer. Writes go to a
+//   buffer of the same size.
+
+constexpr uint64_t kFileBufferSize = 1 << 20;
+
+struct pas_file_state;
+
+// The layout is known to the lowerer: { i8*, i8*, i8* }. Zero filled
+//   memory is a file, that is not assigned to a name yet.
+struct pas_file {
+  // Unread data, if the file is open for reading, empty otherwise.
+  const char *pos;
+  const char *end;
+  pas_file_state *state;
+};
+
+static_assert(sizeof(pas_file) == 24);
+static_assert(offsetof(pas_file, end) == 8);
+
+// Errors (no such file, read past the end, malformed number) abort the
+//   program with a message.
+extern "C" {
+// Standard input, read and readln without a file use it.
+pas_file *pas_file_input();
+void pas_file_assign(pas_file *file, const pas_string *name);
+// Opens the file for reading from the beginning.
+void pas_file_reset(pas_file *file);
+// Creates the file or truncates it, and opens it for writing.
+void pas_file_rewrite(pas_file *file);
+void pas_file_close(pas_file *file);
+// Closes the file and forgets its name, the variable goes out of scope.
+void pas_file_release(pas_file *file);
+
+// Makes at least size bytes available at pos, returns 0, if the file ends
+//   before that. Slow path of eof and of the access to a value.
+uint8_t pas_file_fill(pas_file *file, uint64_t size);
+// Returns pos, aborts if there are less than size bytes left.
+const char *pas_file_fill_value(pas_file *file, uint64_t size);
+void pas_file_write(pas_file *file, const void *data, uint64_t size);
+
+// Text files. An integer is an optionally signed decimal number after
+//   blanks and line breaks, a real is a decimal number with an optional
+//   fraction and exponent. A string is the rest of the line, the line
+//   break is not consumed. A character is the next one, #0 at the end.
+int32_t pas_file_read_int(pas_file *file);
+double pas_file_read_real(pas_file *file);
+uint8_t pas_file_read_char(pas_file *file);
+void pas_file_read_str(pas_file *file, pas_string *dst);
+// Skips the rest of the line and the line break, readln does it last.
+void pas_file_read_line(pas_file *file);
+void pas_file_write_int(pas_file *file, int32_t value);
+void pas_file_write_real(pas_file *file, double value);
+void pas_file_write_char(pas_file *file, uint8_t value);
+void pas_file_write_str(pas_file *file, const pas_string *str);
+void pas_file_write_line(pas_file *file);
+}
+
+// Standard input is read from the memory, until the next call. Null data
+//   restores descriptor 0. Called, when no program is running.
+void pas_file_set_input(const char *data, size_t size);
+
+// Writes out the buffers of the files, that are open for writing, when the
+//   program is stopped before it closes them.
+void pas_file_flush_all();
@@ -0,0 +1,53 @@
+#include "stdlib/host.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "stdlib/file.hpp"
+
+namespace {
+
+const pas_host *current_host = nullptr;
+
+[[noreturn]] void stop(int exit_code, const char *message) {
+  // Files, that the program hasn't closed, are not lost either. Unless
+  //   writing them has failed.
+  static thread_local bool is_stopping = false;
+  if (!is_stopping) {
+    is_stopping = true;
+    pas_file_flush_all();
+  }
+  is_stopping = false;
+  if (current_host != nullptr) {
+    current_host->stop(current_host->context, exit_code, message);
+    abort();
+  }
+  // Other threads may still run, nothing is destroyed.
+  fflush(stdout);
+  fprintf(stderr, "%s\n", message);
+  fflush(stderr);
+  if (exit_code == kFailureExitCode) {
+    abort();
+  }
+  _Exit(exit_code);
+}
+
+} // namespace
+
+void pas_host_set(const pas_host *host) { current_host = host; }
+
+void pas_host_write(const char *data, size_t size) {
+  if (current_host != nullptr) {
+    current_host->write(current_host->context, data, size);
+    return;
+  }
+  if (fwrite(data, 1, size, stdout) != size) {
+    fprintf(stderr, "write failed\n");
+  }
+}
+
+void pas_host_fail(const char *message) { stop(kFailureExitCode, message); }
+
+void pas_host_exit(int exit_code, const char *message) {
+  stop(exit_code, message);
+}
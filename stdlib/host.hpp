@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+// The process, that runs the program: the compiler executable or an
+//   application, that embeds the compiler (libpascal.hpp). Output of
+//   write_int, write_str and write_real goes to the host, and the host
+//   decides, what stopping the program means. By default the output goes
+//   to stdout, runtime errors abort the process and stops exit it.
+
+// Exit code of runtime errors, the same as of an abort in a shell.
+constexpr int kFailureExitCode = 134;
+
+struct pas_host {
+  void *context;
+  void (*write)(void *context, const char *data, size_t size);
+  // Must not return. The output is flushed already.
+  void (*stop)(void *context, int exit_code, const char *message);
+};
+
+// Null restores the default host. Set, when no program is running.
+void pas_host_set(const pas_host *host);
+
+void pas_host_write(const char *data, size_t size);
+// Runtime error, e.g. out of memory or a read past the end of a file.
+[[noreturn]] void pas_host_fail(const char *message);
+// Budget of the program is over or it is stopped otherwise.
+[[noreturn]] void pas_host_exit(int exit_code, const char *message);
@@ -0,0 +1,169 @@
+#include "stdlib/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Chunks per thread, if all of the iterations take the same time. More
+//   chunks balance better, fewer ones spend less on the calls.
+constexpr int64_t kChunksPerThread = 16;
+
+// The thread runs a parallel loop, nested ones are sequential.
+thread_local bool is_in_parallel_loop = false;
+
+// Iterations of a thread, that are not taken yet. Parts are on separate
+//   cache lines, so that the threads don't contend for them.
+struct alignas(64) Part {
+  std::mutex mutex;
+  int64_t begin = 0;
+  int64_t end = 0;
+};
+
+class Pool {
+public:
+  explicit Pool(size_t num_threads) : parts_(num_threads) {
+    for (size_t i = 1; i < num_threads; ++i) {
+      std::thread(&Pool::work, this, i).detach();
+    }
+  }
+
+  size_t get_num_threads() const { return parts_.size(); }
+
+  // The calling thread is the thread 0 of the pool.
+  void run(pas_parallel_body body, void *context, int64_t count) {
+    int64_t num_threads = static_cast<int64_t>(parts_.size());
+    body_ = body;
+    context_ = context;
+    grain_ = std::max<int64_t>(1, count / (num_threads * kChunksPerThread));
+    for (int64_t i = 0; i < num_threads; ++i) {
+      parts_[i].begin = count * i / num_threads;
+      parts_[i].end = count * (i + 1) / num_threads;
+    }
+    // All of the threads take part, even those, that wake up after all of
+    //   the work is done, so that none of them sees the next loop as this
+    //   one.
+    num_working_.store(num_threads - 1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+    }
+    wakeup_.notify_all();
+
+    run_chunks(0);
+    while (num_working_.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  void work(size_t index) {
+    is_in_parallel_loop = true;
+    uint64_t seen_generation = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wakeup_.wait(lock, [&] { return generation_ != seen_generation; });
+        seen_generation = generation_;
+      }
+      run_chunks(index);
+      num_working_.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  void run_chunks(size_t index) {
+    do {
+      int64_t begin = 0;
+      int64_t end = 0;
+      while (take(index, begin, end)) {
+        body_(context_, begin, end);
+      }
+    } while (steal(index));
+  }
+
+  bool take(size_t index, int64_t &begin, int64_t &end) {
+    Part &part = parts_[index];
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (part.begin == part.end) {
+      return false;
+    }
+    begin = part.begin;
+    end = std::min(part.end, part.begin + grain_);
+    part.begin = end;
+    return true;
+  }
+
+  // Moves the back half of the part of another thread to the own part, it
+  //   may be stolen further from there.
+  bool steal(size_t index) {
+    size_t num_threads = parts_.size();
+    for (size_t i = 1; i < num_threads; ++i) {
+      Part &victim = parts_[(index + i) % num_threads];
+      int64_t begin = 0;
+      int64_t end = 0;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        int64_t left = victim.end - victim.begin;
+        if (left == 0) {
+          continue;
+        }
+        end = victim.end;
+        begin = end - (left + 1) / 2;
+        victim.end = begin;
+      }
+      Part &own = parts_[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = begin;
+      own.end = end;
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<Part> parts_;
+  pas_parallel_body body_ = nullptr;
+  void *context_ = nullptr;
+  int64_t grain_ = 1;
+  std::atomic<int64_t> num_working_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  uint64_t generation_ = 0;
+};
+
+// Threads of the pool are never stopped, they wait for the next loop until
+//   the program exits. The pool is never destroyed for the same reason.
+Pool &get_pool() {
+  static Pool *pool = new Pool(pas_num_threads());
+  return *pool;
+}
+
+} // namespace
+
+size_t pas_num_threads() {
+  if (const char *value = getenv("PAS_NUM_THREADS")) {
+    long num_threads = strtol(value, nullptr, 10);
+    if (num_threads > 0) {
+      return static_cast<size_t>(num_threads);
+    }
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void pas_parallel_for(pas_parallel_body body, void *context, int64_t count) {
+  if (count <= 0) {
+    return;
+  }
+  if (is_in_parallel_loop || count == 1 || get_pool().get_num_threads() == 1) {
+    body(context, 0, count);
+    return;
+  }
+  is_in_parallel_loop = true;
+  get_pool().run(body, context, count);
+  is_in_parallel_loop = false;
+}
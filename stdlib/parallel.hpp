@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Parallel for loops. The lowerer outlines the body of a loop into a
+//   function, that runs the iterations [begin, end) of it, and the runtime
+//   calls it for chunks of the iteration space from the threads of a pool.
+// Each thread owns a part of the iterations and takes chunks from the
+//   front of it. A thread, that has run out of work, steals the back half
+//   of the rest of the part of another one (work stealing), so iterations
+//   of uneven cost are balanced without a central queue.
+// The pool has a thread per core, the PAS_NUM_THREADS environment variable
+//   overrides that. Parallel loops inside of the bodies of parallel loops
+//   run sequentially.
+// The runtime is not thread-safe otherwise: bodies must not share strings
+//   or files with other iterations.
+
+using pas_parallel_body = void (*)(void *context, int64_t begin, int64_t end);
+
+extern "C" {
+// Runs the body for all of the iterations [0, count) and returns, when all
+//   of them are done.
+void pas_parallel_for(pas_parallel_body body, void *context, int64_t count);
+}
+
+// A thread per core, unless PAS_NUM_THREADS is set, for the rest of the
+//   runtime.
+size_t pas_num_threads();
@@ -0,0 +1,81 @@
+#include "stdlib/profile.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static constexpr const char *kProfileHeader = "pascal profile 1";
+
+void pas_profile_write(const char *path, const char *layout,
+                       const uint64_t *counters, uint64_t num_counters) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "can't write profile to %s\n", path);
+    return;
+  }
+  fprintf(file, "%s\n", kProfileHeader);
+
+  // The site is written as is, the number of counters is replaced by the
+  //   counters themselves.
+  uint64_t counter = 0;
+  for (const char *line = layout; *line != '\0';) {
+    const char *line_end = strchr(line, '\n');
+    const char *size_begin = line_end;
+    while (size_begin[-1] != ' ') {
+      --size_begin;
+    }
+    uint64_t site_size = strtoull(size_begin, nullptr, 10);
+    fwrite(line, 1, size_begin - 1 - line, file);
+    for (uint64_t i = 0; i < site_size && counter < num_counters; ++i) {
+      fprintf(file, " %" PRIu64, counters[counter++]);
+    }
+    fputc('\n', file);
+    line = line_end + 1;
+  }
+
+  if (fclose(file) != 0) {
+    fprintf(stderr, "can't write profile to %s\n", path);
+  }
+}
+
+namespace pas {
+namespace profile {
+
+std::optional<Profile> read_profile(const std::string &path,
+                                    std::string &error) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    error = "can't open profile " + path;
+    return std::nullopt;
+  }
+  std::string line;
+  if (!std::getline(file, line) || line != kProfileHeader) {
+    error = "not a profile of pascal program: " + path;
+    return std::nullopt;
+  }
+
+  Profile profile;
+  int line_number = 1;
+  while (std::getline(file, line)) {
+    ++line_number;
+    std::istringstream fields(line);
+    std::string function;
+    Site site;
+    if (!(fields >> function >> site.kind >> site.line)) {
+      error = path + ":" + std::to_string(line_number) + ": bad profile site";
+      return std::nullopt;
+    }
+    uint64_t count = 0;
+    while (fields >> count) {
+      site.counts.push_back(count);
+    }
+    profile[function].push_back(std::move(site));
+  }
+  return profile;
+}
+
+} // namespace profile
+} // namespace pas
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Profile of an instrumented program (-fprofile-generate), the compiler
+//   reads it back for -fprofile-use. It is a text file:
+//     pascal profile 1
+//     <function> <kind> <line> <count>...
+//   one line for each site (procedure entry, if, loop, case) in the order,
+//   in which the lowerer visits them. Kind and line let the compiler
+//   notice, that the program has changed since the profile was taken.
+
+extern "C" {
+// Layout has a line "<function> <kind> <line> <num_counters>" for each
+//   site, counters of the sites follow each other.
+void pas_profile_write(const char *path, const char *layout,
+                       const uint64_t *counters, uint64_t num_counters);
+}
+
+namespace pas {
+namespace profile {
+
+struct Site {
+  std::string kind;
+  int line;
+  std::vector<uint64_t> counts;
+};
+
+// Sites of each function, by the name of LLVM function.
+using Profile = std::unordered_map<std::string, std::vector<Site>>;
+
+// Returns nothing and sets error, if the file can't be read or parsed.
+std::optional<Profile> read_profile(const std::string &path,
+                                    std::string &error);
+
+} // namespace profile
+} // namespace pas
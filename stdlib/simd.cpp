@@ -0,0 +1,224 @@
+#include "stdlib/simd.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+static bool is_blank(unsigned char c) {
+  // '\t', '\n', '\v', '\f', '\r' are 9..13.
+  return c == ' ' || static_cast<unsigned char>(c - '\t') < 5;
+}
+
+// Plain loops for the tails, that are shorter than a vector, and for other
+//   targets.
+static size_t mismatch_scalar(const char *lhs, const char *rhs, size_t size) {
+  size_t i = 0;
+  while (i < size && lhs[i] == rhs[i]) {
+    ++i;
+  }
+  return i;
+}
+
+static size_t find_scalar(const char *haystack, size_t haystack_size,
+                          const char *needle, size_t needle_size,
+                          size_t start) {
+  for (size_t i = start; i + needle_size <= haystack_size; ++i) {
+    if (memcmp(haystack + i, needle, needle_size) == 0) {
+      return i;
+    }
+  }
+  return kSimdNotFound;
+}
+
+static const char *skip_blanks_scalar(const char *pos, const char *end) {
+  while (pos < end && is_blank(*pos)) {
+    ++pos;
+  }
+  return pos;
+}
+
+#if defined(__x86_64__)
+
+// All of the kernels compare vectors bytewise and work with the bitmasks
+//   of the results, one bit per byte: the first set bit is the first
+//   match. Loads are unaligned, vectors never cross the end of the data.
+
+static size_t mismatch_sse2(const char *lhs, const char *rhs, size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i equal = _mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i)));
+    uint32_t differ = ~static_cast<uint32_t>(_mm_movemask_epi8(equal)) & 0xFFFF;
+    if (differ != 0) {
+      return i + __builtin_ctz(differ);
+    }
+  }
+  return i + mismatch_scalar(lhs + i, rhs + i, size - i);
+}
+
+__attribute__((target("avx2"))) static size_t
+mismatch_avx2(const char *lhs, const char *rhs, size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i equal = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i)));
+    uint32_t differ = ~static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+    if (differ != 0) {
+      return i + __builtin_ctz(differ);
+    }
+  }
+  return i + mismatch_sse2(lhs + i, rhs + i, size - i);
+}
+
+// Candidates are positions, where both the first and the last characters
+//   of the needle match, the rest is compared only for them. That is
+//   rare in text, so most of the haystack is skipped a vector at a time.
+static size_t find_sse2(const char *haystack, size_t haystack_size,
+                        const char *needle, size_t needle_size) {
+  __m128i first = _mm_set1_epi8(needle[0]);
+  __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+  size_t i = 0;
+  for (; i + needle_size - 1 + 16 <= haystack_size; i += 16) {
+    __m128i block_first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+    __m128i block_last = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(haystack + i + needle_size - 1));
+    uint32_t candidates = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+    while (candidates != 0) {
+      size_t candidate = i + __builtin_ctz(candidates);
+      if (memcmp(haystack + candidate + 1, needle + 1, needle_size - 1) == 0) {
+        return candidate;
+      }
+      candidates &= candidates - 1;
+    }
+  }
+  return find_scalar(haystack, haystack_size, needle, needle_size, i);
+}
+
+__attribute__((target("avx2"))) static size_t
+find_avx2(const char *haystack, size_t haystack_size, const char *needle,
+          size_t needle_size) {
+  __m256i first = _mm256_set1_epi8(needle[0]);
+  __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+  size_t i = 0;
+  for (; i + needle_size - 1 + 32 <= haystack_size; i += 32) {
+    __m256i block_first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+    __m256i block_last = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(haystack + i + needle_size - 1));
+    uint32_t candidates = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                         _mm256_cmpeq_epi8(block_last, last)));
+    while (candidates != 0) {
+      size_t candidate = i + __builtin_ctz(candidates);
+      if (memcmp(haystack + candidate + 1, needle + 1, needle_size - 1) == 0) {
+        return candidate;
+      }
+      candidates &= candidates - 1;
+    }
+  }
+  size_t found =
+      find_sse2(haystack + i, haystack_size - i, needle, needle_size);
+  return found == kSimdNotFound ? found : i + found;
+}
+
+// c is a blank, if it is ' ' or c - '\t' < 5 unsigned. There are no
+//   unsigned comparisons of bytes, x < 5 is min(x, 4) == x.
+static const char *skip_blanks_sse2(const char *pos, const char *end) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i four = _mm_set1_epi8(4);
+  for (; end - pos >= 16; pos += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+    __m128i control = _mm_sub_epi8(block, tab);
+    __m128i blank =
+        _mm_or_si128(_mm_cmpeq_epi8(block, space),
+                     _mm_cmpeq_epi8(_mm_min_epu8(control, four), control));
+    uint32_t other = ~static_cast<uint32_t>(_mm_movemask_epi8(blank)) & 0xFFFF;
+    if (other != 0) {
+      return pos + __builtin_ctz(other);
+    }
+  }
+  return skip_blanks_scalar(pos, end);
+}
+
+__attribute__((target("avx2"))) static const char *
+skip_blanks_avx2(const char *pos, const char *end) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i four = _mm256_set1_epi8(4);
+  for (; end - pos >= 32; pos += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos));
+    __m256i control = _mm256_sub_epi8(block, tab);
+    __m256i blank = _mm256_or_si256(
+        _mm256_cmpeq_epi8(block, space),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control));
+    uint32_t other = ~static_cast<uint32_t>(_mm256_movemask_epi8(blank));
+    if (other != 0) {
+      return pos + __builtin_ctz(other);
+    }
+  }
+  return skip_blanks_sse2(pos, end);
+}
+
+#endif
+
+namespace {
+
+struct Kernels {
+  size_t (*mismatch)(const char *, const char *, size_t);
+  size_t (*find)(const char *, size_t, const char *, size_t);
+  const char *(*skip_blanks)(const char *, const char *);
+};
+
+Kernels select_kernels() {
+#if defined(__x86_64__)
+  // The runtime may be loaded before the CPU model is initialized.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {mismatch_avx2, find_avx2, skip_blanks_avx2};
+  }
+  return {mismatch_sse2, find_sse2, skip_blanks_sse2};
+#else
+  return {mismatch_scalar,
+          [](const char *haystack, size_t haystack_size, const char *needle,
+             size_t needle_size) {
+            return find_scalar(haystack, haystack_size, needle, needle_size,
+                               0);
+          },
+          skip_blanks_scalar};
+#endif
+}
+
+const Kernels kKernels = select_kernels();
+
+} // namespace
+
+size_t pas_simd_mismatch(const char *lhs, const char *rhs, size_t size) {
+  return kKernels.mismatch(lhs, rhs, size);
+}
+
+size_t pas_simd_find(const char *haystack, size_t haystack_size,
+                     const char *needle, size_t needle_size) {
+  if (needle_size == 0) {
+    return 0;
+  }
+  if (needle_size > haystack_size) {
+    return kSimdNotFound;
+  }
+  if (needle_size == 1) {
+    const void *found = memchr(haystack, needle[0], haystack_size);
+    return found != nullptr ? static_cast<const char *>(found) - haystack
+                            : kSimdNotFound;
+  }
+  return kKernels.find(haystack, haystack_size, needle, needle_size);
+}
+
+const char *pas_simd_skip_blanks(const char *pos, const char *end) {
+  return kKernels.skip_blanks(pos, end);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized kernels of the string and file runtime. On x86-64 the AVX2
+//   versions are used, if the CPU supports them, the SSE2 ones otherwise.
+//   The choice is made once, when the runtime is loaded. Other targets use
+//   plain loops.
+
+constexpr size_t kSimdNotFound = SIZE_MAX;
+
+// Returns the index of the first byte, that differs, size if there is none.
+size_t pas_simd_mismatch(const char *lhs, const char *rhs, size_t size);
+// Returns the index of the first occurrence of the needle in the haystack,
+//   kSimdNotFound if there is none. The empty needle is found at 0.
+size_t pas_simd_find(const char *haystack, size_t haystack_size,
+                     const char *needle, size_t needle_size);
+// Returns the first character of [pos, end), that is not a blank (space,
+//   tab, line break, vertical tab, form feed), end if there is none.
+const char *pas_simd_skip_blanks(const char *pos, const char *end);
@@ -0,0 +1,181 @@
+#include "stdlib/string.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "stdlib/host.hpp"
+#include "stdlib/simd.hpp"
+
+static char *get_buffer_data(pas_string_buffer *buffer) {
+  return reinterpret_cast<char *>(buffer + 1);
+}
+
+static char *get_data(pas_string *str) {
+  return str->capacity == 0 ? str->inline_data : get_buffer_data(str->buffer);
+}
+
+const char *pas_string_data(const pas_string *str) {
+  return get_data(const_cast<pas_string *>(str));
+}
+
+static uint32_t get_capacity(const pas_string *str) {
+  return str->capacity == 0 ? kStringInlineCapacity : str->capacity;
+}
+
+// Characters can be written in place.
+static bool is_unique(const pas_string *str) {
+  return str->capacity == 0 || str->buffer->refcount == 1;
+}
+
+static void make_empty(pas_string *str) {
+  str->length = 0;
+  str->capacity = 0;
+}
+
+static uint32_t get_total_length(uint64_t lhs, uint64_t rhs) {
+  uint64_t length = lhs + rhs;
+  if (length > UINT32_MAX) {
+    pas_host_fail("string is too long");
+  }
+  return static_cast<uint32_t>(length);
+}
+
+static pas_string_buffer *allocate_buffer(uint32_t capacity) {
+  auto *buffer = static_cast<pas_string_buffer *>(
+      malloc(sizeof(pas_string_buffer) + capacity));
+  if (buffer == nullptr) {
+    pas_host_fail("out of memory");
+  }
+  buffer->refcount = 1;
+  return buffer;
+}
+
+// Prepares str for length characters, previous value must be released.
+static char *initialize(pas_string *str, uint32_t length) {
+  str->length = length;
+  if (length <= kStringInlineCapacity) {
+    str->capacity = 0;
+    return str->inline_data;
+  }
+  str->capacity = length;
+  str->buffer = allocate_buffer(length);
+  return get_buffer_data(str->buffer);
+}
+
+void pas_string_retain(pas_string *str) {
+  if (str->capacity != 0 && str->buffer->refcount != 0) {
+    ++str->buffer->refcount;
+  }
+}
+
+void pas_string_release(pas_string *str) {
+  if (str->capacity != 0 && str->buffer->refcount != 0 &&
+      --str->buffer->refcount == 0) {
+    free(str->buffer);
+  }
+  make_empty(str);
+}
+
+void pas_string_assign(pas_string *dst, const pas_string *src) {
+  if (dst == src) {
+    return;
+  }
+  // Retained first: dst and src may share the buffer.
+  pas_string_retain(const_cast<pas_string *>(src));
+  pas_string_release(dst);
+  memcpy(dst, src, sizeof(pas_string));
+}
+
+void pas_string_move(pas_string *dst, pas_string *src) {
+  if (dst == src) {
+    return;
+  }
+  pas_string_release(dst);
+  memcpy(dst, src, sizeof(pas_string));
+  make_empty(src);
+}
+
+void pas_string_concat(pas_string *dst, const pas_string *lhs,
+                       const pas_string *rhs) {
+  uint32_t lhs_length = lhs->length;
+  uint32_t rhs_length = rhs->length;
+  pas_string result;
+  char *data = initialize(&result, get_total_length(lhs_length, rhs_length));
+  memcpy(data, pas_string_data(lhs), lhs_length);
+  memcpy(data + lhs_length, pas_string_data(rhs), rhs_length);
+  // dst may be one of the operands.
+  pas_string_move(dst, &result);
+}
+
+void pas_string_append(pas_string *dst, const pas_string *src) {
+  uint32_t old_length = dst->length;
+  uint32_t src_length = src->length;
+  uint32_t length = get_total_length(old_length, src_length);
+
+  if (is_unique(dst) && length <= get_capacity(dst)) {
+    // If src is dst, the source characters are before the destination ones.
+    memcpy(get_data(dst) + old_length, pas_string_data(src), src_length);
+    dst->length = length;
+    return;
+  }
+
+  // Capacity grows geometrically, so that appending in a loop takes
+  //   amortized constant time per character.
+  uint32_t capacity = static_cast<uint32_t>(std::min<uint64_t>(
+      std::max<uint64_t>({length, uint64_t(get_capacity(dst)) * 2,
+                          2 * kStringInlineCapacity}),
+      UINT32_MAX));
+  pas_string result;
+  result.length = length;
+  result.capacity = capacity;
+  result.buffer = allocate_buffer(capacity);
+  char *data = get_buffer_data(result.buffer);
+  memcpy(data, pas_string_data(dst), old_length);
+  memcpy(data + old_length, pas_string_data(src), src_length);
+  pas_string_move(dst, &result);
+}
+
+int32_t pas_string_compare(const pas_string *lhs, const pas_string *rhs) {
+  const char *lhs_data = pas_string_data(lhs);
+  const char *rhs_data = pas_string_data(rhs);
+  uint32_t length = std::min(lhs->length, rhs->length);
+  size_t i = pas_simd_mismatch(lhs_data, rhs_data, length);
+  if (i != length) {
+    // Characters are unsigned, as in memcmp.
+    return static_cast<unsigned char>(lhs_data[i]) <
+                   static_cast<unsigned char>(rhs_data[i])
+               ? -1
+               : 1;
+  }
+  if (lhs->length != rhs->length) {
+    return lhs->length < rhs->length ? -1 : 1;
+  }
+  return 0;
+}
+
+uint8_t pas_string_equal(const pas_string *lhs, const pas_string *rhs) {
+  if (lhs->length != rhs->length) {
+    return 0;
+  }
+  const char *lhs_data = pas_string_data(lhs);
+  const char *rhs_data = pas_string_data(rhs);
+  // Copies share the buffer.
+  if (lhs_data == rhs_data) {
+    return 1;
+  }
+  return pas_simd_mismatch(lhs_data, rhs_data, lhs->length) == lhs->length;
+}
+
+int32_t pas_string_pos(const pas_string *sub, const pas_string *str) {
+  size_t i = pas_simd_find(pas_string_data(str), str->length,
+                           pas_string_data(sub), sub->length);
+  return i == kSimdNotFound ? 0 : static_cast<int32_t>(i + 1);
+}
+
+void pas_string_set(pas_string *str, const char *data, uint32_t length) {
+  pas_string result;
+  memcpy(initialize(&result, length), data, length);
+  pas_string_move(str, &result);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pascal String is a value type. Strings up to kStringInlineCapacity
+//   characters are stored right inside of the variable, longer ones live
+//   in a reference counted heap buffer, which is shared between copies and
+//   copied only when one of them is modified (copy-on-write).
+// The layout is known to the lowerer: { i32, i32, [2 x i64] }.
+
+constexpr uint32_t kStringInlineCapacity = 16;
+
+struct pas_string_buffer {
+  // Buffers of string literals are never freed and have refcount 0.
+  uint64_t refcount;
+  // Characters follow the header.
+};
+
+struct pas_string {
+  uint32_t length;
+  // 0 if characters are stored inline.
+  uint32_t capacity;
+  union {
+    char inline_data[kStringInlineCapacity];
+    pas_string_buffer *buffer;
+  };
+};
+
+static_assert(sizeof(pas_string) == 24);
+static_assert(alignof(pas_string) == 8);
+static_assert(offsetof(pas_string, inline_data) == 8);
+
+// All of the functions accept initialized strings only, zero filled memory
+//   is an empty string. Results are written to initialized strings too,
+//   their previous values are released.
+extern "C" {
+void pas_string_assign(pas_string *dst, const pas_string *src);
+// Steals the value of src, src becomes empty.
+void pas_string_move(pas_string *dst, pas_string *src);
+void pas_string_retain(pas_string *str);
+// Drops the value, str becomes empty.
+void pas_string_release(pas_string *str);
+void pas_string_concat(pas_string *dst, const pas_string *lhs,
+                       const pas_string *rhs);
+// dst := dst + src, in place, if the buffer is not shared.
+void pas_string_append(pas_string *dst, const pas_string *src);
+// Returns negative, zero or positive value, like memcmp.
+int32_t pas_string_compare(const pas_string *lhs, const pas_string *rhs);
+// Returns 1, if the strings are equal, 0 otherwise.
+uint8_t pas_string_equal(const pas_string *lhs, const pas_string *rhs);
+// Returns the position of the first occurrence of sub in str counting from
+//   1, 0 if there is none.
+int32_t pas_string_pos(const pas_string *sub, const pas_string *str);
+}
+
+const char *pas_string_data(const pas_string *str);
+// Sets the value to a copy of the characters, for the rest of the runtime.
+void pas_string_set(pas_string *str, const char *data, uint32_t length);
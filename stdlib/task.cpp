@@ -0,0 +1,572 @@
+#include "stdlib/task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "stdlib/host.hpp"
+#include "stdlib/parallel.hpp"
+
+namespace {
+
+// Every thread, that spawns or runs tasks, has a deque.
+constexpr size_t kMaxDeques = 1024;
+constexpr int64_t kInitialDequeCapacity = 256;
+// Idle and waiting threads check this many times before they sleep.
+constexpr int kSpinsBeforeSleep = 64;
+
+[[noreturn]] void fail(const char *message) { pas_host_fail(message); }
+
+// The header is right before the frame.
+struct Task {
+  // A task is run by the thread, that changes the state from Pending to
+  //   Running: a worker, that has taken it from a deque, or the awaiting
+  //   thread. Awaited is Running with a thread sleeping in await.
+  enum State : uint32_t { Pending = 0, Running = 1, Awaited = 2, Done = 3 };
+
+  pas_task_body body;
+  void *memory;
+  uint64_t alignment;
+  std::atomic<uint32_t> state = Pending;
+  // Released by the thread, that has taken the task from the deque, and
+  //   by the one, that has awaited it, whichever is the last frees it.
+  std::atomic<uint32_t> refs = 2;
+};
+
+Task *get_task(void *frame) { return static_cast<Task *>(frame) - 1; }
+
+void *get_frame(Task *task) { return task + 1; }
+
+// Returns false, if another thread runs the task.
+bool run(Task *task) {
+  uint32_t state = Task::Pending;
+  if (!task->state.compare_exchange_strong(state, Task::Running,
+                                           std::memory_order_acquire)) {
+    return false;
+  }
+  task->body(get_frame(task));
+  if (task->state.exchange(Task::Done, std::memory_order_acq_rel) ==
+      Task::Awaited) {
+    task->state.notify_all();
+  }
+  return true;
+}
+
+void release(Task *task) {
+  if (task->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    ::operator delete(task->memory, std::align_val_t(task->alignment));
+  }
+}
+
+// Chase-Lev deque, with the memory orders of "Correct and Efficient
+//   Work-Stealing for Weak Memory Models" (Le et al., 2013).
+class Deque {
+public:
+  Deque() {
+    arrays_.push_back(std::make_unique<Array>(kInitialDequeCapacity));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  // Owner only.
+  void push(Task *task) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array *array = array_.load(std::memory_order_relaxed);
+    if (bottom - top >= array->capacity) {
+      array = grow(array, top, bottom);
+    }
+    array->put(bottom, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only, takes the most recently pushed task.
+  Task *pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array *array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task *task = array->get(bottom);
+    if (top == bottom) {
+      // The last task, a thief may be taking it too.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  // Any thread, takes the oldest task. Returns null, if the deque is empty
+  //   or another thread has taken the task first.
+  Task *steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    Task *task = array_.load(std::memory_order_acquire)->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  bool is_empty() const {
+    return top_.load(std::memory_order_acquire) >=
+           bottom_.load(std::memory_order_acquire);
+  }
+
+private:
+  struct Array {
+    explicit Array(int64_t capacity)
+        : capacity(capacity),
+          items(new std::atomic<Task *>[static_cast<size_t>(capacity)]) {}
+
+    Task *get(int64_t index) const {
+      return items[index & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(int64_t index, Task *task) {
+      items[index & (capacity - 1)].store(task, std::memory_order_relaxed);
+    }
+
+    int64_t capacity;
+    std::unique_ptr<std::atomic<Task *>[]> items;
+  };
+
+  // Thieves may still read the old array, so it is kept until the deque
+  //   is destroyed.
+  Array *grow(Array *array, int64_t top, int64_t bottom) {
+    arrays_.push_back(std::make_unique<Array>(array->capacity * 2));
+    Array *grown = arrays_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      grown->put(i, array->get(i));
+    }
+    array_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  std::atomic<Array *> array_;
+  // All of the arrays, the current one is the last.
+  std::vector<std::unique_ptr<Array>> arrays_;
+};
+
+// Waiting threads don't run other tasks: a task could wait for the
+//   waiting one to go on, for a channel to be closed, for example. A worker,
+//   that waits, keeps its thread, instead another worker is started, if
+//   there are fewer running ones, than cores. So programs may have more
+//   threads, than cores, if many tasks wait at the same time.
+class Scheduler {
+public:
+  explicit Scheduler(size_t num_running) : num_running_(num_running) {
+    for (size_t i = 0; i < num_running; ++i) {
+      start_worker();
+    }
+  }
+
+  void spawn(Task *task) {
+    get_own_deque().push(task);
+    // Paired with the fences of sleep: either the worker sees the task, or
+    //   this thread sees the worker and wakes it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_sleeping_.load(std::memory_order_relaxed) > 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_one();
+    }
+  }
+
+  // Takes the task, if it is the last one pushed to the own deque, as it
+  //   usually is, when a task is awaited right after the spawn and the
+  //   work in between. Otherwise the deque would keep the entries of the
+  //   tasks, that were run by their awaiting threads.
+  bool take_own(Task *task) {
+    Deque &own_deque = get_own_deque();
+    Task *last = own_deque.pop();
+    if (last == task) {
+      return true;
+    }
+    if (last != nullptr) {
+      own_deque.push(last);
+    }
+    return false;
+  }
+
+  // Around the sleep of a thread, that waits for a task or a channel.
+  void begin_wait() {
+    if (!is_worker) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_waiting_;
+    if (num_workers_ - num_waiting_ < num_running_) {
+      start_worker();
+    }
+  }
+
+  void end_wait() {
+    if (!is_worker) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    --num_waiting_;
+  }
+
+private:
+  void start_worker() {
+    ++num_workers_;
+    std::thread(&Scheduler::work, this).detach();
+  }
+
+  Deque &get_own_deque() {
+    thread_local Deque *own_deque = nullptr;
+    if (own_deque == nullptr) {
+      own_deque = new Deque();
+      size_t index = num_deques_.fetch_add(1, std::memory_order_relaxed);
+      if (index >= kMaxDeques) {
+        fail("too many threads use tasks");
+      }
+      deques_[index].store(own_deque, std::memory_order_release);
+    }
+    return *own_deque;
+  }
+
+  // Own tasks are taken first, the most recent ones, which are likely to
+  //   be awaited next. Then the oldest tasks of the other threads, which
+  //   are likely to spawn more, starting from a random one.
+  Task *find_task() {
+    Deque &own_deque = get_own_deque();
+    if (Task *task = own_deque.pop()) {
+      return task;
+    }
+    // Xorshift, seeded differently in every thread.
+    thread_local uint32_t random =
+        static_cast<uint32_t>(
+            std::hash<std::thread::id>()(std::this_thread::get_id())) |
+        1;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    size_t num_deques = std::min(
+        num_deques_.load(std::memory_order_acquire), kMaxDeques);
+    for (size_t i = 0; i < num_deques; ++i) {
+      Deque *deque =
+          deques_[(random + i) % num_deques].load(std::memory_order_acquire);
+      if (deque == nullptr || deque == &own_deque) {
+        continue;
+      }
+      if (Task *task = deque->steal()) {
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_pending_tasks() const {
+    size_t num_deques = std::min(
+        num_deques_.load(std::memory_order_acquire), kMaxDeques);
+    for (size_t i = 0; i < num_deques; ++i) {
+      Deque *deque = deques_[i].load(std::memory_order_acquire);
+      if (deque != nullptr && !deque->is_empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void sleep() {
+    num_sleeping_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    if (!has_pending_tasks()) {
+      epoch_.wait(epoch, std::memory_order_acquire);
+    }
+    num_sleeping_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void work() {
+    is_worker = true;
+    int spins = 0;
+    for (;;) {
+      if (Task *task = find_task()) {
+        // Tasks, that were run by their awaiting threads, are skipped.
+        run(task);
+        release(task);
+        spins = 0;
+      } else if (++spins < kSpinsBeforeSleep) {
+        std::this_thread::yield();
+      } else {
+        sleep();
+        spins = 0;
+      }
+    }
+  }
+
+  std::atomic<Deque *> deques_[kMaxDeques] = {};
+  std::atomic<size_t> num_deques_ = 0;
+  std::atomic<uint32_t> num_sleeping_ = 0;
+  // Incremented to wake up the sleeping workers.
+  std::atomic<uint32_t> epoch_ = 0;
+
+  static thread_local bool is_worker;
+  std::mutex mutex_;
+  // Workers, that don't wait, up to one per core.
+  size_t num_running_;
+  size_t num_workers_ = 0;
+  size_t num_waiting_ = 0;
+};
+
+thread_local bool Scheduler::is_worker = false;
+
+// Workers are never stopped, the scheduler is never destroyed, like the
+//   pool of parallel loops.
+Scheduler &get_scheduler() {
+  static Scheduler *scheduler = new Scheduler(pas_num_threads());
+  return *scheduler;
+}
+
+// Vyukov's bounded MPMC queue. The sequence number of a cell tells, whose
+//   turn it is: pos, if it is free for the sender of position pos, pos + 1,
+//   if it holds the item for the receiver of position pos.
+class Channel {
+public:
+  Channel(uint64_t item_size, uint64_t capacity)
+      : item_size_(item_size), mask_(capacity - 1),
+        sequences_(new std::atomic<uint64_t>[capacity]),
+        items_(new char[item_size * capacity]) {
+    for (uint64_t i = 0; i < capacity; ++i) {
+      sequences_[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  void send(const void *item) {
+    wait_for([&] {
+      if (closed_.load(std::memory_order_acquire)) {
+        fail("send to a closed channel");
+      }
+      if (!try_send(item)) {
+        return false;
+      }
+      signal();
+      return true;
+    });
+  }
+
+  bool receive(void *item) {
+    bool received = false;
+    wait_for([&] {
+      received = try_receive(item);
+      if (!received && closed_.load(std::memory_order_acquire)) {
+        // Items sent before the close are still received.
+        received = try_receive(item);
+        return true;
+      }
+      if (received) {
+        signal();
+      }
+      return received;
+    });
+    return received;
+  }
+
+  void close() {
+    closed_.store(true, std::memory_order_seq_cst);
+    version_.fetch_add(1, std::memory_order_release);
+    version_.notify_all();
+  }
+
+private:
+  bool try_send(const void *item) {
+    uint64_t pos = send_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      std::atomic<uint64_t> &sequence = sequences_[pos & mask_];
+      int64_t diff =
+          static_cast<int64_t>(sequence.load(std::memory_order_acquire) - pos);
+      if (diff == 0) {
+        if (send_pos_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          memcpy(&items_[(pos & mask_) * item_size_], item, item_size_);
+          sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = send_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_receive(void *item) {
+    uint64_t pos = receive_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      std::atomic<uint64_t> &sequence = sequences_[pos & mask_];
+      int64_t diff = static_cast<int64_t>(
+          sequence.load(std::memory_order_acquire) - (pos + 1));
+      if (diff == 0) {
+        if (receive_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          memcpy(item, &items_[(pos & mask_) * item_size_], item_size_);
+          sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = receive_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Retries the operation, until it is done, then sleeps until the other
+  //   side changes the channel.
+  template <typename Operation> void wait_for(Operation operation) {
+    int spins = 0;
+    while (!operation()) {
+      if (++spins < kSpinsBeforeSleep) {
+        std::this_thread::yield();
+        continue;
+      }
+      // Paired with the fence of signal: either the operation succeeds
+      //   now, or the other side sees the waiter and changes the version.
+      num_waiting_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      uint32_t version = version_.load(std::memory_order_acquire);
+      bool is_done = operation();
+      if (!is_done) {
+        get_scheduler().begin_wait();
+        version_.wait(version, std::memory_order_acquire);
+        get_scheduler().end_wait();
+      }
+      num_waiting_.fetch_sub(1, std::memory_order_relaxed);
+      if (is_done) {
+        return;
+      }
+    }
+  }
+
+  void signal() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_waiting_.load(std::memory_order_relaxed) > 0) {
+      version_.fetch_add(1, std::memory_order_release);
+      version_.notify_all();
+    }
+  }
+
+  uint64_t item_size_;
+  uint64_t mask_;
+  std::unique_ptr<std::atomic<uint64_t>[]> sequences_;
+  std::unique_ptr<char[]> items_;
+  alignas(64) std::atomic<uint64_t> send_pos_ = 0;
+  alignas(64) std::atomic<uint64_t> receive_pos_ = 0;
+  alignas(64) std::atomic<bool> closed_ = false;
+  std::atomic<uint32_t> num_waiting_ = 0;
+  std::atomic<uint32_t> version_ = 0;
+};
+
+} // namespace
+
+void *pas_task_new(pas_task_body body, uint64_t frame_size,
+                   uint64_t frame_alignment) {
+  uint64_t alignment = std::max<uint64_t>(frame_alignment, alignof(Task));
+  uint64_t offset = (sizeof(Task) + alignment - 1) / alignment * alignment;
+  void *memory = ::operator new(offset + frame_size,
+                                std::align_val_t(alignment), std::nothrow);
+  if (memory == nullptr) {
+    fail("out of memory");
+  }
+  char *frame = static_cast<char *>(memory) + offset;
+  memset(frame, 0, frame_size);
+  new (get_task(frame)) Task{body, memory, alignment};
+  return frame;
+}
+
+void pas_task_spawn(void *task) { get_scheduler().spawn(get_task(task)); }
+
+void pas_task_await(void *frame) {
+  if (frame == nullptr) {
+    fail("await of a task, that is not running");
+  }
+  Task *task = get_task(frame);
+  // Not taken by a worker yet, so it runs right here, as a call.
+  if (get_scheduler().take_own(task)) {
+    run(task);
+    release(task);
+    return;
+  }
+  if (run(task)) {
+    return;
+  }
+  int spins = 0;
+  for (;;) {
+    uint32_t state = task->state.load(std::memory_order_acquire);
+    if (state == Task::Done) {
+      return;
+    }
+    if (++spins < kSpinsBeforeSleep) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (state == Task::Running &&
+        !task->state.compare_exchange_strong(state, Task::Awaited,
+                                             std::memory_order_acquire)) {
+      continue;
+    }
+    get_scheduler().begin_wait();
+    task->state.wait(Task::Awaited, std::memory_order_acquire);
+    get_scheduler().end_wait();
+  }
+}
+
+void pas_task_release(void *frame) { release(get_task(frame)); }
+
+void *pas_channel_new(uint64_t item_size, int32_t capacity) {
+  if (capacity <= 0) {
+    fail("capacity of a channel must be positive");
+  }
+  return new Channel(item_size, std::bit_ceil(std::max<uint64_t>(
+                                    2, static_cast<uint64_t>(capacity))));
+}
+
+void pas_channel_send(void *channel, const void *item) {
+  if (channel == nullptr) {
+    fail("send to a channel, that is not created");
+  }
+  static_cast<Channel *>(channel)->send(item);
+}
+
+uint8_t pas_channel_receive(void *channel, void *item) {
+  if (channel == nullptr) {
+    fail("receive from a channel, that is not created");
+  }
+  return static_cast<Channel *>(channel)->receive(item) ? 1 : 0;
+}
+
+void pas_channel_close(void *channel) {
+  if (channel == nullptr) {
+    fail("close of a channel, that is not created");
+  }
+  static_cast<Channel *>(channel)->close();
+}
+
+void pas_channel_free(void *channel) { delete static_cast<Channel *>(channel); }
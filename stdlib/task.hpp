@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Tasks and channels. The lowerer makes a small function for every
+//   spawned procedure, that takes the arguments from a frame and calls it.
+//   The frame is allocated by the runtime together with the task, the
+//   task handle is the address of the frame. The result of a function is
+//   stored at the start of the frame.
+// Every thread has its own deque of tasks (Chase-Lev). The owner pushes
+//   and pops at the bottom without locks, other threads steal from the
+//   top. Workers of the pool (a thread per core, PAS_NUM_THREADS overrides
+//   that) run their own tasks and steal the rest. Await runs the task
+//   itself, if nobody has started it yet. Otherwise the thread sleeps, it
+//   doesn't run other tasks meanwhile: they could wait for something, that
+//   only the sleeping thread does later. A worker, that sleeps on a task or
+//   a channel, starts a spare one instead, so that the cores stay busy.
+// Channels are bounded lock-free queues (Vyukov's MPMC ring buffer) of
+//   values of fixed size. The capacity is rounded up to a power of two,
+//   at least 2.
+// Every task must be awaited, its memory is freed then. Arguments and
+//   channel items are copied byte by byte, so they can't own strings.
+
+using pas_task_body = void (*)(void *frame);
+
+extern "C" {
+// Allocates a task with a zero filled frame, it's not running yet.
+void *pas_task_new(pas_task_body body, uint64_t frame_size,
+                   uint64_t frame_alignment);
+void pas_task_spawn(void *task);
+// Waits for the task to finish, the frame stays valid until the release.
+void pas_task_await(void *task);
+void pas_task_release(void *task);
+
+void *pas_channel_new(uint64_t item_size, int32_t capacity);
+// Waits for a free slot, aborts, if the channel is closed.
+void pas_channel_send(void *channel, const void *item);
+// Waits for an item, returns 0 without it, if the channel is closed and
+//   empty.
+uint8_t pas_channel_receive(void *channel, void *item);
+void pas_channel_close(void *channel);
+void pas_channel_free(void *channel);
+}